@@ -0,0 +1,337 @@
+/***************************************************************************************************************************
+  * @file    hal_dma_driver.c
+  * @author  Sharath N
+  * @brief   DMA HAL module driver,
+             This file provides firmware functions to manage the DMA1/DMA2 streams in STM32F407 Discovery Board.
+***************************************************************************************************************************/
+
+#include <stdint.h>
+#include "hal_dma_driver.h"
+
+/***************************************************************************************************************************/
+/*                                                                                                                         */
+/*                                               Helper functions                                                          */
+/*                                                                                                                         */
+/***************************************************************************************************************************/
+
+/**
+  * @brief  Returns the DMA controller(DMA1 or DMA2) which owns the given stream
+  * @param  *stream : Base address of DMA stream
+  * @retval  Base address of DMA controller
+ */
+static DMA_TypeDef *hal_dma_get_controller(DMA_Stream_TypeDef *stream)
+{
+	/* Streams are placed at offset 0x10 + 0x18 * n from the controller base address */
+	return (DMA_TypeDef *)((uint32_t)stream & ~(uint32_t)0x3FF);
+}
+
+
+
+/**
+  * @brief  Returns the stream number (0 to 7) of the given stream
+  * @param  *stream : Base address of DMA stream
+  * @retval  stream number
+ */
+static uint32_t hal_dma_get_stream_number(DMA_Stream_TypeDef *stream)
+{
+	return ((((uint32_t)stream & 0xFF) - 0x10) / 0x18);
+}
+
+
+
+/**
+  * @brief  Reads the interrupt flags of the given stream, flags are returned at bit position 0
+  * @param  *stream : Base address of DMA stream
+  * @retval  interrupt flags of the stream
+ */
+static uint32_t hal_dma_get_flags(DMA_Stream_TypeDef *stream)
+{
+	DMA_TypeDef *dma = hal_dma_get_controller(stream);
+	uint32_t n = hal_dma_get_stream_number(stream);
+	uint32_t isr = (n < 4) ? dma->LISR : dma->HISR;
+
+	return ((isr >> DMA_STREAM_FLAG_OFFSET(n)) & DMA_REG_ISR_ALL_FLAGS);
+}
+
+
+
+/**
+  * @brief  Clears the given interrupt flags of the stream
+  * @param  *stream : Base address of DMA stream
+  * @param  flags : flags to be cleared (DMA_REG_ISR_xxx)
+  * @retval  none
+ */
+static void hal_dma_clear_flags(DMA_Stream_TypeDef *stream, uint32_t flags)
+{
+	DMA_TypeDef *dma = hal_dma_get_controller(stream);
+	uint32_t n = hal_dma_get_stream_number(stream);
+
+	if(n < 4)
+	{
+		dma->LIFCR = (flags << DMA_STREAM_FLAG_OFFSET(n));
+	}
+	else
+	{
+		dma->HIFCR = (flags << DMA_STREAM_FLAG_OFFSET(n));
+	}
+}
+
+
+
+/**
+  * @brief  Disable the stream and wait until hardware releases it
+  * @param  *stream : Base address of DMA stream
+  * @retval  none
+ */
+static void hal_dma_disable(DMA_Stream_TypeDef *stream)
+{
+	stream->CR &= ~DMA_REG_SXCR_EN;
+
+	/* EN bit reads back 1 until the current data item has been transferred */
+	while(stream->CR & DMA_REG_SXCR_EN);
+}
+
+
+
+/***********************************************************************************************************************************/
+/*                                                                                                                                 */
+/*                                               Driver Exposed APIs                                                               */
+/*                                                                                                                                 */
+/***********************************************************************************************************************************/
+
+/**
+  * @brief  Initializes the given DMA stream
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_init(dma_handle_t *hdma)
+{
+	uint32_t cr = 0;
+
+	/* Stream must be disabled before it can be configured */
+	hal_dma_disable(hdma->Instance);
+
+	cr |= (hdma->Init.Channel << DMA_REG_SXCR_CHSEL);
+	cr |= (hdma->Init.Priority << DMA_REG_SXCR_PL);
+	cr |= (hdma->Init.MemDataAlignment << DMA_REG_SXCR_MSIZE);
+	cr |= (hdma->Init.PeriphDataAlignment << DMA_REG_SXCR_PSIZE);
+	cr |= (hdma->Init.Direction << DMA_REG_SXCR_DIR);
+
+	if(hdma->Init.MemInc)
+		cr |= DMA_REG_SXCR_MINC;
+
+	if(hdma->Init.PeriphInc)
+		cr |= DMA_REG_SXCR_PINC;
+
+	if(hdma->Init.Mode == DMA_MODE_CIRCULAR)
+		cr |= DMA_REG_SXCR_CIRC;
+
+	hdma->Instance->CR = cr;
+
+	/* Direct mode, FIFO is not used */
+	hdma->Instance->FCR = 0;
+
+	hal_dma_clear_flags(hdma->Instance, DMA_REG_ISR_ALL_FLAGS);
+
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_READY;
+}
+
+
+
+/**
+  * @brief  Starts a DMA transfer with error interrupts enabled, transfer complete and half transfer(circular mode)
+  *         interrupts are enabled only if the matching callback is set
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @param  src : source address
+  * @param  dst : destination address
+  * @param  len : number of data items to be transferred
+  * @retval  none
+ */
+void hal_dma_start_it(dma_handle_t *hdma, uint32_t src, uint32_t dst, uint32_t len)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+
+	hal_dma_disable(stream);
+	hal_dma_clear_flags(stream, DMA_REG_ISR_ALL_FLAGS);
+
+	stream->NDTR = len;
+
+	if(hdma->Init.Direction == DMA_MEMORY_TO_PERIPH)
+	{
+		stream->PAR = dst;
+		stream->M0AR = src;
+	}
+	else
+	{
+		/* peripheral-to-memory and memory-to-memory both use PAR as the source address */
+		stream->PAR = src;
+		stream->M0AR = dst;
+	}
+
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_BUSY;
+
+	/* Stream may have been left in double buffer mode by previous transfer */
+	stream->CR &= ~(DMA_REG_SXCR_DBM | DMA_REG_SXCR_CT);
+
+	stream->CR |= (DMA_REG_SXCR_TEIE | DMA_REG_SXCR_DMEIE);
+
+	/* Transfer complete and half transfer interrupts are only useful when somebody is listening */
+	if(hdma->xfer_cplt_cb)
+		stream->CR |= DMA_REG_SXCR_TCIE;
+	else
+		stream->CR &= ~DMA_REG_SXCR_TCIE;
+
+	if(hdma->xfer_half_cb)
+		stream->CR |= DMA_REG_SXCR_HTIE;
+	else
+		stream->CR &= ~DMA_REG_SXCR_HTIE;
+
+	stream->CR |= DMA_REG_SXCR_EN;
+}
+
+
+
+/**
+  * @brief  Starts a peripheral-to-memory or memory-to-peripheral transfer in double buffer mode, stream switches
+  *         between mem0 and mem1 every len data items without stopping. Transfer complete interrupt is raised
+  *         at every switch, the buffer not pointed by hal_dma_get_current_target is the one that got completed.
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @param  periph : peripheral data register address
+  * @param  mem0 : first memory buffer
+  * @param  mem1 : second memory buffer
+  * @param  len : number of data items in each buffer
+  * @retval  none
+ */
+void hal_dma_start_double_buffer_it(dma_handle_t *hdma, uint32_t periph, uint32_t mem0, uint32_t mem1, uint32_t len)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+
+	hal_dma_disable(stream);
+	hal_dma_clear_flags(stream, DMA_REG_ISR_ALL_FLAGS);
+
+	stream->NDTR = len;
+	stream->PAR = periph;
+	stream->M0AR = mem0;
+	stream->M1AR = mem1;
+
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_BUSY;
+
+	/* Start with mem0, circular mode is forced by hardware in double buffer mode */
+	stream->CR &= ~DMA_REG_SXCR_CT;
+	stream->CR |= (DMA_REG_SXCR_DBM | DMA_REG_SXCR_TCIE | DMA_REG_SXCR_TEIE | DMA_REG_SXCR_DMEIE);
+
+	if(hdma->xfer_half_cb)
+		stream->CR |= DMA_REG_SXCR_HTIE;
+	else
+		stream->CR &= ~DMA_REG_SXCR_HTIE;
+
+	stream->CR |= DMA_REG_SXCR_EN;
+}
+
+
+
+/**
+  * @brief  Returns the memory buffer currently used by a double buffer transfer
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  0 if stream is filling/draining mem0, 1 if mem1
+ */
+uint32_t hal_dma_get_current_target(dma_handle_t *hdma)
+{
+	return (hdma->Instance->CR & DMA_REG_SXCR_CT) ? 1 : 0;
+}
+
+
+
+/**
+  * @brief  Stops an on going DMA transfer
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_abort(dma_handle_t *hdma)
+{
+	hdma->Instance->CR &= ~(DMA_REG_SXCR_TCIE | DMA_REG_SXCR_HTIE | DMA_REG_SXCR_TEIE | DMA_REG_SXCR_DMEIE);
+
+	hal_dma_disable(hdma->Instance);
+	hal_dma_clear_flags(hdma->Instance, DMA_REG_ISR_ALL_FLAGS);
+
+	hdma->State = HAL_DMA_STATE_READY;
+}
+
+
+
+/**
+  * @brief  Returns the number of data items remaining to be transferred (NDTR)
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  remaining data items
+ */
+uint32_t hal_dma_get_counter(dma_handle_t *hdma)
+{
+	return hdma->Instance->NDTR;
+}
+
+
+
+/**
+  * @brief  This API handles the DMA stream interrupt request
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_irq_handler(dma_handle_t *hdma)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+	uint32_t flags = hal_dma_get_flags(stream);
+	uint32_t cr = stream->CR;
+
+	/* Transfer error / direct mode error ----------------------------------------------------------------------------- */
+	if((flags & DMA_REG_ISR_TEIF) && (cr & DMA_REG_SXCR_TEIE))
+	{
+		hal_dma_clear_flags(stream, DMA_REG_ISR_TEIF);
+		hdma->ErrorCode |= HAL_DMA_ERROR_TE;
+	}
+
+	if((flags & DMA_REG_ISR_DMEIF) && (cr & DMA_REG_SXCR_DMEIE))
+	{
+		hal_dma_clear_flags(stream, DMA_REG_ISR_DMEIF);
+		hdma->ErrorCode |= HAL_DMA_ERROR_DME;
+	}
+
+	if(hdma->ErrorCode != HAL_DMA_ERROR_NONE)
+	{
+		/* Hardware already disabled the stream on transfer error */
+		stream->CR &= ~(DMA_REG_SXCR_TCIE | DMA_REG_SXCR_HTIE | DMA_REG_SXCR_TEIE | DMA_REG_SXCR_DMEIE);
+		hdma->State = HAL_DMA_STATE_ERROR;
+
+		if(hdma->xfer_error_cb)
+			hdma->xfer_error_cb(hdma);
+
+		return;
+	}
+
+	/* Half transfer -------------------------------------------------------------------------------------------------- */
+	if((flags & DMA_REG_ISR_HTIF) && (cr & DMA_REG_SXCR_HTIE))
+	{
+		hal_dma_clear_flags(stream, DMA_REG_ISR_HTIF);
+
+		if(hdma->xfer_half_cb)
+			hdma->xfer_half_cb(hdma);
+	}
+
+	/* Transfer complete ---------------------------------------------------------------------------------------------- */
+	if((flags & DMA_REG_ISR_TCIF) && (cr & DMA_REG_SXCR_TCIE))
+	{
+		hal_dma_clear_flags(stream, DMA_REG_ISR_TCIF);
+
+		/* In circular and double buffer mode stream keeps running, so it stays busy */
+		if(!(cr & (DMA_REG_SXCR_CIRC | DMA_REG_SXCR_DBM)))
+		{
+			stream->CR &= ~(DMA_REG_SXCR_TCIE | DMA_REG_SXCR_HTIE | DMA_REG_SXCR_TEIE | DMA_REG_SXCR_DMEIE);
+			hdma->State = HAL_DMA_STATE_READY;
+		}
+
+		if(hdma->xfer_cplt_cb)
+			hdma->xfer_cplt_cb(hdma);
+	}
+}
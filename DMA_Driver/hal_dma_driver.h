@@ -0,0 +1,232 @@
+/**************************************************************************************************************************
+ * @file     hal_dma_driver.h
+ * @author   Sharath N
+ * @brief    Header file for DMA Driver of STM32F407 Discovery Baord.
+ **************************************************************************************************************************/
+
+#ifndef __HAL_DMA_DRIVER_H
+#define __HAL_DMA_DRIVER_H
+
+/*MCU specific header file for stm32f407vgt6 base discovery board */
+#include "stm32f407xx.h"
+#include <stdint.h>
+
+/******************************************************************************************************************************/
+/*                                                                                                                            */
+/*                                            1. DMA Register bit definition                                                  */
+/*                                                                                                                            */
+/******************************************************************************************************************************/
+
+/***********************************Bit Definition for DMA_SxCR Register********************************************************/
+
+/* Channel selection */
+#define DMA_REG_SXCR_CHSEL                                             ((uint32_t) 25)
+#define DMA_CHANNEL_0                                                  ((uint32_t) 0x00)
+#define DMA_CHANNEL_1                                                  ((uint32_t) 0x01)
+#define DMA_CHANNEL_2                                                  ((uint32_t) 0x02)
+#define DMA_CHANNEL_3                                                  ((uint32_t) 0x03)
+#define DMA_CHANNEL_4                                                  ((uint32_t) 0x04)
+#define DMA_CHANNEL_5                                                  ((uint32_t) 0x05)
+#define DMA_CHANNEL_6                                                  ((uint32_t) 0x06)
+#define DMA_CHANNEL_7                                                  ((uint32_t) 0x07)
+
+/* Current target and double buffer mode */
+#define DMA_REG_SXCR_CT                                                ((uint32_t) 1 << 19)
+#define DMA_REG_SXCR_DBM                                               ((uint32_t) 1 << 18)
+
+/* Priority level */
+#define DMA_REG_SXCR_PL                                                ((uint32_t) 16)
+#define DMA_PRIORITY_LOW                                               ((uint32_t) 0x00)
+#define DMA_PRIORITY_MEDIUM                                            ((uint32_t) 0x01)
+#define DMA_PRIORITY_HIGH                                              ((uint32_t) 0x02)
+#define DMA_PRIORITY_VERY_HIGH                                         ((uint32_t) 0x03)
+
+/* Memory and peripheral data size */
+#define DMA_REG_SXCR_MSIZE                                             ((uint32_t) 13)
+#define DMA_REG_SXCR_PSIZE                                             ((uint32_t) 11)
+#define DMA_DATA_SIZE_BYTE                                             ((uint32_t) 0x00)
+#define DMA_DATA_SIZE_HALFWORD                                         ((uint32_t) 0x01)
+#define DMA_DATA_SIZE_WORD                                             ((uint32_t) 0x02)
+
+/* Memory and peripheral increment mode */
+#define DMA_REG_SXCR_MINC                                              ((uint32_t) 1 << 10)
+#define DMA_REG_SXCR_PINC                                              ((uint32_t) 1 << 9)
+
+/* Circular mode */
+#define DMA_REG_SXCR_CIRC                                              ((uint32_t) 1 << 8)
+#define DMA_MODE_NORMAL                                                0
+#define DMA_MODE_CIRCULAR                                              1
+
+/* Data transfer direction */
+#define DMA_REG_SXCR_DIR                                               ((uint32_t) 6)
+#define DMA_PERIPH_TO_MEMORY                                           ((uint32_t) 0x00)
+#define DMA_MEMORY_TO_PERIPH                                           ((uint32_t) 0x01)
+#define DMA_MEMORY_TO_MEMORY                                           ((uint32_t) 0x02)
+
+/* Interrupt enable */
+#define DMA_REG_SXCR_TCIE                                              ((uint32_t) 1 << 4)
+#define DMA_REG_SXCR_HTIE                                              ((uint32_t) 1 << 3)
+#define DMA_REG_SXCR_TEIE                                              ((uint32_t) 1 << 2)
+#define DMA_REG_SXCR_DMEIE                                             ((uint32_t) 1 << 1)
+
+/* Stream enable */
+#define DMA_REG_SXCR_EN                                                ((uint32_t) 1 << 0)
+
+/***********************************Bit Definition for DMA_LISR/HISR Register***************************************************/
+
+/* Flags of one stream, shifted by the stream offset given below */
+#define DMA_REG_ISR_TCIF                                               ((uint32_t) 1 << 5)
+#define DMA_REG_ISR_HTIF                                               ((uint32_t) 1 << 4)
+#define DMA_REG_ISR_TEIF                                               ((uint32_t) 1 << 3)
+#define DMA_REG_ISR_DMEIF                                              ((uint32_t) 1 << 2)
+#define DMA_REG_ISR_FEIF                                               ((uint32_t) 1 << 0)
+#define DMA_REG_ISR_ALL_FLAGS                                          ((uint32_t) 0x3D)
+
+/* Stream 0/4 -> bit 0, Stream 1/5 -> bit 6, Stream 2/6 -> bit 16, Stream 3/7 -> bit 22 */
+#define DMA_STREAM_FLAG_OFFSET(stream)                                 ((uint32_t) (((stream) & 0x03) * 6 + (((stream) & 0x02) ? 4 : 0)))
+
+/***********************************Base address of DMA controllers**************************************************************/
+
+#define DMA_1                                                          DMA1
+#define DMA_2                                                          DMA2
+
+/*********************************Macros to enable the clock for DMA controllers**************************************************/
+
+#define _HAL_RCC_DMA1_CLK_ENABLE()                                     (RCC->AHB1ENR |= (1 << 21))
+#define _HAL_RCC_DMA2_CLK_ENABLE()                                     (RCC->AHB1ENR |= (1 << 22))
+
+
+/**
+  *@brief DMA Possible Error Codes
+	*/
+#define HAL_DMA_ERROR_NONE                                            ((uint32_t) 0x00000000)     // No error
+#define HAL_DMA_ERROR_TE                                              ((uint32_t) 0x00000001)     // Transfer error
+#define HAL_DMA_ERROR_DME                                             ((uint32_t) 0x00000002)     // Direct mode error
+
+
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                              2. Data Structure used by DMA driver                                                       */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+/**
+  *@brief HAL DMA State structures definition
+	*/
+typedef enum
+{
+	HAL_DMA_STATE_RESET         = 0x00,    /* Stream not yet initialized or disabled */
+	HAL_DMA_STATE_READY         = 0x01,    /* Stream initialized and ready to use    */
+	HAL_DMA_STATE_BUSY          = 0x02,    /* Transfer is on going                   */
+	HAL_DMA_STATE_ERROR         = 0x03     /* Transfer error                         */
+} hal_dma_state_t;
+
+
+/**
+  *@brief DMA Stream Configuration Structure definition
+	*/
+typedef struct
+{
+	uint32_t Channel;             /* Specifies the channel used for the stream (DMA request mapping, RM0090 table 42/43) */
+	uint32_t Direction;           /* Specifies peripheral-to-memory, memory-to-peripheral or memory-to-memory */
+	uint32_t PeriphInc;           /* Specifies whether the peripheral address is incremented */
+	uint32_t MemInc;              /* Specifies whether the memory address is incremented */
+	uint32_t PeriphDataAlignment; /* Specifies the peripheral data size */
+	uint32_t MemDataAlignment;    /* Specifies the memory data size */
+	uint32_t Mode;                /* Specifies normal or circular mode */
+	uint32_t Priority;            /* Specifies the software priority of the stream */
+} dma_init_t;
+
+
+/*Application callback typedef */
+typedef void(DMA_XFER_CB_t) (void *hdma);
+
+
+/**
+  *@brief DMA handle structure definition
+  */
+typedef struct
+{
+	DMA_Stream_TypeDef     *Instance;        /* DMA Stream Register Base Address */
+	dma_init_t             Init;             /* DMA Stream configuration parameter */
+	hal_dma_state_t        State;            /* DMA transfer state */
+	uint32_t               ErrorCode;        /* DMA Error code */
+	void                   *Parent;          /* Handle of the peripheral driver which owns this stream */
+	DMA_XFER_CB_t          *xfer_cplt_cb;    /* Called when the transfer is completed */
+	DMA_XFER_CB_t          *xfer_half_cb;    /* Called when half of the transfer is completed */
+	DMA_XFER_CB_t          *xfer_error_cb;   /* Called when a transfer error occured */
+} dma_handle_t;
+
+
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                              3. Driver Exposed APIs                                                                     */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+/**
+  * @brief  Initializes the given DMA stream
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_init(dma_handle_t *hdma);
+
+
+/**
+  * @brief  Starts a DMA transfer with error interrupts enabled, transfer complete and half transfer(circular mode)
+  *         interrupts are enabled only if the matching callback is set
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @param  src : source address
+  * @param  dst : destination address
+  * @param  len : number of data items to be transferred
+  * @retval  none
+ */
+void hal_dma_start_it(dma_handle_t *hdma, uint32_t src, uint32_t dst, uint32_t len);
+
+
+/**
+  * @brief  Starts a peripheral-to-memory or memory-to-peripheral transfer in double buffer mode, stream switches
+  *         between mem0 and mem1 every len data items without stopping. Transfer complete interrupt is raised
+  *         at every switch, the buffer not pointed by hal_dma_get_current_target is the one that got completed.
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @param  periph : peripheral data register address
+  * @param  mem0 : first memory buffer
+  * @param  mem1 : second memory buffer
+  * @param  len : number of data items in each buffer
+  * @retval  none
+ */
+void hal_dma_start_double_buffer_it(dma_handle_t *hdma, uint32_t periph, uint32_t mem0, uint32_t mem1, uint32_t len);
+
+
+/**
+  * @brief  Returns the memory buffer currently used by a double buffer transfer
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  0 if stream is filling/draining mem0, 1 if mem1
+ */
+uint32_t hal_dma_get_current_target(dma_handle_t *hdma);
+
+
+/**
+  * @brief  Stops an on going DMA transfer
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_abort(dma_handle_t *hdma);
+
+
+/**
+  * @brief  Returns the number of data items remaining to be transferred (NDTR)
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  remaining data items
+ */
+uint32_t hal_dma_get_counter(dma_handle_t *hdma);
+
+
+/**
+  * @brief  This API handles the DMA stream interrupt request
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void hal_dma_irq_handler(dma_handle_t *hdma);
+
+#endif
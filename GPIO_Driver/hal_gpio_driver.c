@@ -126,18 +126,11 @@ uint8_t hal_gpio_read_from_pin(GPIO_TypeDef *GPIOx, uint16_t pin_no)
 **/
 void hal_gpio_write_to_pin(GPIO_TypeDef *GPIOx, uint16_t pin_no, uint8_t value)
 {
+	/* BSRR write is atomic, so pin can be driven from ISR and thread context without lost updates */
 	if(value)
-		GPIOx->ODR |= (1 << pin_no);
+		GPIOx->BSRR = ((uint32_t)1 << pin_no); 
 	else
-		GPIOx->ODR &= ~(1 << pin_no); 
-	
-	/* if(value)
-		GPIOx->BSRR = (1 << pin_no); 
-	else
-		GPIOx->BSRR = (1 << (2 * pin_no));*/
-	
-	
-	
+		GPIOx->BSRR = ((uint32_t)1 << (pin_no + 16));
 }
 
 /**
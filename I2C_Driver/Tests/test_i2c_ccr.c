@@ -0,0 +1,93 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_ccr.c
+  * @author  Sharath N
+  * @brief   Host test of the CCR/TRISE computation against the RM0090 examples and the supported PCLK1/SCL ranges.
+***************************************************************************************************************************/
+
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+#define FM              I2C_REG_CCR_ENABLE_FM
+#define DUTY            I2C_REG_CCR_DUTY
+
+typedef struct
+{
+	uint32_t pclk;
+	uint32_t clkspeed;
+	uint32_t duty_cycle;
+	uint32_t ccr;          /* Expected CCR including F/S and DUTY */
+	uint32_t trise;        /* Expected TRISE */
+} ccr_case_t;
+
+static const ccr_case_t ccr_cases[] =
+{
+	/* Standard mode */
+	{  8000000, 100000, I2C_FM_DUTY_2,      0x28, 9 },             /* RM0090 CCR and TRISE examples, FREQ = 8 */
+	{  2000000, 100000, I2C_FM_DUTY_2,        10, 3 },             /* Slowest PCLK1 */
+	{ 16000000, 100000, I2C_FM_DUTY_2,        80, 17 },            /* HSI */
+	{ 42000000, 100000, I2C_FM_DUTY_2,       210, 43 },            /* APB1 at 168 MHz SYSCLK */
+	{ 42000000,  10000, I2C_FM_DUTY_2,      2100, 43 },
+	{ 42000000,   6000, I2C_FM_DUTY_2,      3500, 43 },
+	{ 42000000,  30000, I2C_FM_DUTY_2,       700, 43 },            /* Duty cycle is ignored in standard mode */
+	
+	/* Fast mode, Thigh/Tlow = 1/2 */
+	{  4000000, 400000, I2C_FM_DUTY_2,    FM | 4, 2 },             /* Slowest PCLK1 for fast mode */
+	{ 42000000, 400000, I2C_FM_DUTY_2,   FM | 35, 13 },
+	{ 42000000, 200000, I2C_FM_DUTY_2,   FM | 70, 13 },
+	
+	/* Fast mode, Thigh/Tlow = 9/16 */
+	{ 10000000, 400000, I2C_FM_DUTY_16BY9, FM | DUTY | 1, 4 },     /* Exact 400 kHz needs PCLK1 multiple of 10 MHz */
+	{ 42000000, 400000, I2C_FM_DUTY_16BY9, FM | DUTY | 5, 13 },
+};
+
+static void test_ccr_table(void)
+{
+	uint32_t i, ccr, trise;
+	
+	for(i = 0; i < sizeof(ccr_cases) / sizeof(ccr_cases[0]); i++)
+	{
+		const ccr_case_t *c = &ccr_cases[i];
+		
+		ccr = 0xDEAD;
+		trise = 0xDEAD;
+		
+		CHECK_EQ(hal_i2c_compute_timing(c->pclk, c->clkspeed, c->duty_cycle, &ccr, &trise), 0);
+		CHECK_EQ(ccr, c->ccr);
+		CHECK_EQ(trise, c->trise);
+		CHECK(trise <= I2C_REG_TRISE_MASK);
+	}
+}
+
+static void test_ccr_invalid(void)
+{
+	uint32_t ccr = 0xDEAD, trise = 0xDEAD;
+	
+	/* ClockSpeed 0 would divide by zero */
+	CHECK_EQ(hal_i2c_compute_timing(42000000, 0, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	
+	/* Above fast mode */
+	CHECK_EQ(hal_i2c_compute_timing(42000000, 400001, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	CHECK_EQ(hal_i2c_compute_timing(42000000, 1000000, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	
+	/* PCLK1 out of range */
+	CHECK_EQ(hal_i2c_compute_timing(1000000, 100000, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	CHECK_EQ(hal_i2c_compute_timing(48000000, 100000, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	
+	/* Fast mode below 4 MHz */
+	CHECK_EQ(hal_i2c_compute_timing(3000000, 400000, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	
+	/* CCR above 12 bits */
+	CHECK_EQ(hal_i2c_compute_timing(42000000, 5000, I2C_FM_DUTY_2, &ccr, &trise), 1);
+	
+	/* Nothing is written on failure */
+	CHECK_EQ(ccr, 0xDEAD);
+	CHECK_EQ(trise, 0xDEAD);
+}
+
+int main(void)
+{
+	test_ccr_table();
+	test_ccr_invalid();
+	
+	return TEST_RESULT();
+}
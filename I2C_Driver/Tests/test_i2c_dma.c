@@ -0,0 +1,150 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_dma.c
+  * @author  Sharath N
+  * @brief   Host test of master DMA transfers, the address phase runs on the event interrupt and the data phase on
+  *          the DMA stream. TX completes on BTF after the stream, RX with LAST set completes from the stream.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "fake_dma.h"
+#include "test_assert.h"
+
+#define CR2_INT_ENABLES         (I2C_REG_CR2_BUF_INT_ENABLE | I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE)
+
+static i2c_handle_t hi2c;
+static dma_handle_t hdmatx, hdmarx;
+static uint8_t tx_data[4] = {0x11, 0x22, 0x33, 0x44};
+static uint8_t rx_data[4];
+
+static uint32_t tx_done, rx_done, errors;
+
+static void tx_cb(void *ptr)
+{
+	(void)ptr;
+	tx_done++;
+}
+
+static void rx_cb(void *ptr)
+{
+	(void)ptr;
+	rx_done++;
+}
+
+static void error_cb(void *ptr)
+{
+	(void)ptr;
+	errors++;
+}
+
+static void i2c_setup(void)
+{
+	memset(&hi2c, 0, sizeof(hi2c));
+	memset(&hdmatx, 0, sizeof(hdmatx));
+	memset(&hdmarx, 0, sizeof(hdmarx));
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	
+	hdmatx.Instance = DMA1_Stream6;
+	hdmatx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdmarx.Instance = DMA1_Stream0;
+	hdmarx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	
+	hi2c.Instance = I2C1;
+	hi2c.hdmatx = &hdmatx;
+	hi2c.hdmarx = &hdmarx;
+	hi2c.tx_comp_cb = tx_cb;
+	hi2c.rx_comp_cb = rx_cb;
+	hi2c.error_cb = error_cb;
+	
+	fake_dma_reset();
+	tx_done = 0;
+	rx_done = 0;
+	errors = 0;
+}
+
+/* START and address phase, after ADDR the event interrupt is left to the stream */
+static void address_phase(uint8_t address)
+{
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	CHECK_EQ(I2C1->CR2 & CR2_INT_ENABLES, I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE);
+	
+	I2C1->SR1 = I2C_REG_SR1_SB_FLAG;
+	I2C1->CR1 &= ~I2C_REG_CR1_START_GEN;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(I2C1->DR, address);
+	
+	I2C1->SR1 = I2C_REG_SR1_ADDR_SENT_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_EVT_INT_ENABLE, 0);
+}
+
+/* DMA TX : stream writes DR, BTF of the last byte sends STOP */
+static void test_master_tx_dma(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_tx_dma(&hi2c, 0xA0, tx_data, sizeof(tx_data));
+	CHECK_EQ(fake_dma_start_count, 1);
+	CHECK_EQ(hdmatx.Instance->PAR, (uint32_t)&I2C1->DR);
+	CHECK_EQ(hdmatx.Instance->M0AR, (uint32_t)tx_data);
+	CHECK_EQ(hdmatx.Instance->NDTR, sizeof(tx_data));
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST), I2C_REG_CR2_DMAEN);
+	
+	address_phase(0xA0);
+	CHECK_EQ(tx_done, 0);
+	
+	/* Last byte is in DR, BTF is needed before STOP */
+	fake_dma_complete(&hdmatx);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_DMAEN, 0);
+	CHECK(I2C1->CR2 & I2C_REG_CR2_EVT_INT_ENABLE);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_STOP_GEN, 0);
+	CHECK_EQ(tx_done, 0);
+	
+	I2C1->SR1 = I2C_REG_SR1_TXE_FLAG | I2C_REG_SR1_BTF_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	CHECK(I2C1->CR1 & I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(hi2c.DmaActive, 0);
+	CHECK(hi2c.pBuffPtr == &tx_data[sizeof(tx_data)]);
+	CHECK_EQ(I2C1->CR2 & CR2_INT_ENABLES, 0);
+}
+
+/* DMA RX : LAST makes the hardware NACK the final byte, stream completion sends STOP */
+static void test_master_rx_dma(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_rx_dma(&hi2c, 0xA1, rx_data, sizeof(rx_data));
+	CHECK_EQ(fake_dma_start_count, 1);
+	CHECK_EQ(hdmarx.Instance->PAR, (uint32_t)&I2C1->DR);
+	CHECK_EQ(hdmarx.Instance->M0AR, (uint32_t)rx_data);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST), I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST);
+	CHECK_EQ(I2C1->CR1 & (I2C_REG_CR1_ACK | I2C_REG_CR1_POS), I2C_REG_CR1_ACK);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_ACK, I2C_REG_CR1_ACK);
+	CHECK_EQ(rx_done, 0);
+	
+	fake_dma_complete(&hdmarx);
+	
+	CHECK(I2C1->CR1 & I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST), 0);
+	CHECK_EQ(rx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(hi2c.DmaActive, 0);
+	CHECK_EQ(hi2c.XferCount, 0);
+	CHECK(hi2c.pBuffPtr == &rx_data[sizeof(rx_data)]);
+	CHECK_EQ(I2C1->CR2 & CR2_INT_ENABLES, 0);
+}
+
+int main(void)
+{
+	test_master_tx_dma();
+	test_master_rx_dma();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_init.c
+  * @author  Sharath N
+  * @brief   Host test of the own address configuration done by hal_i2c_init.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+static i2c_handle_t hi2c;
+
+/* PCLK1 is HSI with the RCC registers at reset value */
+static void i2c_setup(uint32_t addr_mode, uint32_t own_address)
+{
+	memset(&hi2c, 0, sizeof(hi2c));
+	
+	hi2c.Instance = I2C1;
+	hi2c.Init.ClockSpeed = 100000;
+	hi2c.Init.AddressingMode = addr_mode;
+	hi2c.Init.OwnAddress1 = own_address;
+}
+
+/* 7 bit address is masked and replaces a 10 bit one completely */
+static void test_own_address_7bit(void)
+{
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	I2C1->OAR1 = I2C_REG_OAR1_ADDRMODE | I2C_REG_OAR1_10BIT_ADDRESS_MASK;
+	
+	i2c_setup(I2C_ADDRMODE_7BIT, 0xF3);
+	hal_i2c_init(&hi2c);
+	
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_NONE);
+	CHECK_EQ(I2C1->OAR1, I2C_REG_OAR1_14TH_BIT | (0x73 << 1));
+}
+
+static void test_own_address_10bit(void)
+{
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	
+	i2c_setup(I2C_ADDRMODE_10BIT, 0x2F5);
+	hal_i2c_init(&hi2c);
+	
+	CHECK_EQ(I2C1->OAR1, I2C_REG_OAR1_ADDRMODE | I2C_REG_OAR1_14TH_BIT | 0x2F5);
+	
+	/* Back to 7 bit */
+	i2c_setup(I2C_ADDRMODE_7BIT, 0x42);
+	hal_i2c_init(&hi2c);
+	
+	CHECK_EQ(I2C1->OAR1, I2C_REG_OAR1_14TH_BIT | (0x42 << 1));
+}
+
+int main(void)
+{
+	test_own_address_7bit();
+	test_own_address_10bit();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,138 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_master.c
+  * @author  Sharath N
+  * @brief   Host test of the master transmitter, address only transfers and the bus check before START.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+static i2c_handle_t hi2c;
+
+static uint32_t tx_done, errors;
+
+static void tx_cb(void *ptr)
+{
+	tx_done++;
+}
+
+static void error_cb(void *ptr)
+{
+	errors++;
+}
+
+static void i2c_setup(void)
+{
+	memset(&hi2c, 0, sizeof(hi2c));
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	
+	hi2c.Instance = I2C1;
+	hi2c.tx_comp_cb = tx_cb;
+	hi2c.error_cb = error_cb;
+	
+	tx_done = 0;
+	errors = 0;
+}
+
+/* Zero length write sends the address and ends with STOP once the slave ACKed it */
+static void test_master_tx_address_only(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_tx(&hi2c, 0xA0, 0, 0);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	
+	I2C1->SR1 = I2C_REG_SR1_SB_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(I2C1->DR, 0xA0);
+	CHECK_EQ(tx_done, 0);
+	
+	I2C1->SR1 = I2C_REG_SR1_ADDR_SENT_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	CHECK(I2C1->CR1 & I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_BUF_INT_ENABLE | I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE), 0);
+}
+
+/* START is not requested while the previous STOP is pending or the bus is busy */
+static void test_master_start_bus_check(void)
+{
+	uint8_t data = 0x55;
+	
+	i2c_setup();
+	
+	/* STOP never clears */
+	I2C1->CR1 = I2C_REG_CR1_STOP_GEN;
+	hal_i2c_master_tx(&hi2c, 0xA0, &data, 1);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(errors, 1);
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_BUSY);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	
+	/* STOP is out but an other master holds the bus */
+	I2C1->CR1 = 0;
+	I2C1->SR2 = I2C_REG_SR2_BUS_BUSY_FLAG;
+	hal_i2c_master_tx(&hi2c, 0xA0, &data, 1);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(errors, 2);
+	
+	/* Bus free */
+	I2C1->SR2 = 0;
+	hal_i2c_master_tx(&hi2c, 0xA0, &data, 1);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	CHECK_EQ(errors, 2);
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_NONE);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_BUSY_TX);
+}
+
+/* With a timeout the START waits for the bus on the tick instead of failing */
+static void test_master_start_deferred(void)
+{
+	uint8_t data = 0x55;
+	
+	i2c_setup();
+	hi2c.Timeout = 2;
+	
+	/* STOP is still being sent when the next transfer is requested */
+	I2C1->CR1 = I2C_REG_CR1_STOP_GEN;
+	hal_i2c_master_tx(&hi2c, 0xA0, &data, 1);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_BUSY_TX);
+	CHECK_EQ(hi2c.StartPending, 1);
+	
+	I2C1->CR1 = 0;
+	hal_i2c_timeout_tick(&hi2c);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	CHECK(I2C1->CR2 & I2C_REG_CR2_EVT_INT_ENABLE);
+	CHECK_EQ(hi2c.StartPending, 0);
+	CHECK_EQ(errors, 0);
+	
+	/* An other master keeps the bus for longer than the timeout */
+	i2c_setup();
+	hi2c.Timeout = 2;
+	I2C1->SR2 = I2C_REG_SR2_BUS_BUSY_FLAG;
+	hal_i2c_master_tx(&hi2c, 0xA0, &data, 1);
+	hal_i2c_timeout_tick(&hi2c);
+	CHECK_EQ(errors, 0);
+	hal_i2c_timeout_tick(&hi2c);
+	
+	CHECK_EQ(errors, 1);
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_BUSY);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(hi2c.StartPending, 0);
+	CHECK_EQ(I2C1->CR1 & (I2C_REG_CR1_START_GEN | I2C_REG_CR1_STOP_GEN), 0);
+}
+
+int main(void)
+{
+	test_master_tx_address_only();
+	test_master_start_bus_check();
+	test_master_start_deferred();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,221 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_master_rx.c
+  * @author  Sharath N
+  * @brief   Host test of the master receiver event sequences of RM0090 27.3.3 for 1, 2, 3 and more bytes, and of
+  *          the repeated START of a register read. ACK/POS/STOP are checked after every event.
+  *          A RAM DR holds one value, so the two bytes read on the last BTF are the same.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+#define CR1_ACK_POS_STOP        (I2C_REG_CR1_ACK | I2C_REG_CR1_POS | I2C_REG_CR1_STOP_GEN)
+
+static i2c_handle_t hi2c;
+static uint8_t rx_data[8];
+
+static uint32_t rx_done, errors;
+
+static void rx_cb(void *ptr)
+{
+	(void)ptr;
+	rx_done++;
+}
+
+static void error_cb(void *ptr)
+{
+	(void)ptr;
+	errors++;
+}
+
+static void i2c_setup(void)
+{
+	memset(&hi2c, 0, sizeof(hi2c));
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	memset(rx_data, 0, sizeof(rx_data));
+	
+	hi2c.Instance = I2C1;
+	hi2c.rx_comp_cb = rx_cb;
+	hi2c.error_cb = error_cb;
+	
+	rx_done = 0;
+	errors = 0;
+}
+
+static void event(uint32_t sr1, uint8_t dr)
+{
+	I2C1->DR = dr;
+	I2C1->SR1 = sr1;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+}
+
+/* START and address phase of a read, ADDR is handled by hal_i2c_master_rx_handle_addr */
+static void address_phase(uint8_t address)
+{
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	
+	I2C1->SR1 = I2C_REG_SR1_SB_FLAG;
+	I2C1->CR1 &= ~I2C_REG_CR1_START_GEN;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(I2C1->DR, address);
+	
+	I2C1->SR1 = I2C_REG_SR1_ADDR_SENT_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+}
+
+/* Checks the end of a reception */
+static void check_complete(uint32_t len)
+{
+	CHECK_EQ(rx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(hi2c.XferCount, 0);
+	CHECK(hi2c.pBuffPtr == &rx_data[len]);
+	CHECK_EQ(I2C1->CR1 & (I2C_REG_CR1_POS | I2C_REG_CR1_STOP_GEN), I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_BUF_INT_ENABLE | I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE), 0);
+}
+
+/* N = 1 : NACK and STOP are programmed on ADDR, the byte is read on RXNE */
+static void test_master_rx_1(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_rx(&hi2c, 0xA1, rx_data, 1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_ACK);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(rx_done, 0);
+	
+	event(I2C_REG_SR1_RXNE_FLAG, 0x11);
+	CHECK_EQ(rx_data[0], 0x11);
+	check_complete(1);
+}
+
+/* N = 2 : POS with ACK cleared on ADDR, both bytes are read on BTF after STOP */
+static void test_master_rx_2(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_rx(&hi2c, 0xA1, rx_data, 2);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_POS);
+	
+	/* RXNE of the first byte only stops the buffer interrupt, byte waits in DR */
+	event(I2C_REG_SR1_RXNE_FLAG, 0x11);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE, 0);
+	CHECK_EQ(hi2c.XferCount, 2);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_POS);
+	
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x22);
+	CHECK_EQ(rx_data[0], 0x22);
+	CHECK_EQ(rx_data[1], 0x22);
+	check_complete(2);
+}
+
+/* N = 3 : ACK is kept on ADDR, cleared on the first BTF, STOP on the second */
+static void test_master_rx_3(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_rx(&hi2c, 0xA1, rx_data, 3);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_ACK);
+	
+	event(I2C_REG_SR1_RXNE_FLAG, 0x11);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE, 0);
+	CHECK_EQ(hi2c.XferCount, 3);
+	
+	/* Byte 1 in DR, byte 2 in shift register */
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x11);
+	CHECK_EQ(rx_data[0], 0x11);
+	CHECK_EQ(hi2c.XferCount, 2);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, 0);
+	CHECK_EQ(rx_done, 0);
+	
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x22);
+	CHECK_EQ(rx_data[1], 0x22);
+	CHECK_EQ(rx_data[2], 0x22);
+	check_complete(3);
+}
+
+/* N > 3 : bytes are read on RXNE until 3 are left, then as for N = 3 */
+static void test_master_rx_5(void)
+{
+	i2c_setup();
+	
+	hal_i2c_master_rx(&hi2c, 0xA1, rx_data, 5);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_ACK);
+	
+	event(I2C_REG_SR1_RXNE_FLAG, 0x11);
+	event(I2C_REG_SR1_RXNE_FLAG, 0x22);
+	CHECK_EQ(hi2c.XferCount, 3);
+	CHECK(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_ACK);
+	
+	event(I2C_REG_SR1_RXNE_FLAG, 0x33);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE, 0);
+	CHECK_EQ(hi2c.XferCount, 3);
+	
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x33);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, 0);
+	
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x44);
+	CHECK_EQ(rx_data[0], 0x11);
+	CHECK_EQ(rx_data[1], 0x22);
+	CHECK_EQ(rx_data[2], 0x33);
+	CHECK_EQ(rx_data[3], 0x44);
+	CHECK_EQ(rx_data[4], 0x44);
+	CHECK_EQ(rx_data[5], 0x00);
+	check_complete(5);
+}
+
+/* Register read : address write, repeated START without STOP, then a 2 byte read */
+static void test_mem_read_repeated_start(void)
+{
+	i2c_setup();
+	
+	hal_i2c_mem_read(&hi2c, 0xA0, 0x1234, I2C_MEMADD_SIZE_16BIT, rx_data, 2);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_BUSY_TX);
+	
+	address_phase(0xA0);
+	CHECK_EQ(rx_done, 0);
+	
+	event(I2C_REG_SR1_TXE_FLAG, 0);
+	CHECK_EQ(I2C1->DR, 0x12);
+	event(I2C_REG_SR1_TXE_FLAG, 0);
+	CHECK_EQ(I2C1->DR, 0x34);
+	CHECK_EQ(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE, 0);
+	
+	/* Last address byte is out, bus is turned around */
+	I2C1->SR1 = I2C_REG_SR1_TXE_FLAG | I2C_REG_SR1_BTF_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_BUSY_RX);
+	CHECK_EQ(I2C1->CR1 & (CR1_ACK_POS_STOP | I2C_REG_CR1_START_GEN), I2C_REG_CR1_ACK | I2C_REG_CR1_START_GEN);
+	CHECK(I2C1->CR2 & I2C_REG_CR2_BUF_INT_ENABLE);
+	
+	address_phase(0xA1);
+	CHECK_EQ(I2C1->CR1 & CR1_ACK_POS_STOP, I2C_REG_CR1_POS);
+	
+	event(I2C_REG_SR1_RXNE_FLAG, 0x55);
+	event(I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG, 0x55);
+	CHECK_EQ(rx_data[0], 0x55);
+	CHECK_EQ(rx_data[1], 0x55);
+	check_complete(2);
+}
+
+int main(void)
+{
+	test_master_rx_1();
+	test_master_rx_2();
+	test_master_rx_3();
+	test_master_rx_5();
+	test_mem_read_repeated_start();
+	
+	return TEST_RESULT();
+}
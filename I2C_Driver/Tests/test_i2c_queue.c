@@ -0,0 +1,230 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_queue.c
+  * @author  Sharath N
+  * @brief   Host test of the transaction queue, START of the next transaction, failures on a stuck bus,
+  *          priority of a submit from a callback and the device statistics.
+***************************************************************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+/* CCR of 10 kHz standard mode at the 16 MHz reset PCLK1 */
+#define TEST_CCR_10KHZ                                                 800
+
+static i2c_handle_t hi2c;
+static i2c_device_t dev;
+static i2c_transaction_t trans[4];
+static uint8_t tx_data[2] = {0x12, 0x34};
+
+static i2c_transaction_t *done[8];
+static uintptr_t done_stack[8];
+static uint32_t done_count;
+static i2c_transaction_t *resubmit;
+
+static void trans_cb(void *ptr)
+{
+	volatile uint8_t marker;
+	
+	/* Stack depth of the callback, a recursive queue would go deeper with every failed transaction */
+	done_stack[done_count] = (uintptr_t)&marker;
+	done[done_count++] = (i2c_transaction_t *)ptr;
+	
+	if(resubmit)
+	{
+		i2c_transaction_t *t = resubmit;
+		
+		resubmit = 0;
+		hal_i2c_submit(&hi2c, t);
+	}
+}
+
+static void i2c_setup(void)
+{
+	uint32_t i;
+	
+	memset(&hi2c, 0, sizeof(hi2c));
+	memset(&dev, 0, sizeof(dev));
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	
+	hi2c.Instance = I2C1;
+	dev.Address = 0xA0;
+	
+	for(i = 0; i < 4; i++)
+	{
+		memset(&trans[i], 0, sizeof(trans[i]));
+		trans[i].Device = &dev;
+		trans[i].pTxBuffer = tx_data;
+		trans[i].Len = 1;
+		trans[i].cb = trans_cb;
+	}
+	
+	done_count = 0;
+	resubmit = 0;
+}
+
+/* Runs the transaction on the bus up to BTF of its only byte, hardware clears START once it is sent */
+static void run_single_byte_write(void)
+{
+	I2C1->SR1 = I2C_REG_SR1_SB_FLAG;
+	I2C1->CR1 &= ~I2C_REG_CR1_START_GEN;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	I2C1->SR1 = I2C_REG_SR1_ADDR_SENT_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	I2C1->SR1 = I2C_REG_SR1_TXE_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	I2C1->SR1 = I2C_REG_SR1_BTF_FLAG | I2C_REG_SR1_TXE_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+}
+
+/* STOP makes it to the bus, the tick then requests the deferred START */
+static void release_stop(void)
+{
+	I2C1->CR1 &= ~I2C_REG_CR1_STOP_GEN;
+	hal_i2c_timeout_tick(&hi2c);
+}
+
+/* Next transaction is not started on top of a STOP which is still pending, on a slow bus it waits for it */
+static void test_next_start_waits_for_stop(void)
+{
+	i2c_device_t stats;
+	
+	i2c_setup();
+	I2C1->CCR = TEST_CCR_10KHZ;
+	hi2c.Timeout = 3;
+	
+	hal_i2c_submit(&hi2c, &trans[0]);
+	hal_i2c_submit(&hi2c, &trans[1]);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	
+	/* STOP of the first one is still on its way, START of the second one must not be requested yet */
+	run_single_byte_write();
+	
+	CHECK(I2C1->CR1 & I2C_REG_CR1_STOP_GEN);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(done_count, 1);
+	CHECK_EQ(hi2c.StartPending, 1);
+	CHECK_EQ(hi2c.QueueBusy, 1);
+	
+	/* Still not out on the next tick */
+	hal_i2c_timeout_tick(&hi2c);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(done_count, 1);
+	
+	release_stop();
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	CHECK_EQ(hi2c.StartPending, 0);
+	
+	run_single_byte_write();
+	CHECK_EQ(done_count, 2);
+	CHECK(done[0] == &trans[0]);
+	CHECK(done[1] == &trans[1]);
+	CHECK_EQ(trans[0].ErrorCode, HAL_I2C_ERROR_NONE);
+	CHECK_EQ(trans[1].ErrorCode, HAL_I2C_ERROR_NONE);
+	
+	/* Queue is drained once the last STOP is out */
+	release_stop();
+	CHECK_EQ(hi2c.QueueBusy, 0);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	
+	hal_i2c_get_device_stats(&dev, &stats);
+	CHECK_EQ(stats.XferCount, 2);
+	CHECK_EQ(stats.ErrorCount, 0);
+	CHECK_EQ(__get_PRIMASK(), 0);
+}
+
+/* Bus never becomes free and nothing retries, every pending transaction fails from the same stack depth */
+static void test_stuck_bus_fails_queue_iteratively(void)
+{
+	i2c_device_t stats;
+	uint32_t i;
+	
+	i2c_setup();
+	
+	hal_i2c_submit(&hi2c, &trans[0]);
+	for(i = 1; i < 4; i++)
+		hal_i2c_submit(&hi2c, &trans[i]);
+	
+	/* An other master grabs the bus, STOP of the first one never clears */
+	I2C1->SR2 = I2C_REG_SR2_BUS_BUSY_FLAG;
+	run_single_byte_write();
+	
+	CHECK_EQ(done_count, 4);
+	CHECK_EQ(trans[0].ErrorCode, HAL_I2C_ERROR_NONE);
+	for(i = 1; i < 4; i++)
+	{
+		CHECK(done[i] == &trans[i]);
+		CHECK_EQ(trans[i].ErrorCode, HAL_I2C_ERROR_BUSY);
+		CHECK_EQ(done_stack[i], done_stack[1]);
+	}
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_START_GEN, 0);
+	CHECK_EQ(hi2c.QueueBusy, 0);
+	CHECK_EQ(hi2c.QueueStarting, 0);
+	
+	hal_i2c_get_device_stats(&dev, &stats);
+	CHECK_EQ(stats.XferCount, 4);
+	CHECK_EQ(stats.ErrorCount, 3);
+	CHECK_EQ(__get_PRIMASK(), 0);
+	
+	/* Bus is usable again */
+	I2C1->SR2 = 0;
+	I2C1->CR1 &= ~I2C_REG_CR1_STOP_GEN;
+	hal_i2c_submit(&hi2c, &trans[0]);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_START_GEN);
+	run_single_byte_write();
+	CHECK_EQ(done_count, 5);
+	CHECK_EQ(trans[0].ErrorCode, HAL_I2C_ERROR_NONE);
+}
+
+/* Submit from a callback may overtake the next transaction, it is not on the bus yet */
+static void test_submit_from_callback_by_priority(void)
+{
+	i2c_setup();
+	hi2c.Timeout = 3;
+	
+	trans[2].Priority = 5;
+	
+	hal_i2c_submit(&hi2c, &trans[0]);
+	hal_i2c_submit(&hi2c, &trans[1]);
+	
+	/* Higher priority one is queued from the completion of the first one */
+	resubmit = &trans[2];
+	run_single_byte_write();
+	CHECK_EQ(done_count, 1);
+	
+	release_stop();
+	run_single_byte_write();
+	release_stop();
+	run_single_byte_write();
+	release_stop();
+	
+	CHECK_EQ(done_count, 3);
+	CHECK(done[0] == &trans[0]);
+	CHECK(done[1] == &trans[2]);
+	CHECK(done[2] == &trans[1]);
+	CHECK_EQ(hi2c.QueueBusy, 0);
+	
+	/* Submit while a transaction is on the bus still goes behind it */
+	hal_i2c_submit(&hi2c, &trans[0]);
+	hal_i2c_submit(&hi2c, &trans[2]);
+	run_single_byte_write();
+	release_stop();
+	run_single_byte_write();
+	
+	CHECK_EQ(done_count, 5);
+	CHECK(done[3] == &trans[0]);
+	CHECK(done[4] == &trans[2]);
+}
+
+int main(void)
+{
+	test_next_start_waits_for_stop();
+	test_stuck_bus_fails_queue_iteratively();
+	test_submit_from_callback_by_priority();
+	
+	return TEST_RESULT();
+}
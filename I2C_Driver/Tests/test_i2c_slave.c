@@ -0,0 +1,142 @@
+/***************************************************************************************************************************
+  * @file    test_i2c_slave.c
+  * @author  Sharath N
+  * @brief   Host test of the slave transmitter, the master NACK on the last byte completes the transfer,
+  *          and of the slave receiver which is completed by the STOP of the master.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_i2c_driver.h"
+#include "test_assert.h"
+
+static i2c_handle_t hi2c;
+static uint8_t tx_data[3] = {0x11, 0x22, 0x33};
+
+static uint32_t tx_done, rx_done, errors;
+
+static void tx_cb(void *ptr)
+{
+	tx_done++;
+}
+
+static void rx_cb(void *ptr)
+{
+	rx_done++;
+}
+
+static void error_cb(void *ptr)
+{
+	errors++;
+}
+
+static void i2c_setup(void)
+{
+	memset(&hi2c, 0, sizeof(hi2c));
+	memset((void *)I2C1, 0, sizeof(*I2C1));
+	
+	hi2c.Instance = I2C1;
+	hi2c.tx_comp_cb = tx_cb;
+	hi2c.rx_comp_cb = rx_cb;
+	hi2c.error_cb = error_cb;
+	
+	tx_done = 0;
+	rx_done = 0;
+	errors = 0;
+}
+
+/* Master reads the given number of bytes, then NACKs */
+static void master_reads(uint32_t count)
+{
+	while(count--)
+	{
+		I2C1->SR1 = I2C_REG_SR1_TXE_FLAG;
+		hal_i2c_handle_evt_interrupt(&hi2c);
+	}
+	
+	I2C1->SR1 = I2C_REG_SR1_AF_FAILURE_FLAG;
+	hal_i2c_handle_error_interrupt(&hi2c);
+}
+
+/* Whole buffer read, NACK of the last byte is the normal end */
+static void test_slave_tx_complete(void)
+{
+	i2c_setup();
+	
+	hal_i2c_slave_tx(&hi2c, tx_data, sizeof(tx_data));
+	master_reads(3);
+	
+	CHECK_EQ(I2C1->DR, 0x33);
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_NONE);
+	CHECK_EQ(hi2c.XferCount, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(I2C1->SR1 & I2C_REG_SR1_AF_FAILURE_FLAG, 0);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_BUF_INT_ENABLE | I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE), 0);
+}
+
+/* Master stops early, still completed, bytes not read are left in XferCount */
+static void test_slave_tx_short_read(void)
+{
+	i2c_setup();
+	
+	hal_i2c_slave_tx(&hi2c, tx_data, sizeof(tx_data));
+	master_reads(1);
+	
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.ErrorCode, HAL_I2C_ERROR_NONE);
+	CHECK_EQ(hi2c.XferCount, 2);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+}
+
+/* Master writes 3 bytes, last one is taken on BTF, STOPF completes the reception */
+static void test_slave_rx_complete_on_stop(void)
+{
+	uint8_t rx_data[4] = {0};
+	
+	i2c_setup();
+	
+	hal_i2c_slave_rx(&hi2c, rx_data, 3);
+	CHECK(I2C1->CR1 & I2C_REG_CR1_ACK);
+	
+	I2C1->SR1 = I2C_REG_SR1_ADDR_MATCHED_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	CHECK_EQ(hi2c.SlaveAddrMatch, I2C_SLAVE_ADDR_OWN1);
+	
+	I2C1->DR = 0x11;
+	I2C1->SR1 = I2C_REG_SR1_RXNE_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	I2C1->DR = 0x22;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	I2C1->DR = 0x33;
+	I2C1->SR1 = I2C_REG_SR1_RXNE_FLAG | I2C_REG_SR1_BTF_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	CHECK_EQ(hi2c.XferCount, 0);
+	CHECK_EQ(rx_done, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_BUSY_RX);
+	
+	I2C1->SR1 = I2C_REG_SR1_STOP_DETECTION_FLAG;
+	hal_i2c_handle_evt_interrupt(&hi2c);
+	
+	CHECK_EQ(rx_data[0], 0x11);
+	CHECK_EQ(rx_data[1], 0x22);
+	CHECK_EQ(rx_data[2], 0x33);
+	CHECK_EQ(rx_data[3], 0x00);
+	CHECK_EQ(rx_done, 1);
+	CHECK_EQ(tx_done, 0);
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(hi2c.State, HAL_I2C_STATE_READY);
+	CHECK_EQ(I2C1->CR1 & I2C_REG_CR1_ACK, 0);
+	CHECK_EQ(I2C1->CR2 & (I2C_REG_CR2_BUF_INT_ENABLE | I2C_REG_CR2_EVT_INT_ENABLE | I2C_REG_CR2_ERR_INT_ENABLE), 0);
+}
+
+int main(void)
+{
+	test_slave_tx_complete();
+	test_slave_tx_short_read();
+	test_slave_rx_complete_on_stop();
+	
+	return TEST_RESULT();
+}
@@ -7,8 +7,13 @@
 
 #include <stdint.h>
 #include "hal_i2c_driver.h"
+#include "hal_rcc_driver.h"
 #include "led.h"
 
+static void hal_i2c_queue_next(i2c_handle_t *hi2c);
+static void hal_i2c_error_cb(i2c_handle_t *I2Chandle);
+static void hal_i2c_dma_close(i2c_handle_t *hi2c);
+
 /***************************************************************************************************************************/
 /*                                                                                                                         */
 /*                                               Helper functions                                                          */
@@ -63,68 +68,88 @@ static void hal_i2c_manage_clock_stretch(I2C_TypeDef *i2cx, uint32_t no_stretch)
 
 
 /**
-  * @brief  Configure the own I2C device Clock configuration register
+  * @brief  Configure the own 7 bit I2C device address, OAR1 is written as a whole so bits left over
+  *         from a 10 bit address are cleared and bit 14 is kept at 1
   * @param  *i2cx : Base address of I2C peripheral
-  * @param  pclk : I2C peripherl clock frequency
+  * @param  own_address : address of the I2C device to be configured
   * @retval  none
  */
-static void hal_i2c_configure_ccr(I2C_TypeDef *i2cx, uint32_t pclk, uint32_t clkspeed,uint32_t duty_cycle)
+static void hal_i2c_set_own_address1(I2C_TypeDef *i2cx, uint32_t own_address)
 {
-	i2cx->CCR;
-	
-	
+	i2cx->OAR1 = I2C_REG_OAR1_14TH_BIT | ((own_address & I2C_REG_OAR1_7BIT_ADDRESS_MASK) << I2C_REG_OAR1_7BIT_ADDRESS_POS);
 }
 
 
+
 /**
-  * @brief  Configure the own I2C device address
+  * @brief  Configure the own 10 bit I2C device address and the 10 bit addressing mode, bit 14 is kept at 1
   * @param  *i2cx : Base address of I2C peripheral
-  * @param  own_address : address of the I2C device to be configured
+  * @param  own_address : 10 bit address of the I2C device to be configured
   * @retval  none
  */
-static void hal_i2c_set_own_address1(I2C_TypeDef *i2cx, uint32_t own_address)
+static void hal_i2c_set_own_address1_10bit(I2C_TypeDef *i2cx, uint32_t own_address)
+{
+	i2cx->OAR1 = I2C_REG_OAR1_ADDRMODE | I2C_REG_OAR1_14TH_BIT | (own_address & I2C_REG_OAR1_10BIT_ADDRESS_MASK);
+}
+
+
+
+/**
+  * @brief  Configure the second own address, slave then ACKs both OAR1 and OAR2. Only 7 bit addresses are supported.
+  * @param  *i2cx : Base address of I2C peripheral
+  * @param  dual_mode : I2C_DUALADDRESS_ENABLE or I2C_DUALADDRESS_DISABLE
+  * @param  own_address2 : 7 bit second address of the I2C device
+  * @retval  none
+ */
+static void hal_i2c_configure_dual_address(I2C_TypeDef *i2cx, uint32_t dual_mode, uint32_t own_address2)
 {
-	i2cx->OAR1 &=  ~((0x7f) << 1);  //Bit 1 to 7 are cleared  
-	i2cx->OAR1 |=  (own_address << 1); // Set the given 7-bit adrress from bit 1
+	uint32_t oar2 = (own_address2 << I2C_REG_OAR2_ADD2_POS) & I2C_REG_OAR2_ADD2_MASK;
+	
+	if(dual_mode == I2C_DUALADDRESS_ENABLE)
+	{
+		oar2 |= I2C_REG_OAR2_ENDUAL;
+	}
+	
+	i2cx->OAR2 = oar2;
 }
 
 
 
 /**
-  * @brief  Configure the I2C addressing mode either 7bit or 10bit
+  * @brief  Enable or disable the general call(address 0x00) response
   * @param  *i2cx : Base address of I2C peripheral
-  * @param  adr_mode : addressing mode to be configured.
+  * @param  gen_call : I2C_GENERALCALL_ENABLE or I2C_GENERALCALL_DISABLE
   * @retval  none
  */
-static void hal_i2c_set_addressing_mode(I2C_TypeDef *i2cx, uint32_t adr_mode)
+static void hal_i2c_configure_general_call(I2C_TypeDef *i2cx, uint32_t gen_call)
 {
-	if(adr_mode == I2C_ADDRMODE_10BIT)
+	if(gen_call == I2C_GENERALCALL_ENABLE)
 	{
-		i2cx->OAR1 |= I2C_REG_OAR1_ADDRMODE;
+		i2cx->CR1 |= I2C_REG_CR1_ENGC;
 	}
 	else
 	{
-		i2cx->OAR1 &= ~I2C_REG_OAR1_ADDRMODE;
+		i2cx->CR1 &= ~I2C_REG_CR1_ENGC;
 	}
 }
 
 
 
 /**
-  * @brief  Configure the I2C Clock duty cycle in Fast Mode
+  * @brief  Enable or disable ACKing of received bytes and matched addresses
   * @param  *i2cx : Base address of I2C peripheral
-  * @param  duty_cycle : duty cycle to be configured. It could be either I2C_FM_DUTY_16BY9 or I2C_FM_DUTY_2.
+  * @param  ack : I2C_ACK_ENABLE or I2C_ACK_DISABLE
   * @retval  none
  */
-static void hal_i2c_set_fm_mode_duty_cycle(I2C_TypeDef *i2cx, uint32_t duty_cycle)
+static void hal_i2c_manage_ack(I2C_TypeDef *i2cx, uint32_t ack)
 {
-	if(duty_cycle == I2C_FM_DUTY_16BY9)
+	if(ack == I2C_ACK_ENABLE)
 	{
-		i2cx->CCR |= I2C_REG_CCR_DUTY;
+		i2cx->CR1 |= I2C_REG_CR1_ACK;
 	}
 	else
 	{
-		i2cx->CCR |= I2C_REG_CCR_DUTY;
+		i2cx->CR1 &= ~I2C_REG_CR1_ACK;
 	}
 }
 
@@ -135,15 +160,26 @@ static void hal_i2c_set_fm_mode_duty_cycle(I2C_TypeDef *i2cx, uint32_t duty_cycl
   * @param  *i2cx : Base address of I2C peripheral
   * @param  clkspeed: I2C clock speed
   * @param  duty_cycle : I2C duty cycle
-  * @retval  none
+  * @retval  0 if done, 1 if the SCL speed can not be generated from PCLK1, registers are left untouched then
  */
-static void hal_i2c_clk_init(I2C_TypeDef *i2cx, uint32_t clkspeed, uint32_t duty_cycle)
+static uint8_t hal_i2c_clk_init(I2C_TypeDef *i2cx, uint32_t clkspeed, uint32_t duty_cycle)
 {
-	uint32_t pclk = I2C_PERIPHERAL_CLK_FREQ_10MHZ;
-	i2cx->CR2 &= ~(0x3F);
-	i2cx->CR2 |= (pclk & 0x3F);
-	hal_i2c_configure_ccr(i2cx,pclk,clkspeed,duty_cycle);
-	//hal_i2c_rise_time_configuration(i2cx,pclk,clkspeed);
+	/* All I2C peripherals are on APB1 */
+	uint32_t pclk = hal_rcc_get_pclk1_freq();
+	uint32_t ccr, trise;
+	
+	if(hal_i2c_compute_timing(pclk, clkspeed, duty_cycle, &ccr, &trise))
+		return 1;
+	
+	/* CCR and TRISE can be written only while the peripheral is disabled */
+	hal_i2c_disable_peripheral(i2cx);
+	
+	i2cx->CR2 &= ~I2C_REG_CR2_FREQ_MASK;
+	i2cx->CR2 |= ((pclk / 1000000) & I2C_REG_CR2_FREQ_MASK);
+	i2cx->CCR = ccr;
+	i2cx->TRISE = trise;
+	
+	return 0;
 }
 
 
@@ -247,31 +283,6 @@ static uint8_t hal_i2c_is_bus_busy(I2C_TypeDef *i2cx)
 
 
 
-/**
-  * @brief  Call this function to wait until SB(start byte) flag is set.
-  * @param  *i2cx : Base address of I2C peripheral
-  * @retval  none
- */
-static void hal_i2c_wait_until_sb_set(I2C_TypeDef *i2cx)
-{
-	/* Wait until SB flag is set */
-	while( !(i2cx->SR1 & I2C_REG_SR1_SB_FLAG));
-}
-
-
-
-/**
-  * @brief  Call this function to wait until ADDR flag is set.
-  * @param  *i2cx : Base address of I2C peripheral
-  * @retval  none
- */
-static void hal_i2c_wait_until_addr_set(I2C_TypeDef *i2cx)
-{
-	/* Wait until SB flag is set */
-	while( !(i2cx->SR1 & I2C_REG_SR1_ADDR_SENT_FLAG));
-}
-
-
 /**
   * @brief  Clear addr flag
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
@@ -279,11 +290,9 @@ static void hal_i2c_wait_until_addr_set(I2C_TypeDef *i2cx)
  */
 static void hal_i2c_clear_addr_flag(i2c_handle_t *hi2c)
 {
-	uint32_t temp;
 	/*Clear ADDR flag */
-	temp = hi2c->Instance->SR1; //Read SR1
-	temp = hi2c->Instance->SR2; //Read SR2
-	
+	(void)hi2c->Instance->SR1; //Read SR1
+	(void)hi2c->Instance->SR2; //Read SR2
 }
 
 
@@ -295,11 +304,9 @@ static void hal_i2c_clear_addr_flag(i2c_handle_t *hi2c)
  */
 static void hal_i2c_clear_stop_flag(i2c_handle_t *hi2c)
 {
-	uint32_t temp;
-	/*Clear ADDR flag */
-  temp = hi2c->Instance->SR1; //Read SR1
+	/*Clear STOPF flag */
+	(void)hi2c->Instance->SR1; //Read SR1
 	hi2c->Instance->CR1 |= I2C_REG_CR1_ENABLE_I2C; //Write CR1
-	
 }
 
 
@@ -324,6 +331,10 @@ static void hal_i2c_slave_handle_stop_condition(i2c_handle_t *hi2c)
 	  hi2c->Instance->CR1 &= ~I2C_REG_CR1_ACK;
 	  
 	  hi2c->State = HAL_I2C_STATE_READY;
+	  
+	  /* Master ends a write to this slave with STOP */
+	  if(hi2c->rx_comp_cb)
+		  hi2c->rx_comp_cb(hi2c);
 }
 
 
@@ -340,6 +351,19 @@ static void hal_i2c_send_addr_first(I2C_TypeDef *i2cx, uint8_t slave_addr)
 
 
 
+/**
+  * @brief  Sends the next byte of the register address, MSB first
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_send_mem_address(i2c_handle_t *hi2c)
+{
+	hi2c->MemAddrLeft--;
+	hi2c->Instance->DR = (uint8_t)(hi2c->MemAddress >> (8 * hi2c->MemAddrLeft));
+}
+
+
+
 /**
   * @brief  Handle the TXE interrupt for the master
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
@@ -347,19 +371,53 @@ static void hal_i2c_send_addr_first(I2C_TypeDef *i2cx, uint8_t slave_addr)
  */
 static void hal_i2c_master_handle_TXE_interrupt(i2c_handle_t *hi2c)
 {
-	/* Write data to data register */
-	hi2c->Instance->DR = (*hi2c->pBuffPtr++);
-	hi2c->XferCount--;
+	if(hi2c->MemAddrLeft)
+	{
+		/* Register address goes out before any data */
+		hal_i2c_send_mem_address(hi2c);
+	}
+	else if(!hi2c->MemRead && hi2c->XferCount)
+	{
+		/* Write data to data register */
+		hi2c->Instance->DR = (*hi2c->pBuffPtr++);
+		hi2c->XferCount--;
+	}
 	
-	if(hi2c->XferCount == 0)
+	if(!hi2c->MemAddrLeft && (hi2c->MemRead || (hi2c->XferCount == 0)))
 	{
-		/*Disabled the buffer interrupt */
+		/*Disabled the buffer interrupt, STOP or repeated START is generated on BTF */
 		hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
 	}
 }
 
 
 
+/**
+  * @brief  Ends a master transmission with STOP
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_master_tx_complete(i2c_handle_t *hi2c)
+{
+	/* Disable buffer, event and error interrupt */
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
+	
+	/*Generate stop condition */
+	hi2c->Instance->CR1 |= I2C_REG_CR1_STOP_GEN;
+	
+	/*Since all bytes are sent make state as ready*/
+	hi2c->State = HAL_I2C_STATE_READY; 
+	
+	if(hi2c->QueueBusy)
+		hal_i2c_queue_next(hi2c);
+	else if(hi2c->tx_comp_cb)
+		hi2c->tx_comp_cb(hi2c);
+}
+
+
+
 /**
   * @brief  Handle BTF flag for master transmitter
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
@@ -367,7 +425,25 @@ static void hal_i2c_master_handle_TXE_interrupt(i2c_handle_t *hi2c)
  */
 static void hal_i2c_master_tx_handle_btf(i2c_handle_t *hi2c)
 {
-	if(hi2c->XferCount != 0)
+	if(hi2c->MemAddrLeft)
+	{
+		hal_i2c_send_mem_address(hi2c);
+	}
+	else if(hi2c->MemRead)
+	{
+		/* Register address is sent, turn the bus around with a repeated START, no STOP in between */
+		hi2c->MemRead = 0;
+		hi2c->DevAddress |= 0x01;
+		hi2c->State = HAL_I2C_STATE_BUSY_RX;
+		
+		hi2c->Instance->CR1 &= ~I2C_REG_CR1_POS;
+		hi2c->Instance->CR1 |= I2C_REG_CR1_ACK;
+		hal_i2c_configure_buffer_interrupt(hi2c->Instance,1);
+		
+		/*SB interrupt sends the address again, now for reading */
+		hal_i2c_generate_start_condition(hi2c->Instance);
+	}
+	else if(hi2c->XferCount != 0)
 	{
 		/*Write data to DR*/
 		hi2c->Instance->DR = (*hi2c->pBuffPtr++);
@@ -375,16 +451,7 @@ static void hal_i2c_master_tx_handle_btf(i2c_handle_t *hi2c)
 	}
 	else
 	{
-		/* Disable buffer, event and error interrupt */
-		hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
-		hi2c->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
-		hi2c->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
-		
-		/*Generate stop condition */
-		hi2c->Instance->CR1 |= I2C_REG_CR1_STOP_GEN;
-		
-		/*Since all bytes are sent make state as ready*/
-		hi2c->State = HAL_I2C_STATE_READY; 
+		hal_i2c_master_tx_complete(hi2c);
 	}		
 
 }
@@ -392,6 +459,120 @@ static void hal_i2c_master_tx_handle_btf(i2c_handle_t *hi2c)
 
 
 
+/**
+  * @brief  Master receiver ADDR event, ACK/POS/STOP have to be programmed before ADDR is cleared
+  *         when only 1 or 2 bytes are to be received (RM0090 27.3.3)
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_master_rx_handle_addr(i2c_handle_t *hi2c)
+{
+	if(hi2c->XferCount == 1)
+	{
+		/* Single byte is NACKed, STOP is sent right after it */
+		hi2c->Instance->CR1 &= ~I2C_REG_CR1_ACK;
+		hal_i2c_clear_addr_flag(hi2c);
+		hal_i2c_generate_stop_condition(hi2c->Instance);
+	}
+	else if(hi2c->XferCount == 2)
+	{
+		/* NACK goes to the byte in shift register, i.e the second one */
+		hi2c->Instance->CR1 &= ~I2C_REG_CR1_ACK;
+		hi2c->Instance->CR1 |= I2C_REG_CR1_POS;
+		hal_i2c_clear_addr_flag(hi2c);
+	}
+	else
+	{
+		hal_i2c_clear_addr_flag(hi2c);
+	}
+}
+
+
+
+/**
+  * @brief  Ends a master reception
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_master_rx_complete(i2c_handle_t *hi2c)
+{
+	/* Disable buffer, event and error interrupt */
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
+	
+	hi2c->Instance->CR1 &= ~I2C_REG_CR1_POS;
+	
+	hi2c->State = HAL_I2C_STATE_READY;
+	
+	if(hi2c->QueueBusy)
+		hal_i2c_queue_next(hi2c);
+	else if(hi2c->rx_comp_cb)
+		hi2c->rx_comp_cb(hi2c);
+}
+
+
+
+/**
+  * @brief  Handle the RXNE interrupt for the master
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_master_handle_RXNE_interrupt(i2c_handle_t *hi2c)
+{
+	if(hi2c->XferCount > 3)
+	{
+		/*read from DR*/
+		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
+		hi2c->XferCount--;
+	}
+	else if((hi2c->XferCount == 2) || (hi2c->XferCount == 3))
+	{
+		/* Last bytes are taken on BTF, so NACK and STOP are programmed while the clock is stretched */
+		hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+	}
+	else
+	{
+		/* Single byte reception, STOP was already programmed on ADDR */
+		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
+		hi2c->XferCount--;
+		
+		hal_i2c_master_rx_complete(hi2c);
+	}
+}
+
+
+
+/**
+  * @brief  Handle BTF flag for master receiver, DR holds byte N-2 or N-1 and shift register the next one
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_master_rx_handle_btf(i2c_handle_t *hi2c)
+{
+	if(hi2c->XferCount == 3)
+	{
+		/* Last byte is NACKed */
+		hi2c->Instance->CR1 &= ~I2C_REG_CR1_ACK;
+		
+		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
+		hi2c->XferCount--;
+	}
+	else
+	{
+		/* Byte N-1 in DR, byte N in shift register */
+		hal_i2c_generate_stop_condition(hi2c->Instance);
+		
+		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
+		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
+		hi2c->XferCount -= 2;
+		
+		hal_i2c_master_rx_complete(hi2c);
+	}
+}
+
+
+
 /**
   * @brief  Handle the TXE flag for the slave
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
@@ -405,6 +586,11 @@ static void hal_i2c_slave_handle_TXE_interrupt(i2c_handle_t *hi2c)
 		hi2c->Instance->DR = (*hi2c->pBuffPtr++);
 	  hi2c->XferCount--;
 	}
+	else
+	{
+		/* Master reads more than offered, keep the bus going until it NACKs */
+		hi2c->Instance->DR = 0xFF;
+	}
 }
 	
 
@@ -423,6 +609,11 @@ static void hal_i2c_slave_tx_handle_btf(i2c_handle_t *hi2c)
 		hi2c->Instance->DR = (*hi2c->pBuffPtr++);
 	  hi2c->XferCount--;
 	}
+	else
+	{
+		/* Master reads more than offered, keep the bus going until it NACKs */
+		hi2c->Instance->DR = 0xFF;
+	}
 }
 
 
@@ -440,6 +631,11 @@ static void hal_i2c_slave_handle_RXNE_interrupt(i2c_handle_t *hi2c)
 		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
 	  hi2c->XferCount--;
 	}
+	else
+	{
+		/* Master writes more than buffer can hold, drop the byte so RXNE/BTF does not fire forever */
+		(void)hi2c->Instance->DR;
+	}
 }
 
 
@@ -457,13 +653,19 @@ static void hal_i2c_slave_rx_handle_btf(i2c_handle_t *hi2c)
 		(*hi2c->pBuffPtr++) = hi2c->Instance->DR;
 	  hi2c->XferCount--;
 	}
+	else
+	{
+		/* Master writes more than buffer can hold, drop the byte so RXNE/BTF does not fire forever */
+		(void)hi2c->Instance->DR;
+	}
 }
 
 
 
 
 /**
-  * @brief  Handle AKC failure condition
+  * @brief  Handle AKC failure condition, completes the slave transmission.
+  *         XferCount is left with the number of bytes the master did not read, 0 if it read the whole buffer
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
   * @retval  none
  */
@@ -481,164 +683,823 @@ static void hal_i2c_slave_handle_ack_failure(i2c_handle_t *hi2c)
 	hi2c->Instance->CR1 &= ~I2C_REG_CR1_ACK;
 	
 	hi2c->State = HAL_I2C_STATE_READY;
+	
+	/* Master NACKs the last byte it wants from this slave */
+	if(hi2c->tx_comp_cb)
+		hi2c->tx_comp_cb(hi2c);
 }
 
 
 
 /**
-  * @brief  I2C error callbacks
-  * @param  I2Chandle : I2C handle
-  * @retval  none
+  * @brief  Checks that no STOP is pending and the bus is free, a START can be requested then
+  * @param  *i2cx : Base address of I2C peripheral
+  * @retval  returns 1 if START can be requested
  */
-void hal_i2c_error_cb(i2c_handle_t *I2Chandle)
+static uint8_t hal_i2c_is_bus_free(I2C_TypeDef *i2cx)
 {
-	while(1)
-	{
-		led_toggle(GPIOD, LED_RED);
-	}
+	/* START must not be requested while the STOP of the previous transfer is still pending (RM0090 27.6.1) */
+	if(i2cx->CR1 & I2C_REG_CR1_STOP_GEN)
+		return 0;
+	
+	return !hal_i2c_is_bus_busy(i2cx);
 }
 
 
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-/***********************************************************************************************************************************/
-/*                                                                                                                                 */
-/*                                               Driver Exposed APIs                                                               */
-/*                                                                                                                                 */
-/***********************************************************************************************************************************/
-
 /**
-  * @brief  Initializes the Given I2C peripherl
-  * @param  *handle : Handle to i2c peripheral, which the application wants to initialize.
-  * @retval  none
+  * @brief  Waits I2C_STOP_WAIT_SCL_PERIODS SCL periods at most for the bus to be free
+  * @param  *i2cx : Base address of I2C peripheral
+  * @retval  returns 1 if START can be requested
  */
-void hal_i2c_init(i2c_handle_t *handle)
+static uint8_t hal_i2c_wait_bus_free(I2C_TypeDef *i2cx)
 {
-	/* I2C Clock initializatio */
+	uint32_t ccr = i2cx->CCR;
+	uint32_t pclk = hal_rcc_get_pclk1_freq();
+	uint32_t scl, loops;
 	
-	/* Set I2C addressing mode */
-	
-	/* Enable ACking */
-	
-	/* Enable clock stretching */
+	/* SCL period in PCLK1 cycles, see hal_i2c_compute_timing */
+	if(!(ccr & I2C_REG_CCR_ENABLE_FM))
+		scl = 2 * (ccr & I2C_REG_CCR_CCR_MASK);
+	else if(ccr & I2C_REG_CCR_DUTY)
+		scl = 25 * (ccr & I2C_REG_CCR_CCR_MASK);
+	else
+		scl = 3 * (ccr & I2C_REG_CCR_CCR_MASK);
 	
-	/* Configure the own address */
+	/* A poll takes more than one CPU cycle, so counting one per poll never waits less than asked */
+	loops = scl * I2C_STOP_WAIT_SCL_PERIODS;
+	if(pclk)
+		loops *= (hal_rcc_get_hclk_freq() / pclk);
 	
-	/* Finally, enable the i2c peripheral */
+	while(!hal_i2c_is_bus_free(i2cx) && loops)
+		loops--;
 	
+	return hal_i2c_is_bus_free(i2cx);
 }
 
 
 
 /**
-  * @brief API to do master data transmission
-  * @param *handle: pointer to handle structure of I2C peripheral
-  * @param slave_address: address to whuch we want to TX.
-  * @param *buffer: hold the pointer to tx buffer 
-	* @param len: length of the data to be transmitted
-  * @retval none
+  * @brief  Enables the interrupts and requests START, SB interrupt then sends the address
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
  */
-void hal_i2c_master_tx(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+static void hal_i2c_master_generate_start(i2c_handle_t *hi2c)
 {
-	/*Populate the handle with tx buffer pointer and length information */
-	handle->pBuffPtr = buffer;
-	handle->XferCount = len;
-	handle->XferSize = len;
-	handle->State = HAL_I2C_STATE_BUSY_TX;
-	
 	/*Make sure the i2c is enabled */
-	hal_i2c_enable_peripheral(handle->Instance);
+	hal_i2c_enable_peripheral(hi2c->Instance);
 	
-	/*Generate the start condition */
-	hal_i2c_generate_start_condition(handle->Instance);
+	/*Enable buffer ,event and error interrupt, DMA moves the data so TXE/RXNE are not needed then */
+	hal_i2c_configure_buffer_interrupt(hi2c->Instance,!hi2c->DmaActive);
+	hal_i2c_configure_event_interrupt(hi2c->Instance,1);
+	hal_i2c_configure_error_interrupt(hi2c->Instance,1);
 	
-	/*Wiat till SB is set */
-	hal_i2c_wait_until_sb_set(handle->Instance);
-	
-	/*address phase : send 7 bit slave address with r/w bit */
-	hal_i2c_send_addr_first(handle->Instance, slave_address);
-	
-	/*Wait untill addr is set */
-  hal_i2c_wait_until_addr_set(handle->Instance);
-	
-	/*If you are here, then addr is set and clock is stretched and i2c is in wait state*/
-	/*Clear addr flag and make i2c come out of wait state*/
-	hal_i2c_clear_addr_flag(handle);
-	
-	/*Enable buffer ,event and error interrupt */
-	hal_i2c_configure_buffer_interrupt(handle->Instance,1);
-	hal_i2c_configure_event_interrupt(handle->Instance,1);
-	hal_i2c_configure_error_interrupt(handle->Instance,1);
-
+	/*Generate the start condition, SB interrupt sends the address */
+	hal_i2c_generate_start_condition(hi2c->Instance);
 }
 
 
 
-
-
 /**
-  * @brief API to do master data rception
-  * @param *handle: pointer to handle structure of I2C peripheral
-  * @param slave_address: address to whuch we want to TX.
-  * @param *buffer: hold the pointer to rx buffer 
-	* @param len: length of the data to be transmitted
-  * @retval none
+  * @brief  Starts a master transfer, SB and ADDR are handled by the event interrupt so nothing is waited for here
+  *         beyond a few SCL periods for the previous STOP. A busy bus is retried from hal_i2c_timeout_tick.
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
  */
-void hal_i2c_master_rx(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+static void hal_i2c_master_start(i2c_handle_t *hi2c)
 {
+	hi2c->TimeoutCount = hi2c->Timeout;
+	hi2c->StartPending = 0;
 	
-	/*Populate the handle with tx buffer pointer and length information */
-	handle->pBuffPtr = buffer;
-	handle->XferCount = len;
-	handle->XferSize = len;
-	handle->State = HAL_I2C_STATE_BUSY_RX;
+	if(!hal_i2c_wait_bus_free(hi2c->Instance))
+	{
+		/* Slow SCL, stretched STOP or an other master on the bus, the tick retries instead of spinning here */
+		if(hi2c->Timeout)
+		{
+			hi2c->StartPending = 1;
+			return;
+		}
+		
+		/* Nothing would retry, STOP never made it to the bus or an other master/stuck slave holds the bus */
+		hal_i2c_dma_close(hi2c);
+		
+		hi2c->ErrorCode |= HAL_I2C_ERROR_BUSY;
+		hi2c->State = HAL_I2C_STATE_READY;
+		
+		hal_i2c_error_cb(hi2c);
+		return;
+	}
 	
-	/*Make sure the i2c is enabled */
+	hal_i2c_master_generate_start(hi2c);
+}
+
+
+
+/**
+  * @brief  I2C error callbacks
+  * @param  I2Chandle : I2C handle
+  * @retval  none
+ */
+static void hal_i2c_error_cb(i2c_handle_t *I2Chandle)
+{
+	/* Failed transaction is handed back through its own callback, queue carries on */
+	if(I2Chandle->QueueBusy)
+	{
+		hal_i2c_queue_next(I2Chandle);
+		return;
+	}
+	
+	/* Let the application decide, ErrorCode is kept until next transfer starts */
+	if(I2Chandle->error_cb)
+	{
+		I2Chandle->error_cb(I2Chandle);
+		return;
+	}
+	
+	while(1)
+	{
+		led_toggle(GPIOD, LED_RED);
+	}
+}
+
+
+
+/**
+  * @brief  Makes sure the DMA stream moves single bytes between DR and an incrementing buffer
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+static void hal_i2c_dma_configure(dma_handle_t *hdma)
+{
+	if((hdma->Init.MemInc != 1) || (hdma->Init.PeriphInc != 0) ||
+		 (hdma->Init.MemDataAlignment != DMA_DATA_SIZE_BYTE) || (hdma->Init.PeriphDataAlignment != DMA_DATA_SIZE_BYTE))
+	{
+		hdma->Init.MemInc = 1;
+		hdma->Init.PeriphInc = 0;
+		hdma->Init.MemDataAlignment = DMA_DATA_SIZE_BYTE;
+		hdma->Init.PeriphDataAlignment = DMA_DATA_SIZE_BYTE;
+		hal_dma_init(hdma);
+	}
+}
+
+
+
+/**
+  * @brief  Disables the DMA requests and stops the streams of a DMA master transfer
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_dma_close(i2c_handle_t *hi2c)
+{
+	hi2c->Instance->CR2 &= ~(I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST);
+	
+	if(hi2c->DmaActive)
+	{
+		if(hi2c->hdmatx)
+			hal_dma_abort(hi2c->hdmatx);
+		
+		if(hi2c->hdmarx)
+			hal_dma_abort(hi2c->hdmarx);
+		
+		hi2c->DmaActive = 0;
+	}
+}
+
+
+
+/**
+  * @brief  TX DMA stream completion, last byte is in DR but not yet on the bus.
+  *         Event interrupt is enabled again so BTF generates STOP and completes the transfer.
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+static void hal_i2c_dma_tx_cplt(void *hdma)
+{
+	i2c_handle_t *hi2c = (i2c_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_DMAEN;
+	hi2c->DmaActive = 0;
+	
+	hi2c->pBuffPtr += hi2c->XferCount;
+	hi2c->XferCount = 0;
+	
+	hal_i2c_configure_event_interrupt(hi2c->Instance,1);
+}
+
+
+
+/**
+  * @brief  RX DMA stream completion, last byte is received and already NACKed because of LAST bit
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+static void hal_i2c_dma_rx_cplt(void *hdma)
+{
+	i2c_handle_t *hi2c = (i2c_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hal_i2c_generate_stop_condition(hi2c->Instance);
+	
+	hi2c->Instance->CR2 &= ~(I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST);
+	hi2c->DmaActive = 0;
+	
+	hi2c->pBuffPtr += hi2c->XferCount;
+	hi2c->XferCount = 0;
+	
+	hal_i2c_master_rx_complete(hi2c);
+}
+
+
+
+/**
+  * @brief  DMA stream error during a master transfer, bus is released
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+static void hal_i2c_dma_error(void *hdma)
+{
+	i2c_handle_t *hi2c = (i2c_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hal_i2c_dma_close(hi2c);
+	
+	/* Disable buffer, event and error interrupt */
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
+	hi2c->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
+	
+	hal_i2c_generate_stop_condition(hi2c->Instance);
+	
+	hi2c->ErrorCode |= HAL_I2C_ERROR_DMA;
+	hi2c->State = HAL_I2C_STATE_READY;
+	
+	hal_i2c_error_cb(hi2c);
+}
+
+
+
+/**
+  * @brief  Returns the time base of the queue latency statistics
+  * @retval  DWT cycle counter, 0 if statistics are disabled
+ */
+static uint32_t hal_i2c_queue_time(void)
+{
+#if I2C_QUEUE_LATENCY_STATS_ENABLE
+	return DWT->CYCCNT;
+#else
+	return 0;
+#endif
+}
+
+
+
+/**
+  * @brief  Removes the transaction at head of the queue, updates the device statistics and calls its callback
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_queue_complete(i2c_handle_t *hi2c)
+{
+	i2c_transaction_t *t = hi2c->QueueHead;
+	i2c_device_t *dev = t->Device;
+	uint32_t primask, latency;
+	
+	t->ErrorCode = hi2c->ErrorCode;
+	
+	/* Unsigned subtraction handles wrap around of the cycle counter */
+	latency = hal_i2c_queue_time() - t->SubmitTime;
+	
+	/* Driver is the only one removing entries, application only inserts behind the head with interrupts masked.
+	   Statistics are updated in the same section, hal_i2c_get_device_stats reads them with interrupts masked */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	dev->XferCount++;
+	if(t->ErrorCode != HAL_I2C_ERROR_NONE)
+		dev->ErrorCount++;
+	
+	dev->LatencyLast = latency;
+	dev->LatencyTotal += latency;
+	if(latency > dev->LatencyMax)
+		dev->LatencyMax = latency;
+	
+	/* New head is not on the bus yet, a submit from the callback may still go in front of it */
+	hi2c->QueueHead = t->Next;
+	hi2c->QueueHeadStarted = 0;
+	
+	__set_PRIMASK(primask);
+	
+	if(t->cb)
+		t->cb(t);
+}
+
+
+
+/**
+  * @brief  Starts the transaction at head of the queue, the rest is chained from its completion interrupt.
+  *         Transactions failing already at start (bus busy) are completed and skipped in a loop, not recursively.
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_queue_start(i2c_handle_t *hi2c)
+{
+	i2c_transaction_t *t;
+	uint32_t primask;
+	uint8_t restart;
+	
+	do
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		
+		t = hi2c->QueueHead;
+		
+		/* Queue drained, a new submit has to start the bus again */
+		if(t == 0)
+			hi2c->QueueBusy = 0;
+		else
+		{
+			hi2c->QueueHeadStarted = 1;
+			hi2c->QueueStarting = 1;
+		}
+		
+		__set_PRIMASK(primask);
+		
+		if(t == 0)
+			return;
+		
+		if(t->pRxBuffer)
+		{
+			if(t->MemAddrSize)
+				hal_i2c_mem_read(hi2c, t->Device->Address, t->MemAddress, t->MemAddrSize, t->pRxBuffer, t->Len);
+			else if(hi2c->hdmarx)
+				hal_i2c_master_rx_dma(hi2c, t->Device->Address | 0x01, t->pRxBuffer, t->Len);
+			else
+				hal_i2c_master_rx(hi2c, t->Device->Address | 0x01, t->pRxBuffer, t->Len);
+		}
+		else
+		{
+			if(t->MemAddrSize)
+				hal_i2c_mem_write(hi2c, t->Device->Address, t->MemAddress, t->MemAddrSize, t->pTxBuffer, t->Len);
+			else if(hi2c->hdmatx && t->Len)
+				hal_i2c_master_tx_dma(hi2c, t->Device->Address & ~0x01, t->pTxBuffer, t->Len);
+			else
+				hal_i2c_master_tx(hi2c, t->Device->Address & ~0x01, t->pTxBuffer, t->Len);
+		}
+		
+		/* hal_i2c_queue_next left the next transaction to this loop if the one above is already completed */
+		primask = __get_PRIMASK();
+		__disable_irq();
+		
+		restart = hi2c->QueueRestart;
+		hi2c->QueueRestart = 0;
+		hi2c->QueueStarting = 0;
+		
+		__set_PRIMASK(primask);
+	} while(restart);
+}
+
+
+
+/**
+  * @brief  Completes the transaction at head of the queue and chains the next one, called from ISR
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval  none
+ */
+static void hal_i2c_queue_next(i2c_handle_t *hi2c)
+{
+	hal_i2c_queue_complete(hi2c);
+	
+	/* Completed from inside hal_i2c_queue_start, its loop starts the next one so a stuck bus does not recurse */
+	if(hi2c->QueueStarting)
+	{
+		hi2c->QueueRestart = 1;
+		return;
+	}
+	
+	/* Callback may have queued more, next transaction starts without going back to thread context */
+	hal_i2c_queue_start(hi2c);
+}
+
+
+
+/***********************************************************************************************************************************/
+/*                                                                                                                                 */
+/*                                               Driver Exposed APIs                                                               */
+/*                                                                                                                                 */
+/***********************************************************************************************************************************/
+
+/**
+  * @brief  Computes the CCR and TRISE register values for the given PCLK1 and SCL speed
+  * @param  pclk : I2C peripherl clock frequency in Hz
+  * @param  clkspeed : SCL frequency in Hz, above 100Khz selects fast mode
+  * @param  duty_cycle : fast mode duty cycle, I2C_FM_DUTY_16BY9 or I2C_FM_DUTY_2
+  * @param  *ccr : CCR value including F/S and DUTY bits, written only if the speed can be generated
+  * @param  *trise : TRISE value, written only if the speed can be generated
+  * @retval  0 if done, 1 if pclk or clkspeed is out of range
+ */
+uint8_t hal_i2c_compute_timing(uint32_t pclk, uint32_t clkspeed, uint32_t duty_cycle, uint32_t *ccr, uint32_t *trise)
+{
+	uint32_t freqrange = pclk / 1000000;
+	uint32_t val;
+	
+	/* FREQ is programmed in whole MHz, the peripheral needs 2 MHz in standard and 4 MHz in fast mode */
+	if((pclk < I2C_PCLK_MIN_FREQ) || (pclk > I2C_PCLK_MAX_FREQ))
+		return 1;
+	
+	if((clkspeed == 0) || (clkspeed > I2C_FM_MAX_CLK_SPEED))
+		return 1;
+	
+	/* CCR is rounded up, so SCL never runs faster than requested */
+	if(clkspeed <= I2C_SM_MAX_CLK_SPEED)
+	{
+		/* Thigh = Tlow = CCR * Tpclk */
+		val = (pclk + (2 * clkspeed) - 1) / (2 * clkspeed);
+		
+		/* Minimum allowed value in standard mode */
+		if(val < 4)
+			val = 4;
+		
+		if(val > I2C_REG_CCR_CCR_MASK)
+			return 1;
+		
+		*ccr = val;
+		
+		/* TRISE = (maximum rise time / Tpclk) + 1 */
+		*trise = ((freqrange * I2C_SM_MAX_RISE_TIME_NS) / 1000) + 1;
+	}
+	else
+	{
+		if(pclk < I2C_FM_PCLK_MIN_FREQ)
+			return 1;
+		
+		if(duty_cycle == I2C_FM_DUTY_16BY9)
+		{
+			/* Thigh = 9 * CCR * Tpclk, Tlow = 16 * CCR * Tpclk */
+			val = (pclk + (25 * clkspeed) - 1) / (25 * clkspeed);
+		}
+		else
+		{
+			/* Thigh = CCR * Tpclk, Tlow = 2 * CCR * Tpclk */
+			val = (pclk + (3 * clkspeed) - 1) / (3 * clkspeed);
+		}
+		
+		*ccr = I2C_REG_CCR_ENABLE_FM | val;
+		if(duty_cycle == I2C_FM_DUTY_16BY9)
+			*ccr |= I2C_REG_CCR_DUTY;
+		
+		*trise = ((freqrange * I2C_FM_MAX_RISE_TIME_NS) / 1000) + 1;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+  * @brief  Initializes the Given I2C peripherl
+  * @param  *handle : Handle to i2c peripheral, which the application wants to initialize.
+  * @retval  none
+ */
+void hal_i2c_init(i2c_handle_t *handle)
+{
+	/* I2C Clock initializatio, this also leaves the peripheral disabled. Refuse to run at a wrong speed */
+	if(hal_i2c_clk_init(handle->Instance, handle->Init.ClockSpeed, handle->Init.DutyCycle))
+	{
+		handle->ErrorCode = HAL_I2C_ERROR_CONFIG;
+		handle->State = HAL_I2C_STATE_RESET;
+		return;
+	}
+	
+	/* Configure the addressing mode and own address */
+	if(handle->Init.AddressingMode == I2C_ADDRMODE_10BIT)
+	{
+		hal_i2c_set_own_address1_10bit(handle->Instance, handle->Init.OwnAddress1);
+	}
+	else
+	{
+		hal_i2c_set_own_address1(handle->Instance, handle->Init.OwnAddress1);
+	}
+	
+	/* Configure the second own address */
+	hal_i2c_configure_dual_address(handle->Instance, handle->Init.DualAddressMode, handle->Init.OwnAddress2);
+	
+	/* Configure general call response */
+	hal_i2c_configure_general_call(handle->Instance, handle->Init.GeneralCallMode);
+	
+	/* Enable/disable clock stretching */
+	hal_i2c_manage_clock_stretch(handle->Instance, handle->Init.NoStretchMode);
+	
+	/* Finally, enable the i2c peripheral */
 	hal_i2c_enable_peripheral(handle->Instance);
 	
+	/* Enable ACking, ACK is cleared by hardware while PE is 0 so it is set after enabling */
+	hal_i2c_manage_ack(handle->Instance, handle->Init.Ack_Enable);
+	
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->State = HAL_I2C_STATE_READY;
+	
+	handle->QueueHead = 0;
+	handle->QueueBusy = 0;
+	handle->QueueHeadStarted = 0;
+	handle->QueueStarting = 0;
+	handle->QueueRestart = 0;
+	handle->StartPending = 0;
+	
+#if I2C_QUEUE_LATENCY_STATS_ENABLE
+	/*Start the DWT cycle counter used to measure queue latency */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+
+/**
+  * @brief API to do master data transmission
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address to whuch we want to TX.
+  * @param *buffer: hold the pointer to tx buffer 
+	* @param len: length of the data to be transmitted
+  * @retval none
+ */
+void hal_i2c_master_tx(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+{
+	/*Populate the handle with tx buffer pointer and length information */
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
+	handle->State = HAL_I2C_STATE_BUSY_TX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = slave_address;
+	handle->MemAddrLeft = 0;
+	handle->MemRead = 0;
+	handle->DmaActive = 0;
+	
+	hal_i2c_master_start(handle);
+}
+
+
+
+
+
+/**
+  * @brief API to do master data rception
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address to whuch we want to TX.
+  * @param *buffer: hold the pointer to rx buffer 
+	* @param len: length of the data to be transmitted
+  * @retval none
+ */
+void hal_i2c_master_rx(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+{
+	
+	/*Populate the handle with tx buffer pointer and length information */
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
+	handle->State = HAL_I2C_STATE_BUSY_RX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = slave_address;
+	handle->MemAddrLeft = 0;
+	handle->MemRead = 0;
+	handle->DmaActive = 0;
+	
 	/*Make sure that POS bit is disabled*/
 	handle->Instance->CR1 &= ~I2C_REG_CR1_POS;
 	
 	/*Make sure that ACKing is enabled */
 	handle->Instance->CR1 |= I2C_REG_CR1_ACK;
-	 
-	/*Generate the start condition */
-	hal_i2c_generate_start_condition(handle->Instance);
 	
-	/*Wiat till SB is set */
-	hal_i2c_wait_until_sb_set(handle->Instance);
+	hal_i2c_master_start(handle);
+}
+
+
+
+
+/**
+  * @brief API to write to the registers/memory of a device, register address is sent first and data
+  *        follows in the same transaction. Returns right after START, tx_comp_cb is called at the end.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param dev_address: 7 bit device address shifted left by one, R/W bit is set by the driver
+  * @param mem_address: register/memory address inside the device
+  * @param mem_addr_size: I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be written
+  * @retval none
+ */
+void hal_i2c_mem_write(i2c_handle_t *handle, uint8_t dev_address, uint16_t mem_address, uint8_t mem_addr_size, uint8_t *buffer, uint32_t len)
+{
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
+	handle->State = HAL_I2C_STATE_BUSY_TX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = dev_address & ~0x01;
+	handle->MemAddress = mem_address;
+	handle->MemAddrLeft = mem_addr_size;
+	handle->MemRead = 0;
+	handle->DmaActive = 0;
 	
-	/*address phase : send 7 bit slave address with r/w bit */
-	hal_i2c_send_addr_first(handle->Instance, slave_address);
+	hal_i2c_master_start(handle);
+}
+
+
+
+/**
+  * @brief API to read the registers/memory of a device, register address is written and a repeated START
+  *        turns the bus around for reading without releasing it. Returns right after START, rx_comp_cb is called at the end.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param dev_address: 7 bit device address shifted left by one, R/W bit is set by the driver
+  * @param mem_address: register/memory address inside the device
+  * @param mem_addr_size: I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+  * @param *buffer: hold the pointer to rx buffer
+	* @param len: length of the data to be read
+  * @retval none
+ */
+void hal_i2c_mem_read(i2c_handle_t *handle, uint8_t dev_address, uint16_t mem_address, uint8_t mem_addr_size, uint8_t *buffer, uint32_t len)
+{
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
 	
-	/*Wait untill addr is set */
-  hal_i2c_wait_until_addr_set(handle->Instance);
+	/* Transfer starts as a write of the register address */
+	handle->State = HAL_I2C_STATE_BUSY_TX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = dev_address & ~0x01;
+	handle->MemAddress = mem_address;
+	handle->MemAddrLeft = mem_addr_size;
+	handle->MemRead = 1;
+	handle->DmaActive = 0;
 	
-	/*If you are here, then addr is set and clock is stretched and i2c is in wait state*/
-	/*Clear addr flag and make i2c come out of wait state*/
-	hal_i2c_clear_addr_flag(handle);
+	hal_i2c_master_start(handle);
+}
+
+
+
+/**
+  * @brief API to do master data transmission using DMA, START and address phase run on the event interrupt,
+  *        data bytes are moved by hdmatx and tx_comp_cb is called once after STOP. hdmatx must be initialized
+  *        as memory to peripheral stream on the DMA request of this I2C.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address to which we want to TX
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be transmitted, must not be 0
+  * @retval none
+ */
+void hal_i2c_master_tx_dma(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+{
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
+	handle->State = HAL_I2C_STATE_BUSY_TX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = slave_address;
+	handle->MemAddrLeft = 0;
+	handle->MemRead = 0;
+	handle->DmaActive = 1;
 	
-	/*Enable buffer ,event and error interrupt */
-	hal_i2c_configure_buffer_interrupt(handle->Instance,1);
-	hal_i2c_configure_event_interrupt(handle->Instance,1);
-	hal_i2c_configure_error_interrupt(handle->Instance,1);
+	/*Link the DMA stream to this I2C handle */
+	handle->hdmatx->Parent = handle;
+	handle->hdmatx->xfer_cplt_cb = hal_i2c_dma_tx_cplt;
+	handle->hdmatx->xfer_half_cb = 0;
+	handle->hdmatx->xfer_error_cb = hal_i2c_dma_error;
+	hal_i2c_dma_configure(handle->hdmatx);
+	
+	/*Stream is armed before START, first request comes when TXE is set after ADDR is cleared */
+	hal_dma_start_it(handle->hdmatx, (uint32_t)buffer, (uint32_t)&handle->Instance->DR, len);
+	handle->Instance->CR2 &= ~I2C_REG_CR2_LAST;
+	handle->Instance->CR2 |= I2C_REG_CR2_DMAEN;
+	
+	hal_i2c_master_start(handle);
+}
 
+
+
+/**
+  * @brief API to do master data reception using DMA, LAST bit makes the hardware NACK the final byte
+  *        and rx_comp_cb is called once after STOP. hdmarx must be initialized as peripheral to memory
+  *        stream on the DMA request of this I2C. Single byte reception falls back to interrupt mode.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address from which we want to RX
+  * @param *buffer: hold the pointer to rx buffer
+	* @param len: length of the data to be received
+  * @retval none
+ */
+void hal_i2c_master_rx_dma(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len)
+{
+	/* NACK of a single byte has to be programmed before ADDR is cleared, interrupt mode already does that */
+	if(len < 2)
+	{
+		hal_i2c_master_rx(handle, slave_address, buffer, len);
+		return;
+	}
+	
+	handle->pBuffPtr = buffer;
+	handle->XferCount = len;
+	handle->XferSize = len;
+	handle->State = HAL_I2C_STATE_BUSY_RX;
+	handle->Mode = I2C_MASTER_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
+	handle->DevAddress = slave_address;
+	handle->MemAddrLeft = 0;
+	handle->MemRead = 0;
+	handle->DmaActive = 1;
+	
+	/*Link the DMA stream to this I2C handle */
+	handle->hdmarx->Parent = handle;
+	handle->hdmarx->xfer_cplt_cb = hal_i2c_dma_rx_cplt;
+	handle->hdmarx->xfer_half_cb = 0;
+	handle->hdmarx->xfer_error_cb = hal_i2c_dma_error;
+	hal_i2c_dma_configure(handle->hdmarx);
+	
+	/*Make sure that POS bit is disabled*/
+	handle->Instance->CR1 &= ~I2C_REG_CR1_POS;
+	
+	/*Enable the ACKing, hardware NACKs the last byte because of LAST */
+	handle->Instance->CR1 |= I2C_REG_CR1_ACK;
+	
+	hal_dma_start_it(handle->hdmarx, (uint32_t)&handle->Instance->DR, (uint32_t)buffer, len);
+	handle->Instance->CR2 |= (I2C_REG_CR2_DMAEN | I2C_REG_CR2_LAST);
+	
+	hal_i2c_master_start(handle);
 }
 
 
 
+/**
+  * @brief API used to queue a transaction on the bus, transactions are carried out by priority and the next one is
+  *        started straight from the completion interrupt of the previous one. DMA is used for plain transfers
+  *        if hdmatx/hdmarx are set. Can be called from thread context or from a transaction callback.
+  *        tx_comp_cb, rx_comp_cb and error_cb are not called for queued transactions, the transaction cb is.
+  * @param *handle: pointer to handle structure of I2C peripheral, bus is used as master
+  * @param *transaction: transaction to be queued
+  * @retval none
+ */
+void hal_i2c_submit(i2c_handle_t *handle, i2c_transaction_t *transaction)
+{
+	i2c_transaction_t **pos;
+	uint32_t primask;
+	uint8_t start = 0;
+	
+	transaction->Next = 0;
+	transaction->ErrorCode = HAL_I2C_ERROR_NONE;
+	transaction->SubmitTime = hal_i2c_queue_time();
+	
+	/* Queue is shared with the I2C/DMA ISR */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	/* Transaction at head is already on the bus, new one can only go behind it. A submit from a transaction
+	   callback runs before the next head is started, so that one may still be overtaken */
+	pos = &handle->QueueHead;
+	if(handle->QueueHeadStarted && *pos)
+		pos = &(*pos)->Next;
+	
+	while(*pos && ((*pos)->Priority >= transaction->Priority))
+		pos = &(*pos)->Next;
+	
+	transaction->Next = *pos;
+	*pos = transaction;
+	
+	if(!handle->QueueBusy)
+	{
+		handle->QueueBusy = 1;
+		start = 1;
+	}
+	
+	__set_PRIMASK(primask);
+	
+	/* Bus was idle, otherwise ISR picks this transaction up */
+	if(start)
+		hal_i2c_queue_start(handle);
+}
+
+
+
+/**
+  * @brief API to read a consistent copy of the statistics of a device, they are updated from the I2C/DMA ISR
+  * @param *device: device on the bus
+  * @param *stats: destination of the copy
+  * @retval none
+ */
+void hal_i2c_get_device_stats(i2c_device_t *device, i2c_device_t *stats)
+{
+	uint32_t primask;
+	
+	/* 64 bit LatencyTotal takes two loads, ISR must not update it in between */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	*stats = *device;
+	
+	__set_PRIMASK(primask);
+}
+
+
 
 /**
   * @brief API to do the slave data transmission
@@ -655,6 +1516,8 @@ void hal_i2c_slave_tx(i2c_handle_t *handle, uint8_t *buffer, uint32_t len)
 	handle->XferCount = len;
 	handle->XferSize = len;
 	handle->State = HAL_I2C_STATE_BUSY_TX;
+	handle->Mode = I2C_SLAVE_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
 	
 	/*Make sure the i2c is enabled */
 	hal_i2c_enable_peripheral(handle->Instance);
@@ -690,6 +1553,8 @@ void hal_i2c_slave_rx(i2c_handle_t *handle, uint8_t *buffer, uint32_t len)
 	handle->XferCount = len;
 	handle->XferSize = len;
 	handle->State = HAL_I2C_STATE_BUSY_RX;
+	handle->Mode = I2C_SLAVE_MODE;
+	handle->ErrorCode = HAL_I2C_ERROR_NONE;
 	
 	/*Make sure the i2c is enabled */
 	hal_i2c_enable_peripheral(handle->Instance);
@@ -715,7 +1580,7 @@ void hal_i2c_slave_rx(i2c_handle_t *handle, uint8_t *buffer, uint32_t len)
   * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
   * @retval none
  */
-void hal_i2c_handle_error_interrup(i2c_handle_t *hi2c)
+void hal_i2c_handle_error_interrupt(i2c_handle_t *hi2c)
 {
 	uint32_t temp1 = 0, temp2 = 0, temp3 = 0;
 	/*Bus error Checking */
@@ -749,19 +1614,23 @@ void hal_i2c_handle_error_interrup(i2c_handle_t *hi2c)
 	if( temp1 && temp2)
 	{
 		temp1 = (hi2c->Instance->SR2 & I2C_REG_SR2_MSL_FLAG);//Master mode check
-		temp2 = hi2c->XferCount;// Transfer count check
 		temp3 = hi2c->State; //I2C state
 		
-		if((!temp1 ) && (temp2) && (temp3 == HAL_I2C_STATE_BUSY_TX))
+		if((!temp1 ) && (temp3 == HAL_I2C_STATE_BUSY_TX))
 		{
 			/* if ACK failure happens for slave, then slave should assume that master no longer needs any
-			 data so slave should stop sending data*/
+			 data so slave should stop sending data. This is how every slave transmission ends, whether
+			 the whole buffer was read (XferCount 0) or not, so it is not an error */
 			hal_i2c_slave_handle_ack_failure(hi2c);
 		}
 		else
 		{
-			/* If ACK failure happens for master then its an error*/
-			hi2c->State = HAL_I2C_ERROR_AF;
+			/* If ACK failure happens for master then its an error, release the bus*/
+			hi2c->ErrorCode |= HAL_I2C_ERROR_AF;
+			
+			if(temp1)
+				hal_i2c_generate_stop_condition(hi2c->Instance);
+			
 			/*Clear AF Flag*/
 			hi2c->Instance->SR1 &= ~I2C_REG_SR1_AF_FAILURE_FLAG;
 		}
@@ -782,6 +1651,13 @@ void hal_i2c_handle_error_interrup(i2c_handle_t *hi2c)
 	
 	if(hi2c->ErrorCode != HAL_I2C_ERROR_NONE)
 	{
+		hal_i2c_dma_close(hi2c);
+		
+		/* Disable buffer, event and error interrupt */
+		hi2c->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+		hi2c->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
+		hi2c->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
+		
 		hi2c->State = HAL_I2C_STATE_READY;
 		
 		/* Disable pos bit in I2C cr1 when error occured in master/mem Receive IT Process*/
@@ -789,7 +1665,178 @@ void hal_i2c_handle_error_interrup(i2c_handle_t *hi2c)
 		hal_i2c_error_cb(hi2c);
 	}
 }
-		
-		
+
+
+
+/**
+  * @brief This function handles I2C event interrupt request, drives master TX/RX and slave TX/RX
+  *        and calls tx_comp_cb/rx_comp_cb when a transfer is completed.
+  * @param  hi2c :  pointer to i2c_handle_t structure which contains I2C configuration information of I2C module
+  * @retval none
+ */
+void hal_i2c_handle_evt_interrupt(i2c_handle_t *hi2c)
+{
+	uint32_t sr1, sr2, buf_it;
+	
+	/* SR2 is not read here, reading it would clear ADDR before master RX had a chance to program ACK */
+	sr1 = hi2c->Instance->SR1;
+	buf_it = hi2c->Instance->CR2 & I2C_REG_CR2_BUF_INT_ENABLE;
 	
-	
\ No newline at end of file
+	if(hi2c->Mode == I2C_MASTER_MODE)
+	{
+		if(sr1 & I2C_REG_SR1_SB_FLAG)
+		{
+			/* Start condition sent, address phase : send 7 bit slave address with r/w bit ------------- */
+			hal_i2c_send_addr_first(hi2c->Instance, hi2c->DevAddress);
+		}
+		else if(sr1 & I2C_REG_SR1_ADDR_SENT_FLAG)
+		{
+			/* Slave ACKed its address, SCL is stretched until ADDR is cleared --------------------------- */
+			if(hi2c->DmaActive)
+			{
+				/* Data phase is left to DMA, TX stream completion enables the event interrupt again for BTF */
+				hal_i2c_clear_addr_flag(hi2c);
+				hal_i2c_configure_event_interrupt(hi2c->Instance,0);
+			}
+			else if(hi2c->State == HAL_I2C_STATE_BUSY_RX)
+				hal_i2c_master_rx_handle_addr(hi2c);
+			else
+			{
+				hal_i2c_clear_addr_flag(hi2c);
+				
+				/* Nothing to write (e.g. probing a slave), BTF never comes so STOP is sent right away */
+				if(!hi2c->MemAddrLeft && (hi2c->XferCount == 0))
+					hal_i2c_master_tx_complete(hi2c);
+			}
+		}
+		else if(hi2c->State == HAL_I2C_STATE_BUSY_TX)
+		{
+			/* Master transmitter ----------------------------------------------------------------------- */
+			if((sr1 & I2C_REG_SR1_TXE_FLAG) && buf_it && !(sr1 & I2C_REG_SR1_BTF_FLAG))
+			{
+				hal_i2c_master_handle_TXE_interrupt(hi2c);
+			}
+			else if(sr1 & I2C_REG_SR1_BTF_FLAG)
+			{
+				hal_i2c_master_tx_handle_btf(hi2c);
+			}
+		}
+		else if(hi2c->State == HAL_I2C_STATE_BUSY_RX)
+		{
+			/* Master receiver -------------------------------------------------------------------------- */
+			if((sr1 & I2C_REG_SR1_RXNE_FLAG) && buf_it && !(sr1 & I2C_REG_SR1_BTF_FLAG))
+			{
+				hal_i2c_master_handle_RXNE_interrupt(hi2c);
+			}
+			else if(sr1 & I2C_REG_SR1_BTF_FLAG)
+			{
+				hal_i2c_master_rx_handle_btf(hi2c);
+			}
+		}
+	}
+	else
+	{
+		if(sr1 & I2C_REG_SR1_ADDR_MATCHED_FLAG)
+		{
+			/* Slave addressed, SCL is stretched until ADDR is cleared, SR2 read below clears it --------- */
+			sr2 = hi2c->Instance->SR2;
+			
+			if(sr2 & I2C_REG_SR2_GENCALL_FLAG)
+				hi2c->SlaveAddrMatch = I2C_SLAVE_ADDR_GENERAL_CALL;
+			else if(sr2 & I2C_REG_SR2_DUALF_FLAG)
+				hi2c->SlaveAddrMatch = I2C_SLAVE_ADDR_OWN2;
+			else
+				hi2c->SlaveAddrMatch = I2C_SLAVE_ADDR_OWN1;
+		}
+		else if(sr1 & I2C_REG_SR1_STOP_DETECTION_FLAG)
+		{
+			hal_i2c_slave_handle_stop_condition(hi2c);
+		}
+		else if(hi2c->State == HAL_I2C_STATE_BUSY_TX)
+		{
+			/* Slave transmitter ------------------------------------------------------------------------ */
+			if((sr1 & I2C_REG_SR1_TXE_FLAG) && buf_it && !(sr1 & I2C_REG_SR1_BTF_FLAG))
+			{
+				hal_i2c_slave_handle_TXE_interrupt(hi2c);
+			}
+			else if(sr1 & I2C_REG_SR1_BTF_FLAG)
+			{
+				hal_i2c_slave_tx_handle_btf(hi2c);
+			}
+		}
+		else
+		{
+			/* Slave receiver --------------------------------------------------------------------------- */
+			if((sr1 & I2C_REG_SR1_RXNE_FLAG) && buf_it && !(sr1 & I2C_REG_SR1_BTF_FLAG))
+			{
+				hal_i2c_slave_handle_RXNE_interrupt(hi2c);
+			}
+			else if(sr1 & I2C_REG_SR1_BTF_FLAG)
+			{
+				hal_i2c_slave_rx_handle_btf(hi2c);
+			}
+		}
+	}
+}
+
+
+
+/**
+  * @brief API to be called from a periodic timer interrupt(e.g. SysTick) to bound the duration of a transfer.
+  *        If a master transfer is not completed within Timeout calls, it is aborted with STOP and
+  *        error_cb is called with HAL_I2C_ERROR_TIMEOUT.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @retval none
+ */
+void hal_i2c_timeout_tick(i2c_handle_t *handle)
+{
+	uint32_t primask;
+	uint8_t expired = 0;
+	
+	/* Event interrupt may complete the transfer at the same time */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if((handle->Mode == I2C_MASTER_MODE) && handle->TimeoutCount &&
+		 ((handle->State == HAL_I2C_STATE_BUSY_TX) || (handle->State == HAL_I2C_STATE_BUSY_RX)))
+	{
+		if(handle->StartPending && hal_i2c_is_bus_free(handle->Instance))
+		{
+			/* Previous STOP is out and the bus is free, deferred transfer can go */
+			handle->StartPending = 0;
+			hal_i2c_master_generate_start(handle);
+		}
+		else if(--handle->TimeoutCount == 0)
+		{
+			hal_i2c_dma_close(handle);
+			
+			/* Disable buffer, event and error interrupt */
+			handle->Instance->CR2 &= ~I2C_REG_CR2_BUF_INT_ENABLE;
+			handle->Instance->CR2 &= ~I2C_REG_CR2_EVT_INT_ENABLE;
+			handle->Instance->CR2 &= ~I2C_REG_CR2_ERR_INT_ENABLE;
+			
+			if(handle->StartPending)
+			{
+				/* START was never requested, bus did not become free */
+				handle->StartPending = 0;
+				handle->ErrorCode |= HAL_I2C_ERROR_BUSY;
+			}
+			else
+			{
+				/* Drop a START which never made it to the bus and release the bus */
+				handle->Instance->CR1 &= ~(I2C_REG_CR1_START_GEN | I2C_REG_CR1_POS);
+				hal_i2c_generate_stop_condition(handle->Instance);
+				
+				handle->ErrorCode |= HAL_I2C_ERROR_TIMEOUT;
+			}
+			
+			handle->State = HAL_I2C_STATE_READY;
+			expired = 1;
+		}
+	}
+	
+	__set_PRIMASK(primask);
+	
+	if(expired)
+		hal_i2c_error_cb(handle);
+}
@@ -9,6 +9,7 @@
 
 /*MCU specific header file for stm32f407vgt6 base discovery board */
 #include "stm32f407xx.h"
+#include "hal_dma_driver.h"
 #include <stdint.h>
 
 /******************************************************************************************************************************/
@@ -34,7 +35,12 @@
 /* Clock stretching disable (Slave mode)*/
 #define I2C_REG_CR1_NOSTRETCH                                          ((uint32_t) 1 << 7)
 #define I2C_ENABLE_CLK_STRETCH                                         0
-#define I2C_DISABLE_CLK_STRETCH                                        0
+#define I2C_DISABLE_CLK_STRETCH                                        1
+
+/* General call enable */
+#define I2C_REG_CR1_ENGC                                               ((uint32_t) 1 << 6)
+#define I2C_GENERALCALL_DISABLE                                        0
+#define I2C_GENERALCALL_ENABLE                                         1
 
 /* I2C Peripheral enable*/
 #define I2C_REG_CR1_ENABLE_I2C                                         ((uint32_t) 1 << 0)
@@ -42,12 +48,19 @@
 
 /***********************************Bit Definition for I2C_CR2 Register********************************************************/
 
+/* DMA last transfer, master receiver NACKs the byte of the last DMA transfer */
+#define I2C_REG_CR2_LAST                                                ((uint32_t) 1 << 12)
+
+/* DMA requests enable */
+#define I2C_REG_CR2_DMAEN                                               ((uint32_t) 1 << 11)
+
 /* Enable the interrupt of buffer, event and error */
 #define I2C_REG_CR2_BUF_INT_ENABLE                                      ((uint32_t) 1 << 10)
 #define I2C_REG_CR2_EVT_INT_ENABLE                                      ((uint32_t) 1 << 9)
 #define I2C_REG_CR2_ERR_INT_ENABLE                                      ((uint32_t) 1 << 8)
 
 /*I2C Peripheral clock frequency */
+#define I2C_REG_CR2_FREQ_MASK                                           ((uint32_t) 0x3F)
 #define I2C_PERIPHERAL_CLK_FREQ_2MHZ                                    ((uint32_t) 2)
 #define I2C_PERIPHERAL_CLK_FREQ_3MHZ                                    ((uint32_t) 3)
 #define I2C_PERIPHERAL_CLK_FREQ_4MHZ                                    ((uint32_t) 4)
@@ -77,6 +90,21 @@
 #define I2C_REG_OAR1_14TH_BIT                                           ((uint32_t) 1 << 14)
 
 #define I2C_REG_OAR1_7BIT_ADDRESS_POS                                   1
+#define I2C_REG_OAR1_7BIT_ADDRESS_MASK                                  ((uint32_t) 0x7F)
+#define I2C_REG_OAR1_10BIT_ADDRESS_MASK                                 ((uint32_t) 0x3FF)
+
+
+
+/***********************************Bit Definition for I2C_OAR2 Register********************************************************/
+
+/* Interface address in dual addressing mode, 7 bit only */
+#define I2C_REG_OAR2_ADD2_POS                                           1
+#define I2C_REG_OAR2_ADD2_MASK                                          ((uint32_t) 0x7F << 1)
+
+/* Dual addressing mode enable */
+#define I2C_REG_OAR2_ENDUAL                                             ((uint32_t) 1 << 0)
+#define I2C_DUALADDRESS_DISABLE                                         0
+#define I2C_DUALADDRESS_ENABLE                                          1
 
 
 
@@ -103,6 +131,13 @@
 
 /* Bus busy*/
 #define I2C_REG_SR2_BUS_BUSY_FLAG                                      ((uint32_t) 1 << 1)
+
+/* Which own address the slave was addressed with */
+#define I2C_REG_SR2_DUALF_FLAG                                         ((uint32_t) 1 << 7)
+#define I2C_REG_SR2_GENCALL_FLAG                                       ((uint32_t) 1 << 4)
+#define I2C_SLAVE_ADDR_OWN1                                            0
+#define I2C_SLAVE_ADDR_OWN2                                            1
+#define I2C_SLAVE_ADDR_GENERAL_CALL                                    2
 #define I2C_BUS_IS_BUSY                                                1
 #define I2C_BUS_IS_FREE                                                0
 
@@ -129,6 +164,32 @@
 #define I2C_FM_DUTY_16BY9                                              1
 #define I2C_FM_DUTY_2                                                  0
 
+/* Clock control value */
+#define I2C_REG_CCR_CCR_MASK                                           ((uint32_t) 0xFFF)
+
+/* Standard mode upto 100Khz, fast mode upto 400Khz */
+#define I2C_SM_MAX_CLK_SPEED                                           ((uint32_t) 100000)
+#define I2C_FM_MAX_CLK_SPEED                                           ((uint32_t) 400000)
+
+/* PCLK1 range supported by the peripheral, fast mode needs at least 4 Mhz. APB1 runs at 42 Mhz at most */
+#define I2C_PCLK_MIN_FREQ                                              ((uint32_t) 2000000)
+#define I2C_FM_PCLK_MIN_FREQ                                           ((uint32_t) 4000000)
+#define I2C_PCLK_MAX_FREQ                                              ((uint32_t) 42000000)
+
+
+/***********************************Bit Definition for I2C_TRISE Register*******************************************************/
+
+#define I2C_REG_TRISE_MASK                                             ((uint32_t) 0x3F)
+
+/* Maximum SCL rise time allowed by the I2C specification in ns */
+#define I2C_SM_MAX_RISE_TIME_NS                                        ((uint32_t) 1000)
+#define I2C_FM_MAX_RISE_TIME_NS                                        ((uint32_t) 300)
+
+/***********************************Register address size of memory/register access**********************************************/
+
+#define I2C_MEMADD_SIZE_8BIT                                           ((uint8_t) 1)
+#define I2C_MEMADD_SIZE_16BIT                                          ((uint8_t) 2)
+
 /***********************************I2C Peripheral Base addresses****************************************************************/
 
 #define I2C_1                                                          I2C1
@@ -144,6 +205,18 @@
 
 
 
+/* Set to 0 to drop the per device latency statistics of the transaction queue, they need the DWT cycle counter */
+#ifndef I2C_QUEUE_LATENCY_STATS_ENABLE
+#define I2C_QUEUE_LATENCY_STATS_ENABLE                                 1
+#endif
+
+/* SCL periods a new START waits for the STOP of the previous transfer and for BUSY to clear, the poll count is
+   derived from CCR and PCLK1 so the wait follows the SCL speed. Longer waits are left to hal_i2c_timeout_tick */
+#ifndef I2C_STOP_WAIT_SCL_PERIODS
+#define I2C_STOP_WAIT_SCL_PERIODS                                      4
+#endif
+
+
 #define RESET                                                         0
 #define SET                                                           !RESET
 
@@ -178,6 +251,8 @@ typedef enum
 #define HAL_I2C_ERROR_OVR              ((uint32_t) 0x00000008)     // Overrun/Underrun error
 #define HAL_I2C_ERROR_DMA              ((uint32_t) 0x00000010)     // DMA transfer error
 #define HAL_I2C_ERROR_TIMEOUT          ((uint32_t) 0x00000020)     // Timeout or Tlow error
+#define HAL_I2C_ERROR_BUSY             ((uint32_t) 0x00000040)     // Bus still busy or STOP pending when START was due
+#define HAL_I2C_ERROR_CONFIG           ((uint32_t) 0x00000080)     // SCL speed can not be generated from PCLK1
 
 
 
@@ -199,6 +274,48 @@ typedef struct
 
 
 
+/*Application callback typedef */
+typedef void(I2C_CB_t) (void *ptr);
+
+
+
+/**
+  * @brief I2C device on a shared bus, also holds the latency statistics of its queued transactions.
+  *        Latency is measured from hal_i2c_submit until the transaction callback, in CPU cycles.
+  *        Use hal_i2c_get_device_stats to read them, LatencyTotal can not be read atomically.
+	*/
+typedef struct
+{
+	uint8_t             Address;       /* 7 bit slave address shifted left by one, R/W bit is set by the driver */
+	uint32_t            XferCount;     /* Transactions completed */
+	uint32_t            ErrorCount;    /* Transactions completed with an error */
+	uint32_t            LatencyLast;   /* Latency of the last transaction */
+	uint32_t            LatencyMax;    /* Worst case latency */
+	uint64_t            LatencyTotal;  /* Sum of all latencies, average is LatencyTotal / XferCount */
+} i2c_device_t;
+
+
+
+/**
+  * @brief I2C transaction queued on a bus, storage is owned by the application until cb is called
+	*/
+typedef struct i2c_transaction
+{
+	i2c_device_t        *Device;       /* Device to be addressed */
+	uint16_t            MemAddress;    /* Register address inside the device */
+	uint8_t             MemAddrSize;   /* 0 for a plain transfer, otherwise I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT */
+	uint8_t             Priority;      /* Higher priority transactions go first, equal priorities in submit order */
+	uint8_t             *pTxBuffer;    /* Data to be written, used when pRxBuffer is NULL */
+	uint8_t             *pRxBuffer;    /* Buffer for read data, if not NULL transaction is a read */
+	uint16_t            Len;           /* Length of the data in bytes */
+	uint32_t            ErrorCode;     /* HAL_I2C_ERROR_xxx result, valid in cb */
+	uint32_t            SubmitTime;    /* Used by the driver for latency statistics */
+	I2C_CB_t            *cb;           /* Called from ISR with pointer to this transaction once it is completed */
+	struct i2c_transaction *Next;      /* Used by the driver to link the queue */
+} i2c_transaction_t;
+
+
+
 /**
   * @brief I2C Handle structure definition 
 	*/
@@ -211,6 +328,26 @@ typedef struct
   uint32_t            XferCount;     /* I2C transfer count */
 	hal_i2c_state_t     State;         /* I2C communication state */
 	uint32_t            ErrorCode;     /* Used to hold error code status */
+	uint32_t            Mode;          /* I2C_MASTER_MODE or I2C_SLAVE_MODE for the on going transfer */
+	uint8_t             DevAddress;    /* Slave address with R/W bit, sent by the ISR once START is generated */
+	uint16_t            MemAddress;    /* Register address for mem read/write */
+	uint8_t             MemAddrLeft;   /* Register address bytes still to be sent, MSB first */
+	uint8_t             MemRead;       /* Repeated START for reading follows the register address */
+	uint8_t             SlaveAddrMatch;/* Address the slave answered on in the current transfer, I2C_SLAVE_ADDR_xxx */
+	dma_handle_t        *hdmatx;       /* DMA stream used for master transmission, NULL if not used */
+	dma_handle_t        *hdmarx;       /* DMA stream used for master reception, NULL if not used */
+	uint8_t             DmaActive;     /* Data phase of the on going master transfer is carried out by DMA */
+	i2c_transaction_t   *QueueHead;    /* Transaction on the bus, followed by the pending ones in priority order */
+	volatile uint8_t    QueueBusy;     /* Queue is being processed from ISR */
+	volatile uint8_t    QueueHeadStarted; /* Transaction at QueueHead is on the bus, submit inserts behind it */
+	volatile uint8_t    QueueStarting; /* Queue start is in progress, a transaction failing meanwhile is chained by it */
+	volatile uint8_t    QueueRestart;  /* Transaction failed while being started, start the next one */
+	volatile uint8_t    StartPending;  /* START is waiting for the bus to be free, retried by hal_i2c_timeout_tick */
+	uint32_t            Timeout;       /* Master transfer timeout in hal_i2c_timeout_tick calls, 0 means no timeout */
+	volatile uint32_t   TimeoutCount;  /* Ticks left for the on going master transfer */
+	I2C_CB_t            *tx_comp_cb;   /* Application call back when tx is completed, called with the handle */
+	I2C_CB_t            *rx_comp_cb;   /* Application call back when rx is completed, called with the handle */
+	I2C_CB_t            *error_cb;     /* Application call back on I2C error, driver halts on error if NULL */
 } i2c_handle_t;
 
 
@@ -224,26 +361,43 @@ typedef struct
 
 
 /**
-  * @brief  Initializes the Given I2C peripherl
+  * @brief  Initializes the Given I2C peripherl. If ClockSpeed is 0 or above 400Khz, or PCLK1 is out of the
+  *         2-42 Mhz range (4 Mhz in fast mode), ErrorCode is set to HAL_I2C_ERROR_CONFIG and State is left RESET.
   * @param  *handle : Handle to i2c peripheral, which the application wants to initialize.
   * @retval  none
  */
 void hal_i2c_init(i2c_handle_t *handle);
 
 
+
+/**
+  * @brief  Computes the CCR and TRISE register values for the given PCLK1 and SCL speed
+  * @param  pclk : I2C peripherl clock frequency in Hz
+  * @param  clkspeed : SCL frequency in Hz, above 100Khz selects fast mode
+  * @param  duty_cycle : fast mode duty cycle, I2C_FM_DUTY_16BY9 or I2C_FM_DUTY_2
+  * @param  *ccr : CCR value including F/S and DUTY bits, written only if the speed can be generated
+  * @param  *trise : TRISE value, written only if the speed can be generated
+  * @retval  0 if done, 1 if pclk or clkspeed is out of range
+ */
+uint8_t hal_i2c_compute_timing(uint32_t pclk, uint32_t clkspeed, uint32_t duty_cycle, uint32_t *ccr, uint32_t *trise);
+
+
 /**
-  * @brief API to do master data transmission
+  * @brief API to do master data transmission, returns right after START is generated,
+  *        address phase and data are handled by the event interrupt and tx_comp_cb is called at the end.
+  *        error_cb is called with HAL_I2C_ERROR_BUSY if the bus is not released by the previous STOP.
   * @param *handle: pointer to handle structure of I2C peripheral
   * @param slave_address: address to whuch we want to TX.
   * @param *buffer: hold the pointer to tx buffer 
-	* @param len: length of the data to be transmitted
+	* @param len: length of the data to be transmitted, 0 only sends the address (e.g. to probe a slave)
   * @retval none
  */
  void hal_i2c_master_tx(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len);
  
  
  /**
-  * @brief API to do master data reception
+  * @brief API to do master data reception, returns right after START is generated,
+  *        address phase and data are handled by the event interrupt and rx_comp_cb is called at the end.
   * @param *handle: pointer to handle structure of I2C peripheral
   * @param slave_addr: slave address who sends data
   * @param *buffer: hold the pointer to Rx buffer 
@@ -253,8 +407,85 @@ void hal_i2c_init(i2c_handle_t *handle);
  void hal_i2c_master_rx(i2c_handle_t *handle, uint8_t slave_addr, uint8_t *buffer, uint32_t len);
 
 
+/**
+  * @brief API to write to the registers/memory of a device, register address is sent first and data
+  *        follows in the same transaction. Returns right after START, tx_comp_cb is called at the end.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param dev_address: 7 bit device address shifted left by one, R/W bit is set by the driver
+  * @param mem_address: register/memory address inside the device
+  * @param mem_addr_size: I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be written
+  * @retval none
+ */
+void hal_i2c_mem_write(i2c_handle_t *handle, uint8_t dev_address, uint16_t mem_address, uint8_t mem_addr_size, uint8_t *buffer, uint32_t len);
+
+
+/**
+  * @brief API to read the registers/memory of a device, register address is written and a repeated START
+  *        turns the bus around for reading without releasing it. Returns right after START, rx_comp_cb is called at the end.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param dev_address: 7 bit device address shifted left by one, R/W bit is set by the driver
+  * @param mem_address: register/memory address inside the device
+  * @param mem_addr_size: I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+  * @param *buffer: hold the pointer to rx buffer
+	* @param len: length of the data to be read
+  * @retval none
+ */
+void hal_i2c_mem_read(i2c_handle_t *handle, uint8_t dev_address, uint16_t mem_address, uint8_t mem_addr_size, uint8_t *buffer, uint32_t len);
+
+
+/**
+  * @brief API to do master data transmission using DMA, START and address phase run on the event interrupt,
+  *        data bytes are moved by hdmatx and tx_comp_cb is called once after STOP. hdmatx must be initialized
+  *        as memory to peripheral stream on the DMA request of this I2C.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address to which we want to TX
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be transmitted, must not be 0
+  * @retval none
+ */
+void hal_i2c_master_tx_dma(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len);
+
+
+/**
+  * @brief API to do master data reception using DMA, LAST bit makes the hardware NACK the final byte
+  *        and rx_comp_cb is called once after STOP. hdmarx must be initialized as peripheral to memory
+  *        stream on the DMA request of this I2C. Single byte reception falls back to interrupt mode.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @param slave_address: address from which we want to RX
+  * @param *buffer: hold the pointer to rx buffer
+	* @param len: length of the data to be received
+  * @retval none
+ */
+void hal_i2c_master_rx_dma(i2c_handle_t *handle, uint8_t slave_address, uint8_t *buffer, uint32_t len);
+
+
+/**
+  * @brief API used to queue a transaction on the bus, transactions are carried out by priority and the next one is
+  *        started straight from the completion interrupt of the previous one. DMA is used for plain transfers
+  *        if hdmatx/hdmarx are set. Can be called from thread context or from a transaction callback.
+  *        tx_comp_cb, rx_comp_cb and error_cb are not called for queued transactions, the transaction cb is.
+  * @param *handle: pointer to handle structure of I2C peripheral, bus is used as master
+  * @param *transaction: transaction to be queued
+  * @retval none
+ */
+void hal_i2c_submit(i2c_handle_t *handle, i2c_transaction_t *transaction);
+
+
+
+/**
+  * @brief API to read a consistent copy of the statistics of a device, they are updated from the I2C/DMA ISR
+  * @param *device: device on the bus
+  * @param *stats: destination of the copy
+  * @retval none
+ */
+void hal_i2c_get_device_stats(i2c_device_t *device, i2c_device_t *stats);
+
+
  /**
-  * @brief API to do slave data transmission
+  * @brief API to do slave data transmission, tx_comp_cb is called when the master NACKs the last byte it wants.
+  *        handle->XferCount then holds the bytes the master did not read.
   * @param *handle: pointer to handle structure of I2C peripheral
   * @param *buffer: hold the pointer to tx buffer 
 	* @param len: length of the data to be transmitted
@@ -281,8 +512,21 @@ void hal_i2c_slave_rx(i2c_handle_t *handle, uint8_t *buffer, uint32_t len);
  void hal_i2c_handle_error_interrupt(i2c_handle_t *hi2c);
  
  
+/**
+  * @brief API to be called from a periodic timer interrupt(e.g. SysTick) to bound the duration of a transfer.
+  *        If a master transfer is not completed within Timeout calls, it is aborted with STOP and
+  *        error_cb is called with HAL_I2C_ERROR_TIMEOUT.
+  *        A START which found the bus busy is retried on every call, if the bus is still busy after Timeout
+  *        calls error_cb is called with HAL_I2C_ERROR_BUSY. Without Timeout such a START fails right away.
+  * @param *handle: pointer to handle structure of I2C peripheral
+  * @retval none
+ */
+void hal_i2c_timeout_tick(i2c_handle_t *handle);
+
+
   /**
-  * @brief This function handles I2C event interrupt request
+  * @brief This function handles I2C event interrupt request, drives master TX/RX and slave TX/RX
+  *        and calls tx_comp_cb/rx_comp_cb when a transfer is completed.
   * @param hi2c: pointer to i2c_handle_t structure which contains I2C configuration information of I2C module.
   * @retval none
  */
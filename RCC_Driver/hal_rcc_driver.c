@@ -0,0 +1,118 @@
+/***************************************************************************************************************************
+  * @file    hal_rcc_driver.c
+  * @author  Sharath N
+  * @brief   RCC HAL module driver,
+             This file provides firmware functions to read the live clock frequencies of STM32F407 Discovery Board.
+***************************************************************************************************************************/
+
+#include <stdint.h>
+#include "hal_rcc_driver.h"
+
+/***************************************************************************************************************************/
+/*                                                                                                                         */
+/*                                               Helper functions                                                          */
+/*                                                                                                                         */
+/***************************************************************************************************************************/
+
+/**
+  * @brief  Returns the shift(division by power of two) of the APB prescaler field
+  * @param  ppre : 3 bit PPRE1/PPRE2 field value
+  * @retval  shift value
+ */
+static uint32_t hal_rcc_apb_shift(uint32_t ppre)
+{
+	/* 0xx : not divided, 100 : /2, 101 : /4, 110 : /8, 111 : /16 */
+	if(ppre < 4)
+		return 0;
+
+	return (ppre - 3);
+}
+
+
+
+/**
+  * @brief  Returns the shift(division by power of two) of the AHB prescaler field
+  * @param  hpre : 4 bit HPRE field value
+  * @retval  shift value
+ */
+static uint32_t hal_rcc_ahb_shift(uint32_t hpre)
+{
+	/* 0xxx : not divided, 1000 : /2 .... 1011 : /16, 1100 : /64 .... 1111 : /512, there is no /32 */
+	if(hpre < 8)
+		return 0;
+	else if(hpre < 12)
+		return (hpre - 7);
+	else
+		return (hpre - 6);
+}
+
+
+
+/***********************************************************************************************************************************/
+/*                                                                                                                                 */
+/*                                               Driver Exposed APIs                                                               */
+/*                                                                                                                                 */
+/***********************************************************************************************************************************/
+
+/**
+  * @brief  Returns the SYSCLK frequency by decoding the clock source and PLL configuration
+  * @retval  SYSCLK frequency in Hz
+ */
+uint32_t hal_rcc_get_sysclk_freq(void)
+{
+	uint32_t pllcfgr, pllm, plln, pllp, vco_in;
+
+	switch((RCC->CFGR >> RCC_REG_CFGR_SWS) & 0x03)
+	{
+		case RCC_SWS_HSE:
+			return HSE_VALUE;
+
+		case RCC_SWS_PLL:
+			pllcfgr = RCC->PLLCFGR;
+			pllm = (pllcfgr >> RCC_REG_PLLCFGR_PLLM) & 0x3F;
+			plln = (pllcfgr >> RCC_REG_PLLCFGR_PLLN) & 0x1FF;
+			pllp = (((pllcfgr >> RCC_REG_PLLCFGR_PLLP) & 0x03) + 1) * 2;
+
+			vco_in = (pllcfgr & RCC_REG_PLLCFGR_PLLSRC) ? HSE_VALUE : RCC_HSI_FREQ;
+
+			/* f(VCO) = f(PLL input) * (PLLN / PLLM), f(SYSCLK) = f(VCO) / PLLP */
+			return (uint32_t)(((uint64_t)vco_in * plln / pllm) / pllp);
+
+		case RCC_SWS_HSI:
+		default:
+			return RCC_HSI_FREQ;
+	}
+}
+
+
+
+/**
+  * @brief  Returns the HCLK(AHB) frequency
+  * @retval  HCLK frequency in Hz
+ */
+uint32_t hal_rcc_get_hclk_freq(void)
+{
+	return hal_rcc_get_sysclk_freq() >> hal_rcc_ahb_shift((RCC->CFGR >> RCC_REG_CFGR_HPRE) & 0x0F);
+}
+
+
+
+/**
+  * @brief  Returns the PCLK1(APB1) frequency
+  * @retval  PCLK1 frequency in Hz
+ */
+uint32_t hal_rcc_get_pclk1_freq(void)
+{
+	return hal_rcc_get_hclk_freq() >> hal_rcc_apb_shift((RCC->CFGR >> RCC_REG_CFGR_PPRE1) & 0x07);
+}
+
+
+
+/**
+  * @brief  Returns the PCLK2(APB2) frequency
+  * @retval  PCLK2 frequency in Hz
+ */
+uint32_t hal_rcc_get_pclk2_freq(void)
+{
+	return hal_rcc_get_hclk_freq() >> hal_rcc_apb_shift((RCC->CFGR >> RCC_REG_CFGR_PPRE2) & 0x07);
+}
@@ -0,0 +1,88 @@
+/**************************************************************************************************************************
+ * @file     hal_rcc_driver.h
+ * @author   Sharath N
+ * @brief    Header file for RCC(Reset and Clock Control) helper of STM32F407 Discovery Baord,
+ *           used by the peripheral drivers to find their actual bus clock frequency.
+ **************************************************************************************************************************/
+
+#ifndef __HAL_RCC_DRIVER_H
+#define __HAL_RCC_DRIVER_H
+
+/*MCU specific header file for stm32f407vgt6 base discovery board */
+#include "stm32f407xx.h"
+#include <stdint.h>
+
+/******************************************************************************************************************************/
+/*                                                                                                                            */
+/*                                            1. RCC Register bit definition                                                  */
+/*                                                                                                                            */
+/******************************************************************************************************************************/
+
+/***********************************Bit Definition for RCC_CFGR Register********************************************************/
+
+/* APB high speed prescaler (APB2) */
+#define RCC_REG_CFGR_PPRE2                                             ((uint32_t) 13)
+
+/* APB low speed prescaler (APB1) */
+#define RCC_REG_CFGR_PPRE1                                             ((uint32_t) 10)
+
+/* AHB prescaler */
+#define RCC_REG_CFGR_HPRE                                              ((uint32_t) 4)
+
+/* System clock switch status */
+#define RCC_REG_CFGR_SWS                                               ((uint32_t) 2)
+#define RCC_SWS_HSI                                                    ((uint32_t) 0x00)
+#define RCC_SWS_HSE                                                    ((uint32_t) 0x01)
+#define RCC_SWS_PLL                                                    ((uint32_t) 0x02)
+
+/***********************************Bit Definition for RCC_PLLCFGR Register*****************************************************/
+
+#define RCC_REG_PLLCFGR_PLLSRC                                         ((uint32_t) 1 << 22)
+#define RCC_REG_PLLCFGR_PLLP                                           ((uint32_t) 16)
+#define RCC_REG_PLLCFGR_PLLN                                           ((uint32_t) 6)
+#define RCC_REG_PLLCFGR_PLLM                                           ((uint32_t) 0)
+
+/***********************************Oscillator frequencies**********************************************************************/
+
+#define RCC_HSI_FREQ                                                   ((uint32_t) 16000000)
+
+/* STM32F4 Discovery has 8Mhz crystal connected to HSE */
+#ifndef HSE_VALUE
+#define HSE_VALUE                                                      ((uint32_t) 8000000)
+#endif
+
+
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                              2. Driver Exposed APIs                                                                     */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+/**
+  * @brief  Returns the SYSCLK frequency by decoding the clock source and PLL configuration
+  * @retval  SYSCLK frequency in Hz
+ */
+uint32_t hal_rcc_get_sysclk_freq(void);
+
+
+/**
+  * @brief  Returns the HCLK(AHB) frequency
+  * @retval  HCLK frequency in Hz
+ */
+uint32_t hal_rcc_get_hclk_freq(void);
+
+
+/**
+  * @brief  Returns the PCLK1(APB1) frequency
+  * @retval  PCLK1 frequency in Hz
+ */
+uint32_t hal_rcc_get_pclk1_freq(void);
+
+
+/**
+  * @brief  Returns the PCLK2(APB2) frequency
+  * @retval  PCLK2 frequency in Hz
+ */
+uint32_t hal_rcc_get_pclk2_freq(void);
+
+#endif
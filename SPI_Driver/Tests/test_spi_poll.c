@@ -0,0 +1,97 @@
+/***************************************************************************************************************************
+  * @file    test_spi_poll.c
+  * @author  Sharath N
+  * @brief   Host test of the automatic choice between the polled and the interrupt path of the master APIs.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_spi_driver.h"
+#include "test_assert.h"
+
+static spi_handle_t hspi;
+static uint8_t tx_data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+static uint8_t rx_data[8];
+
+static uint32_t cplt_count, cplt_size;
+
+static void cplt_cb(void *ptr)
+{
+	cplt_count++;
+	cplt_size = *(uint16_t *)ptr;
+}
+
+/* TXE and RXNE stay set in RAM, so every written frame is read back like on a MOSI/MISO loopback */
+static void spi_setup(void)
+{
+	memset(&hspi, 0, sizeof(hspi));
+	memset((void *)SPI1, 0, sizeof(*SPI1));
+	memset(rx_data, 0, sizeof(rx_data));
+	
+	hspi.Instance = SPI1;
+	hspi.Init.Mode = SPI_MASTER_MODE_SEL;
+	hspi.Init.Direction = SPI_ENABLE_2_LINE_UNI_DIR;
+	hspi.Init.DataSize = SPI_8BIT_DF_ENABLE;
+	hspi.xfer_cplt_cb = cplt_cb;
+	hal_spi_init(&hspi);
+	
+	SPI1->SR = SPI_REG_SR_TXE_FLAG | SPI_REG_SR_RXNE_FLAG;
+	cplt_count = 0;
+	cplt_size = 0;
+}
+
+/* Register sized transfer is over when the call returns, callback already fired */
+static void test_short_transfer_polled(void)
+{
+	spi_setup();
+	
+	hal_spi_master_tx_rx(&hspi, tx_data, rx_data, SPI_POLL_THRESHOLD);
+	
+	CHECK_EQ(hspi.state, HAL_SPI_STATE_READY);
+	CHECK_EQ(cplt_count, 1);
+	CHECK_EQ(cplt_size, SPI_POLL_THRESHOLD);
+	CHECK(memcmp(rx_data, tx_data, SPI_POLL_THRESHOLD) == 0);
+	CHECK_EQ(SPI1->CR2 & (SPI_REG_CR2_TXEIE_ENABLE | SPI_REG_CR2_RXNEIE_ENABLE), 0);
+	
+	spi_setup();
+	hal_spi_master_tx(&hspi, tx_data, 2);
+	CHECK_EQ(cplt_count, 1);
+	CHECK_EQ(cplt_size, 2);
+	CHECK_EQ(SPI1->DR, 2);
+	
+	spi_setup();
+	hal_spi_master_rx(&hspi, rx_data, 1);
+	CHECK_EQ(cplt_count, 1);
+	CHECK_EQ(SPI1->CR2 & (SPI_REG_CR2_TXEIE_ENABLE | SPI_REG_CR2_RXNEIE_ENABLE), 0);
+}
+
+/* Longer transfer goes through the interrupt path, callback fires from the last RXNE */
+static void test_long_transfer_interrupt(void)
+{
+	uint32_t i;
+	
+	spi_setup();
+	
+	hal_spi_master_tx_rx(&hspi, tx_data, rx_data, SPI_POLL_THRESHOLD + 1);
+	
+	CHECK_EQ(hspi.state, HAL_SPI_STATE_BUSY_TX_RX);
+	CHECK_EQ(cplt_count, 0);
+	CHECK(SPI1->CR2 & SPI_REG_CR2_TXEIE_ENABLE);
+	CHECK(SPI1->CR2 & SPI_REG_CR2_RXNEIE_ENABLE);
+	
+	/* Both flags are always set in RAM, every call serves RXNE and/or TXE */
+	for(i = 0; (i < 4 * (SPI_POLL_THRESHOLD + 1)) && (hspi.state != HAL_SPI_STATE_READY); i++)
+		hal_spi_irq_handler(&hspi);
+	
+	CHECK_EQ(hspi.state, HAL_SPI_STATE_READY);
+	CHECK_EQ(cplt_count, 1);
+	CHECK_EQ(cplt_size, SPI_POLL_THRESHOLD + 1);
+	CHECK_EQ(SPI1->CR2 & SPI_REG_CR2_RXNEIE_ENABLE, 0);
+}
+
+int main(void)
+{
+	test_short_transfer_polled();
+	test_long_transfer_interrupt();
+	
+	return TEST_RESULT();
+}
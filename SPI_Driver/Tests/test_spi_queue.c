@@ -0,0 +1,179 @@
+/***************************************************************************************************************************
+  * @file    test_spi_queue.c
+  * @author  Sharath N
+  * @brief   Host test of the per device chip select transaction queue, completion and error paths.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_spi_driver.h"
+#include "fake_dma.h"
+#include "test_assert.h"
+
+#define CS_PIN          4
+#define CS_HIGH         ((uint32_t)1 << CS_PIN)
+#define CS_LOW          ((uint32_t)1 << (CS_PIN + 16))
+#define XFER_LEN        16
+
+static spi_handle_t hspi;
+static dma_handle_t hdmatx, hdmarx;
+static spi_device_t dev[3];
+static spi_transaction_t trans[3];
+static uint8_t tx_data[3][XFER_LEN], rx_data[3][XFER_LEN];
+
+static spi_transaction_t *done[8];
+static uint32_t done_count;
+
+static void trans_cb(void *ptr)
+{
+	done[done_count++] = (spi_transaction_t *)ptr;
+}
+
+static void spi_setup(void)
+{
+	GPIO_TypeDef *ports[3] = {GPIOA, GPIOB, GPIOC};
+	uint32_t i;
+	
+	memset(&hspi, 0, sizeof(hspi));
+	memset((void *)SPI1, 0, sizeof(*SPI1));
+	memset(&hdmatx, 0, sizeof(hdmatx));
+	memset(&hdmarx, 0, sizeof(hdmarx));
+	
+	hspi.Instance = SPI1;
+	hspi.Init.Mode = SPI_MASTER_MODE_SEL;
+	hspi.Init.Direction = SPI_ENABLE_2_LINE_UNI_DIR;
+	hspi.Init.DataSize = SPI_8BIT_DF_ENABLE;
+	hal_spi_init(&hspi);
+	
+	hdmatx.Instance = DMA2_Stream3;
+	hdmatx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdmarx.Instance = DMA2_Stream0;
+	hdmarx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hspi.hdmatx = &hdmatx;
+	hspi.hdmarx = &hdmarx;
+	
+	/* Every device has its chip select on its own port, BSRR holds the last chip select action */
+	for(i = 0; i < 3; i++)
+	{
+		memset((void *)ports[i], 0, sizeof(*ports[i]));
+		memset(&dev[i], 0, sizeof(dev[i]));
+		dev[i].CsPort = ports[i];
+		dev[i].CsPin = CS_PIN;
+		dev[i].Init = hspi.Init;
+		
+		memset(&trans[i], 0, sizeof(trans[i]));
+		trans[i].Device = &dev[i];
+		trans[i].pTxBuffer = tx_data[i];
+		trans[i].pRxBuffer = rx_data[i];
+		trans[i].Len = XFER_LEN;
+		trans[i].cb = trans_cb;
+	}
+	
+	fake_dma_reset();
+	done_count = 0;
+}
+
+/* DMA error releases chip select, fails the transaction and starts the next one */
+static void test_dma_error_completes_transaction(void)
+{
+	spi_setup();
+	
+	hal_spi_submit(&hspi, &trans[0]);
+	hal_spi_submit(&hspi, &trans[1]);
+	CHECK_EQ(GPIOA->BSRR, CS_LOW);
+	CHECK_EQ(fake_dma_start_count, 2);
+	
+	fake_dma_error(&hdmarx);
+	
+	CHECK_EQ(done_count, 1);
+	CHECK(done[0] == &trans[0]);
+	CHECK_EQ(trans[0].ErrorCode, HAL_SPI_ERROR_DMA);
+	CHECK_EQ(GPIOA->BSRR, CS_HIGH);
+	
+	/* Next transaction is on the bus */
+	CHECK_EQ(fake_dma_start_count, 4);
+	CHECK_EQ(GPIOB->BSRR, CS_LOW);
+	CHECK(hspi.QueueHead == &trans[1]);
+	CHECK_EQ(hspi.QueueBusy, 1);
+	
+	fake_dma_complete(&hdmarx);
+	
+	CHECK_EQ(done_count, 2);
+	CHECK_EQ(trans[1].ErrorCode, HAL_SPI_ERROR_NONE);
+	CHECK_EQ(GPIOB->BSRR, CS_HIGH);
+	CHECK_EQ(hspi.QueueBusy, 0);
+	CHECK_EQ(hspi.state, HAL_SPI_STATE_READY);
+}
+
+/* Failure in the middle of the queue does not disturb the transactions around it */
+static void test_failure_mid_queue(void)
+{
+	spi_setup();
+	
+	hal_spi_submit(&hspi, &trans[0]);
+	hal_spi_submit(&hspi, &trans[1]);
+	hal_spi_submit(&hspi, &trans[2]);
+	
+	fake_dma_complete(&hdmarx);
+	CHECK_EQ(GPIOA->BSRR, CS_HIGH);
+	CHECK_EQ(GPIOB->BSRR, CS_LOW);
+	
+	fake_dma_error(&hdmatx);
+	CHECK_EQ(GPIOB->BSRR, CS_HIGH);
+	CHECK_EQ(GPIOC->BSRR, CS_LOW);
+	
+	fake_dma_complete(&hdmarx);
+	CHECK_EQ(GPIOC->BSRR, CS_HIGH);
+	
+	CHECK_EQ(done_count, 3);
+	CHECK(done[0] == &trans[0]);
+	CHECK(done[1] == &trans[1]);
+	CHECK(done[2] == &trans[2]);
+	CHECK_EQ(trans[0].ErrorCode, HAL_SPI_ERROR_NONE);
+	CHECK_EQ(trans[1].ErrorCode, HAL_SPI_ERROR_DMA);
+	CHECK_EQ(trans[2].ErrorCode, HAL_SPI_ERROR_NONE);
+	CHECK_EQ(hspi.QueueBusy, 0);
+	CHECK(hspi.QueueHead == 0);
+	CHECK(hspi.QueueTail == 0);
+	
+	/* Bus is usable again */
+	hal_spi_submit(&hspi, &trans[0]);
+	CHECK_EQ(GPIOA->BSRR, CS_LOW);
+	fake_dma_complete(&hdmarx);
+	CHECK_EQ(done_count, 4);
+	CHECK_EQ(trans[0].ErrorCode, HAL_SPI_ERROR_NONE);
+}
+
+/* Aborting the transaction on the bus completes it and moves on */
+static void test_abort_transaction(void)
+{
+	spi_setup();
+	
+	/* Nothing queued, nothing to abort */
+	hal_spi_abort_transaction(&hspi);
+	CHECK_EQ(done_count, 0);
+	
+	hal_spi_submit(&hspi, &trans[0]);
+	hal_spi_submit(&hspi, &trans[1]);
+	
+	hal_spi_abort_transaction(&hspi);
+	CHECK_EQ(done_count, 1);
+	CHECK_EQ(trans[0].ErrorCode, HAL_SPI_ERROR_ABORT);
+	CHECK_EQ(GPIOA->BSRR, CS_HIGH);
+	CHECK_EQ(fake_dma_abort_count, 2);
+	CHECK_EQ(__get_PRIMASK(), 0);
+	
+	CHECK_EQ(GPIOB->BSRR, CS_LOW);
+	fake_dma_complete(&hdmarx);
+	CHECK_EQ(done_count, 2);
+	CHECK_EQ(trans[1].ErrorCode, HAL_SPI_ERROR_NONE);
+	CHECK_EQ(hspi.QueueBusy, 0);
+}
+
+int main(void)
+{
+	test_dma_error_completes_transaction();
+	test_failure_mid_queue();
+	test_abort_transaction();
+	
+	return TEST_RESULT();
+}
@@ -6,7 +6,11 @@
 ***************************************************************************************************************************/
 
 #include <stdint.h>
+#include <string.h>
 #include "hal_spi_driver.h"
+#include "hal_rcc_driver.h"
+
+static void hal_spi_queue_next(spi_handle_t *hspi);
 
 /*************************************************************************************************************************/
 /*                                                                                                                       */
@@ -21,7 +25,7 @@
  */
 static void hal_spi_enable(SPI_TypeDef *SPIx)
 {
-	if(!(SPIx->CR1 &= SPI_REG_CR1_SPE ))
+	if(!(SPIx->CR1 & SPI_REG_CR1_SPE ))
 	{
 		SPIx->CR1 |= SPI_REG_CR1_SPE;
 	}
@@ -175,6 +179,7 @@ static void hal_spi_configure_nss_slave(SPI_TypeDef *SPIx, uint32_t ssm_enable)
  */
 static void hal_spi_configure_buadrate(SPI_TypeDef *SPIx, uint32_t baud_rate)
 {
+	SPIx->CR1 &= ~SPI_REG_CR1_BR_MASK;
 	SPIx->CR1 |= baud_rate;
 }
 
@@ -190,13 +195,33 @@ static void hal_spi_configure_device_direction(SPI_TypeDef *SPIx, uint32_t spi_d
 {
 	if(spi_direction)
 	{ 
-		//1-line bidirectional data mode selected
-		SPIx->CR1 |= SPI_REG_CR1_BIDIMODE;
+		//1-line bidirectional data mode selected, line is driven(output) until a reception turns it around
+		SPIx->CR1 |= (SPI_REG_CR1_BIDIMODE | SPI_REG_CR1_BIDIOE);
 	}
 	else
 	{
 		//2-line unidirectional data mode selected
-		SPIx->CR1 &= ~SPI_REG_CR1_BIDIMODE;
+		SPIx->CR1 &= ~(SPI_REG_CR1_BIDIMODE | SPI_REG_CR1_BIDIOE);
+	}
+}
+
+
+
+/**
+  * @brief Configures Motorola or TI frame format
+  * @param *SPIx : Based address of SPI
+  * @param frame_format : SPI_MOTOROLA_MODE or SPI_TI_MODE
+  * @retval none
+ */
+static void hal_spi_configure_frame_format(SPI_TypeDef *SPIx, uint32_t frame_format)
+{
+	if(frame_format == SPI_TI_MODE)
+	{
+		SPIx->CR2 |= SPI_REG_CR2_FRAME_FORMAT;
+	}
+	else
+	{
+		SPIx->CR2 &= ~SPI_REG_CR2_FRAME_FORMAT;
 	}
 }
 
@@ -263,6 +288,114 @@ static uint8_t hal_spi_is_bus_busy(SPI_TypeDef *SPIx)
 }
 	
 
+/**
+  * @brief Returns the size of one data frame in bytes
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval 1 for 8 bit frames, 2 for 16 bit frames
+ */
+static uint32_t hal_spi_frame_size(spi_handle_t *hspi)
+{
+	return (hspi->Init.DataSize == SPI_8BIT_DF_ENABLE) ? 1 : 2;
+}
+
+
+/**
+  * @brief Checks if master is receiving while it transmits, TX has to be paced by RX then
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval 1 if master reception is on going
+ */
+static uint8_t hal_spi_is_rx_running(spi_handle_t *hspi)
+{
+	return (hspi->Init.Mode &&
+	        ((hspi->state == HAL_SPI_STATE_BUSY_RX) || (hspi->state == HAL_SPI_STATE_BUSY_TX_RX)));
+}
+
+
+/**
+  * @brief Configures hardware CRC calculation, SPI must be disabled
+  * @param *SPIx : Based address of SPI
+  * @param crc_enable : if 1, CRC is calculated and sent/checked at the end of every transfer
+  * @param polynomial : CRC polynomial, CRC width follows the data frame size
+  * @retval none
+ */
+static void hal_spi_configure_crc(SPI_TypeDef *SPIx, uint32_t crc_enable, uint32_t polynomial)
+{
+	if(crc_enable)
+	{
+		SPIx->CRCPR = polynomial;
+		SPIx->CR1 |= SPI_REG_CR1_CRCEN;
+	}
+	else
+	{
+		SPIx->CR1 &= ~SPI_REG_CR1_CRCEN;
+	}
+}
+
+
+/**
+  * @brief Clears TXCRCR/RXCRCR before a new transfer, CRC unit is reset by toggling CRCEN while SPI is disabled
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_reset_crc(spi_handle_t *hspi)
+{
+	hspi->ErrorCode &= ~HAL_SPI_ERROR_CRC;
+	
+	if(hspi->Init.CRCCalculation == SPI_CRC_DISABLE)
+		return;
+	
+	hal_spi_disable(hspi->Instance);
+	hspi->Instance->CR1 &= ~SPI_REG_CR1_CRCEN;
+	hspi->Instance->CR1 |= SPI_REG_CR1_CRCEN;
+}
+
+
+/**
+  * @brief Reads the received CRC frame, hardware compares it with RXCRCR and sets CRCERR on mismatch
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_check_crc(spi_handle_t *hspi)
+{
+	uint32_t val;
+	
+	/* CRC frame has to be read out of DR like any data frame */
+	val = hspi->Instance->DR;
+	(void)val;
+	
+	if(hspi->Instance->SR & SPI_REG_SR_CRCERR_FLAG)
+	{
+		/* CRCERR is cleared by writing 0 to it */
+		hspi->Instance->SR &= ~SPI_REG_SR_CRCERR_FLAG;
+		hspi->ErrorCode |= HAL_SPI_ERROR_CRC;
+		
+		/* A queued transaction reports the error through its own callback */
+		if(hspi->error_cb && !hspi->QueueBusy)
+			hspi->error_cb(hspi);
+	}
+}
+
+
+/**
+  * @brief Busy waits for atleast one SCK period. SCK period is 2^(BR + 1) cycles of the APB clock of the SPI,
+  *        the CPU runs HCLK / PCLK times faster, so the count is scaled to CPU cycles. A loop pass takes more
+  *        than one CPU cycle, so the wait is never shorter than one SCK period.
+  * @param *SPIx : Based address of SPI
+  * @retval none
+ */
+static void hal_spi_wait_sck_period(SPI_TypeDef *SPIx)
+{
+	/* SPI1 is on APB2, SPI2 and SPI3 on APB1 */
+	uint32_t pclk = (SPIx == SPI1) ? hal_rcc_get_pclk2_freq() : hal_rcc_get_pclk1_freq();
+	volatile uint32_t count = (uint32_t)2 << ((SPIx->CR1 & SPI_REG_CR1_BR_MASK) >> 3);
+	
+	if(pclk)
+		count *= (hal_rcc_get_hclk_freq() / pclk);
+	
+	while(count--);
+}
+
+
 /**
   * @brief Close TX transfer 
   * @param SPIx:  SPI base address 
@@ -274,8 +407,13 @@ static void hal_spi_close_tx_interrupt(spi_handle_t *hspi)
   hal_spi_disable_txe_interrupt(hspi->Instance);
 	
 	/*Make state ready only when we are in master mode and driver in not in Receiving data*/
-	if(hspi->Init.Mode && (hspi->state != HAL_SPI_STATE_BUSY_RX))
+	if(hspi->Init.Mode && (hspi->state == HAL_SPI_STATE_BUSY_TX))
+	{
 		hspi->state = HAL_SPI_STATE_READY;
+		
+		if(hspi->xfer_cplt_cb)
+			hspi->xfer_cplt_cb(&hspi->TxXferSize);
+	}
 }
 
 
@@ -286,227 +424,1091 @@ static void hal_spi_close_tx_interrupt(spi_handle_t *hspi)
  */
 static void hal_spi_close_rx_interrupt(spi_handle_t *hspi)
 {
- while(hal_spi_is_bus_busy(hspi->Instance));
+	while(hal_spi_is_bus_busy(hspi->Instance));
 	
 	/*Disable RXNE interrupt*/
 	hal_spi_disable_rxne_interrupt(hspi->Instance);
 	hspi->state = HAL_SPI_STATE_READY;
+	
+	if(hspi->QueueBusy)
+		hal_spi_queue_next(hspi);
+	else if(hspi->xfer_cplt_cb)
+		hspi->xfer_cplt_cb(&hspi->RxXferSize);
 }
 		
 	
-/*******************************************************************************************************************************************/
-/*                                                                                                                                         */
-/*                                               Driver Exposed APIs                                                                       */
-/*                                                                                                                                         */
-/*******************************************************************************************************************************************/
+/**
+  * @brief Checks if TX has to wait for RX. While receiving, atmost two frames(shift register + TX buffer)
+  *        are kept ahead of RX, RXNE interrupt resumes TX, so RX buffer can never overrun
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval 1 if TXE interrupt was disabled and nothing must be written
+ */
+static uint8_t hal_spi_tx_throttle(spi_handle_t *hspi)
+{
+	if(hal_spi_is_rx_running(hspi) && ((hspi->RxXferCount - hspi->TxXferCount) >= 2))
+	{
+		hal_spi_disable_txe_interrupt(hspi->Instance);
+		return 1;
+	}
+	
+	return 0;
+}
 
 
 /**
-  * @brief API given to initialize then given SPI device
-  * @param *SPIx : Based address of SPI
-  * @param *buffer  : Pointer to RX buffer 
-  * @param len : lenght of RX data 
+  * @brief Common end of a TXE interrupt, counts the frame and closes TX after the last one
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_init(spi_handle_t *spi_handle)
+static void hal_spi_tx_frame_done(spi_handle_t *hspi)
 {
-	/* Configure phase and polarity */
-	hal_spi_configure_phase_and_polarity(spi_handle->Instance, spi_handle->Init.CLKPhase,spi_handle->Init.CLKPolarity);
-	
-	/*Configure the SPI device mode */
-	hal_spi_configure_device_mode(spi_handle->Instance,spi_handle->Init.Mode);
-	
-	/*configure the spi data size */
-	hal_spi_configure_datasize(spi_handle->Instance,spi_handle->Init.DataSize,spi_handle->Init.FirstBit);
-	
-	/*configure the slave select line*/
-	hal_spi_configure_nss_master(spi_handle->Instance, spi_handle->Init.NSS);
-	hal_spi_configure_nss_slave(spi_handle->Instance, spi_handle->Init.NSS);
-	
-	/*configure spi device speed*/
-	hal_spi_configure_buadrate(spi_handle->Instance,spi_handle->Init.BaudRatePreScalar);
-	
-	/*Configure spi device direction */
-	hal_spi_configure_device_direction(spi_handle->Instance, spi_handle->Init.Direction);
-	
+	if(--hspi->TxXferCount == 0)
+	{
+		/* CRC is sent right after the last data frame */
+		if(hspi->Init.CRCCalculation == SPI_CRC_ENABLE)
+			hspi->Instance->CR1 |= SPI_REG_CR1_CRCNEXT;
+		
+		/*We reached end of TX, close TX interrupt*/
+		hal_spi_close_tx_interrupt(hspi);
+	}
 }
 
-	
 
 /**
-  * @brief API used to do master data transmission 
-  * @param *SPIx : Based address of SPI
-  * @param *buffer  : Pointer to tx buffer 
-  * @param len : lenght of tx data 
+  * @brief Common end of a RXNE interrupt, counts the frame and closes RX after the last one
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_master_tx(spi_handle_t *spi_handle, uint8_t *buffer , uint32_t len)
+static void hal_spi_rx_frame_done(spi_handle_t *hspi)
 {
-	spi_handle->pTxBuffPtr = buffer;
-	spi_handle->TxXferCount = len;
-	spi_handle->TxXferSize = len;
-	
-	spi_handle->state = HAL_SPI_STATE_BUSY_TX;
-	
-	hal_spi_enable(spi_handle->Instance);
-	
-	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+	if(--hspi->RxXferCount == 0)
+	{
+		/* With CRC enabled one more RXNE brings the CRC frame */
+		if(hspi->Init.CRCCalculation == SPI_CRC_DISABLE)
+		{
+			/* Receiving of data is completed, close the RXNE interrupt*/
+			hal_spi_close_rx_interrupt(hspi);
+		}
+	}
+	else if(hal_spi_is_rx_running(hspi) && hspi->TxXferCount)
+	{
+		/* One frame less in flight, TX can go ahead */
+		hal_spi_enable_txe_interrupt(hspi->Instance);
+	}
 }
 
 
 /**
-  * @brief API used to do master data reception
-  * @param *SPIx : Based address of SPI
-  * @param *buffer  : Pointer to tx buffer 
-  * @param len : lenght of tx data 
+  * @brief Handles TXE interrupt for 8 bit frames
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_master_rx(spi_handle_t *spi_handle, uint8_t *rx_buffer, uint32_t len)
+static void hal_spi_handle_tx_interrupt_8bit(spi_handle_t *hspi)
 {
-	uint32_t val;
-	
-	/*this is dummy tx*/
-	spi_handle->pTxBuffPtr = rx_buffer;
-	spi_handle->TxXferCount = len;
-	spi_handle->TxXferSize = len;
-	
-	/*data will received on RX buffer */
-	spi_handle->pRxBuffPtr = rx_buffer;
-	spi_handle->RxXferCount = len;
-	spi_handle->RxXferSize = len;
-	
-	/* driver is busy in rx */
-	spi_handle->state = HAL_SPI_STATE_BUSY_RX;
-	
-	hal_spi_enable(spi_handle->Instance);
-	
-	/* read the data register once before enabling the RXNE
-	interrupt to make sure DR is emty */
-	val = spi_handle->Instance->DR; 
+	if(hal_spi_tx_throttle(hspi))
+		return;
 	
-	/* Now eanable both txe and rxe interrupt */
-	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
-	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+	if(hspi->pTxBuffPtr)
+		hspi->Instance->DR = (*hspi->pTxBuffPtr++);
+	else
+		hspi->Instance->DR = (uint8_t)SPI_DUMMY_BYTE;
 	
+	hal_spi_tx_frame_done(hspi);
 }
 
 
-
 /**
-  * @brief API used to do slave data transmission
-  * @param *SPIx : Based address of SPI
-  * @param *buffer  : Pointer to tx buffer 
-  * @param len : lenght of tx data 
+  * @brief Handles TXE interrupt for 16 bit frames, buffer need not be half word aligned
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_slave_tx(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint32_t len)
+static void hal_spi_handle_tx_interrupt_16bit(spi_handle_t *hspi)
 {
+	uint16_t frame = SPI_DUMMY_BYTE;
 	
-	/*populate pointers and length information to Tx the data*/
-	spi_handle->pTxBuffPtr = tx_buffer;
-	spi_handle->TxXferCount = len;
-	spi_handle->TxXferSize = len;
-	
-	/*pointers to handle dummy rx , you can reuse the same pointer */
-	spi_handle->pRxBuffPtr = tx_buffer;
-	spi_handle->RxXferCount = len;
-	spi_handle->RxXferSize = len;
-	
-	/*driver is busy in doing TX*/
-	spi_handle->state = HAL_SPI_STATE_BUSY_TX;
+	if(hal_spi_tx_throttle(hspi))
+		return;
 	
-	hal_spi_enable(spi_handle->Instance);
+	if(hspi->pTxBuffPtr)
+	{
+		/* Cortex-M4 allows unaligned half word loads, memcpy compiles to a single LDRH */
+		memcpy(&frame, hspi->pTxBuffPtr, 2);
+		hspi->pTxBuffPtr += 2;
+	}
 	
-	/*Now enable both rxne and txe */
-	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
-	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+	hspi->Instance->DR = frame;
 	
+	hal_spi_tx_frame_done(hspi);
 }
 
+
 /**
-  * @brief API used to do slave data reception
-  * @param *SPIx : Based address of SPI
-  * @param *buffer  : Pointer to RX buffer 
-  * @param len : lenght of RX data 
+  * @brief Handles RXNE interrupt for 8 bit frames
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_slave_rx(spi_handle_t *spi_handle, uint8_t *rcv_buffer , uint32_t len)
+static void hal_spi_handle_rx_interrupt_8bit(spi_handle_t *hspi)
 {
-	/*populate the rcv_buffer and along with the size in handle */
-	spi_handle->pRxBuffPtr = rcv_buffer;
-	spi_handle->RxXferCount = len;
-	spi_handle->RxXferSize = len;
+	uint8_t frame;
 	
-	/*driver in busy in RX*/
-	spi_handle->state = HAL_SPI_STATE_BUSY_RX;
+	/* All data is in, this is the CRC frame */
+	if(hspi->RxXferCount == 0)
+	{
+		hal_spi_check_crc(hspi);
+		hal_spi_close_rx_interrupt(hspi);
+		return;
+	}
 	
-	/*slave need to receive data so enable rxne interrupt*/
-	/*byte reception will be taken care in  RXNE interrupt handling code*/
+	/*a read from the data register will return the value held in the Rx buffer*/
+	frame = (uint8_t)hspi->Instance->DR;
 	
+	//NULL check
+	if(hspi->pRxBuffPtr)
+		*hspi->pRxBuffPtr++ = frame;
+	
+	hal_spi_rx_frame_done(hspi);
 }
 
+
 /**
-  * @brief Handles TXE interrupts.
-  * @param hspi : pointer to spi_handle_t structre that contains the configuration 
-                   information for SPI Module.
+  * @brief Handles RXNE interrupt for 16 bit frames, buffer need not be half word aligned
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_handle_tx_interrupt(spi_handle_t *hspi)
+static void hal_spi_handle_rx_interrupt_16bit(spi_handle_t *hspi)
 {
-	/* Transmitt the data in 8 bit mode*/
-  if(hspi->Init.DataSize == SPI_8BIT_DF_ENABLE)
-	{
-    hspi->Instance->DR = (*hspi->pTxBuffPtr++);
-    hspi->TxXferCount--; // Sent 1 byte
-  }
+	uint16_t frame;
 	
- /* Trasnmitt the data in 16 bit mode*/
- 	else
+	if(hspi->RxXferCount == 0)
 	{
-    hspi->Instance->DR = *((uint16_t *)hspi->pTxBuffPtr);
-    hspi->pTxBuffPtr += 2;
-		hspi->TxXferCount -=2; // Sent 2 bytes in one go
+		hal_spi_check_crc(hspi);
+		hal_spi_close_rx_interrupt(hspi);
+		return;
 	}
 	
-	if(hspi->TxXferCount == 0)
+	frame = (uint16_t)hspi->Instance->DR;
+	
+	if(hspi->pRxBuffPtr)
 	{
-		/*We reached end of TX, close TX interrupt*/
-		hal_spi_close_tx_interrupt(hspi);
+		memcpy(hspi->pRxBuffPtr, &frame, 2);
+		hspi->pRxBuffPtr += 2;
 	}
 	
+	hal_spi_rx_frame_done(hspi);
 }
 
 
 /**
-  * @brief Handles RXNE interrupts.
-  * @param hspi : pointer to spi_handle_t structre that contains the configuration 
-                   information for SPI Module.
+  * @brief Picks the TXE/RXNE handlers for the configured frame size, so the ISR does not test DataSize per frame
+  * @param hspi : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_handle_rx_interrupt(spi_handle_t *hspi)
+static void hal_spi_select_isr(spi_handle_t *hspi)
 {
-	/* Receive Data in 8 bit mode*/
 	if(hspi->Init.DataSize == SPI_8BIT_DF_ENABLE)
 	{
-		//NULL check
-		if(hspi->pRxBuffPtr++)
-			*(hspi->pRxBuffPtr) = hspi->Instance->DR ; /*a read from the data register will return the value held in the Rx buffer*/
-		
-		hspi->RxXferCount--;
+		hspi->TxISR = hal_spi_handle_tx_interrupt_8bit;
+		hspi->RxISR = hal_spi_handle_rx_interrupt_8bit;
 	}
 	else
 	{
-		*((uint16_t*)hspi->pRxBuffPtr) = hspi->Instance->DR;
-		hspi->pRxBuffPtr += 2;
-		hspi->RxXferCount -= 2;
+		hspi->TxISR = hal_spi_handle_tx_interrupt_16bit;
+		hspi->RxISR = hal_spi_handle_rx_interrupt_16bit;
 	}
+}
+
+
+/**
+  * @brief Carries out a master transfer upto SPI_POLL_THRESHOLD bytes by polling, it is over before the
+  *        interrupt path would have been set up. xfer_cplt_cb is called just like at the end of an interrupt transfer
+  * @param hspi : pointer to spi_handle_t structure
+  * @param *tx_buffer : Pointer to tx buffer, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : Pointer to RX buffer, if NULL received data is discarded
+  * @param len : lenght of data in bytes
+  * @retval none
+ */
+static void hal_spi_master_poll(spi_handle_t *hspi, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len)
+{
+	hspi->TxXferSize = len;
+	hspi->RxXferSize = len;
 	
-	if(hspi->RxXferCount == 0)
+	hal_spi_master_tx_rx_poll(hspi, tx_buffer, rx_buffer, len);
+	
+	if(hspi->xfer_cplt_cb)
+		hspi->xfer_cplt_cb(rx_buffer ? &hspi->RxXferSize : &hspi->TxXferSize);
+}
+
+
+/**
+  * @brief Matches the DMA stream to the transfer, stream is reconfigured only when a setting changes
+  * @param *hdma : pointer to handle structure of DMA stream
+  * @param mem_inc : 1 to increment memory address, 0 to use a single dummy location
+  * @param data_size : DMA_DATA_SIZE_BYTE or DMA_DATA_SIZE_HALFWORD as per SPI frame size
+  * @retval none
+ */
+static void hal_spi_dma_configure(dma_handle_t *hdma, uint32_t mem_inc, uint32_t data_size)
+{
+	if((hdma->Init.MemInc != mem_inc) || (hdma->Init.MemDataAlignment != data_size) ||
+		 (hdma->Init.PeriphDataAlignment != data_size))
 	{
-		/* Receiving of data is completed, close the RXNE interrupt*/
-		hal_spi_close_rx_interrupt(hspi);
+		hdma->Init.MemInc = mem_inc;
+		hdma->Init.MemDataAlignment = data_size;
+		hdma->Init.PeriphDataAlignment = data_size;
+		hal_dma_init(hdma);
 	}
 }
+
+
+/**
+  * @brief Ends a DMA transfer, disables the DMA requests and releases the TX stream
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_dma_close(spi_handle_t *hspi)
+{
+	hspi->Instance->CR2 &= ~(SPI_REG_CR2_TXDMAEN | SPI_REG_CR2_RXDMAEN);
+	
+	/*TX stream runs without interrupts, mark it ready here, continuous slave reception has no TX stream */
+	if(hspi->hdmatx)
+		hal_dma_abort(hspi->hdmatx);
+}
+
+
+/**
+  * @brief RX DMA stream completion, last frame is received so TX side is finished too
+  * @param *hdma : pointer to handle structure of DMA stream
+  * @retval none
+ */
+static void hal_spi_dma_rx_cplt(void *hdma)
+{
+	spi_handle_t *hspi = (spi_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	/* TX stream sent the CRC by itself, received CRC is left in DR */
+	if(hspi->Init.CRCCalculation == SPI_CRC_ENABLE)
+	{
+		while(!(hspi->Instance->SR & SPI_REG_SR_RXNE_FLAG));
+		hal_spi_check_crc(hspi);
+	}
+	
+	while(hal_spi_is_bus_busy(hspi->Instance));
+	
+	hal_spi_dma_close(hspi);
+	
+	hspi->state = HAL_SPI_STATE_READY;
+	
+	if(hspi->QueueBusy)
+		hal_spi_queue_next(hspi);
+	else if(hspi->xfer_cplt_cb)
+		hspi->xfer_cplt_cb(&hspi->RxXferSize);
+}
+
+
+/**
+  * @brief RX DMA stream switched buffers during continuous slave reception, hands the full one to application
+  * @param *hdma : pointer to handle structure of DMA stream
+  * @retval none
+ */
+static void hal_spi_dma_rx_buffer_full(void *hdma)
+{
+	dma_handle_t *hdmarx = (dma_handle_t *)hdma;
+	spi_handle_t *hspi = (spi_handle_t *)hdmarx->Parent;
+	uint8_t *full;
+	
+	/* Stream already moved on, so the full buffer is the one it is not pointing to */
+	if(hal_dma_get_current_target(hdmarx))
+		full = (uint8_t *)hdmarx->Instance->M0AR;
+	else
+		full = (uint8_t *)hdmarx->Instance->M1AR;
+	
+	if(hspi->rx_event_cb)
+		hspi->rx_event_cb(full, hspi->RxXferSize);
+}
+
+
+/**
+  * @brief DMA stream error on either TX or RX stream
+  * @param *hdma : pointer to handle structure of DMA stream
+  * @retval none
+ */
+static void hal_spi_dma_error(void *hdma)
+{
+	spi_handle_t *hspi = (spi_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hal_dma_abort(hspi->hdmarx);
+	hal_spi_dma_close(hspi);
+	
+	hspi->ErrorCode |= HAL_SPI_ERROR_DMA;
+	
+	/* Queued transaction fails on its own, chip select is released and the queue moves on */
+	if(hspi->QueueBusy)
+	{
+		/* Frame in the shift register is finished even with the DMA requests disabled */
+		while(hal_spi_is_bus_busy(hspi->Instance));
+		
+		hspi->state = HAL_SPI_STATE_READY;
+		hal_spi_queue_next(hspi);
+		return;
+	}
+	
+	hspi->state = HAL_SPI_STATE_ERROR;
+	
+	if(hspi->error_cb)
+		hspi->error_cb(hspi);
+}
+		
+	
+/**
+  * @brief Reconfigures the bus for the given device, SPI must be idle
+  * @param hspi : pointer to spi_handle_t structure
+  * @param *device : device to be selected
+  * @retval none
+ */
+static void hal_spi_select_device(spi_handle_t *hspi, spi_device_t *device)
+{
+	if(hspi->ActiveDevice == device)
+		return;
+	
+	/* Clock and frame settings can be changed only when SPI is disabled */
+	hal_spi_disable(hspi->Instance);
+	
+	hspi->Init.CLKPhase = device->Init.CLKPhase;
+	hspi->Init.CLKPolarity = device->Init.CLKPolarity;
+	hspi->Init.DataSize = device->Init.DataSize;
+	hspi->Init.FirstBit = device->Init.FirstBit;
+	hspi->Init.BaudRatePreScalar = device->Init.BaudRatePreScalar;
+	
+	hal_spi_configure_phase_and_polarity(hspi->Instance, hspi->Init.CLKPhase, hspi->Init.CLKPolarity);
+	hal_spi_configure_datasize(hspi->Instance, hspi->Init.DataSize, hspi->Init.FirstBit);
+	hal_spi_select_isr(hspi);
+	hal_spi_configure_buadrate(hspi->Instance, hspi->Init.BaudRatePreScalar);
+	
+	hspi->ActiveDevice = device;
+}
+
+
+/**
+  * @brief Releases chip select, removes the transaction at head of the queue and calls its callback
+  *        with the error of the transfer recorded in the transaction
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_queue_complete(spi_handle_t *hspi)
+{
+	spi_transaction_t *t = hspi->QueueHead;
+	uint32_t primask;
+	
+	/* Bus is idle(BSY = 0), so chip select can be released */
+	hal_gpio_write_to_pin(t->Device->CsPort, t->Device->CsPin, 1);
+	
+	t->ErrorCode = hspi->ErrorCode;
+	
+	/* Driver is the only one removing entries, application only appends with interrupts masked */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	hspi->QueueHead = t->Next;
+	if(hspi->QueueHead == 0)
+		hspi->QueueTail = 0;
+	
+	__set_PRIMASK(primask);
+	
+	if(t->cb)
+		t->cb(t);
+}
+
+
+/**
+  * @brief Works through the queue, transactions upto SPI_POLL_THRESHOLD bytes are polled in place, the first
+  *        longer one is started and the rest is chained from its completion interrupt
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_queue_start(spi_handle_t *hspi)
+{
+	spi_transaction_t *t;
+	uint32_t primask;
+	
+	while(1)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		
+		t = hspi->QueueHead;
+		
+		/* Queue drained, a new submit has to start the bus again */
+		if(t == 0)
+			hspi->QueueBusy = 0;
+		
+		__set_PRIMASK(primask);
+		
+		if(t == 0)
+			return;
+		
+		hal_spi_select_device(hspi, t->Device);
+		
+		hal_gpio_write_to_pin(t->Device->CsPort, t->Device->CsPin, 0);
+		
+		hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+		
+		if(t->Len <= SPI_POLL_THRESHOLD)
+		{
+			hal_spi_master_tx_rx_poll(hspi, t->pTxBuffer, t->pRxBuffer, t->Len);
+			hal_spi_queue_complete(hspi);
+			continue;
+		}
+		
+		if(hspi->hdmatx && hspi->hdmarx)
+			hal_spi_transfer_dma(hspi, t->pTxBuffer, t->pRxBuffer, t->Len / hal_spi_frame_size(hspi));
+		else
+			hal_spi_master_tx_rx(hspi, t->pTxBuffer, t->pRxBuffer, t->Len);
+		
+		return;
+	}
+}
+
+
+/**
+  * @brief Completes the transaction at head of the queue and chains the next one, called from ISR
+  * @param hspi : pointer to spi_handle_t structure
+  * @retval none
+ */
+static void hal_spi_queue_next(spi_handle_t *hspi)
+{
+	hal_spi_queue_complete(hspi);
+	
+	/* Callback may have queued more, next transaction starts without going back to thread context */
+	hal_spi_queue_start(hspi);
+}
+		
+	
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                               Driver Exposed APIs                                                                       */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+
+/**
+  * @brief API given to initialize then given SPI device
+  * @param *SPIx : Based address of SPI
+  * @param *buffer  : Pointer to RX buffer 
+  * @param len : lenght of RX data 
+  * @retval none
+ */
+void hal_spi_init(spi_handle_t *spi_handle)
+{
+	/* Configure phase and polarity */
+	hal_spi_configure_phase_and_polarity(spi_handle->Instance, spi_handle->Init.CLKPhase,spi_handle->Init.CLKPolarity);
+	
+	/*Configure the SPI device mode */
+	hal_spi_configure_device_mode(spi_handle->Instance,spi_handle->Init.Mode);
+	
+	/*configure the spi data size */
+	hal_spi_configure_datasize(spi_handle->Instance,spi_handle->Init.DataSize,spi_handle->Init.FirstBit);
+	hal_spi_select_isr(spi_handle);
+	
+	/*configure the slave select line*/
+	hal_spi_configure_nss_master(spi_handle->Instance, spi_handle->Init.NSS);
+	hal_spi_configure_nss_slave(spi_handle->Instance, spi_handle->Init.NSS);
+	
+	/*configure spi device speed*/
+	hal_spi_configure_buadrate(spi_handle->Instance,spi_handle->Init.BaudRatePreScalar);
+	
+	/*Configure spi device direction */
+	hal_spi_configure_device_direction(spi_handle->Instance, spi_handle->Init.Direction);
+	
+	/*Configure frame format */
+	hal_spi_configure_frame_format(spi_handle->Instance, spi_handle->Init.FrameFormat);
+	
+	/*Configure hardware CRC */
+	hal_spi_configure_crc(spi_handle->Instance, spi_handle->Init.CRCCalculation, spi_handle->Init.CRCPolynomial);
+	
+}
+
+	
+
+/**
+  * @brief API used to do master data transmission 
+  * @param *SPIx : Based address of SPI
+  * @param *buffer  : Pointer to tx buffer 
+  * @param len : lenght of tx data 
+  * @retval none
+ */
+void hal_spi_master_tx(spi_handle_t *spi_handle, uint8_t *buffer , uint32_t len)
+{
+	/* Short transfer is done before the interrupt path would have been set up */
+	if(len <= SPI_POLL_THRESHOLD)
+	{
+		hal_spi_master_poll(spi_handle, buffer, 0, len);
+		return;
+	}
+	
+	spi_handle->pTxBuffPtr = buffer;
+	spi_handle->TxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->TxXferSize = len;
+	
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+}
+
+
+/**
+  * @brief API used to do master data reception
+  * @param *SPIx : Based address of SPI
+  * @param *buffer  : Pointer to tx buffer 
+  * @param len : lenght of tx data 
+  * @retval none
+ */
+void hal_spi_master_rx(spi_handle_t *spi_handle, uint8_t *rx_buffer, uint32_t len)
+{
+	if(len <= SPI_POLL_THRESHOLD)
+	{
+		hal_spi_master_poll(spi_handle, 0, rx_buffer, len);
+		return;
+	}
+	
+	/*this is dummy tx, SPI_DUMMY_BYTE is sent */
+	spi_handle->pTxBuffPtr = 0;
+	spi_handle->TxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->TxXferSize = len;
+	
+	/*data will received on RX buffer */
+	spi_handle->pRxBuffPtr = rx_buffer;
+	spi_handle->RxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->RxXferSize = len;
+	
+	/* driver is busy in rx */
+	spi_handle->state = HAL_SPI_STATE_BUSY_RX;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	/* read the data register once before enabling the RXNE
+	interrupt to make sure DR is emty */
+	(void)spi_handle->Instance->DR;
+	
+	/* Now eanable both txe and rxe interrupt */
+	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
+	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+	
+}
+
+
+
+/**
+  * @brief API used to do master full duplex transfer, tx_buffer is sent while rx_buffer is filled
+  *        in the same clock cycles. Completion is indicated by state going back to HAL_SPI_STATE_READY
+  *        and xfer_cplt_cb. Upto SPI_POLL_THRESHOLD bytes are polled, the transfer is then completed on return.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : Pointer to tx buffer, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : Pointer to RX buffer, if NULL received data is discarded
+  * @param len : lenght of data in bytes
+  * @retval none
+ */
+void hal_spi_master_tx_rx(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len)
+{
+	uint32_t val;
+	
+	if(len <= SPI_POLL_THRESHOLD)
+	{
+		hal_spi_master_poll(spi_handle, tx_buffer, rx_buffer, len);
+		return;
+	}
+	
+	spi_handle->pTxBuffPtr = tx_buffer;
+	spi_handle->TxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->TxXferSize = len;
+	
+	spi_handle->pRxBuffPtr = rx_buffer;
+	spi_handle->RxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->RxXferSize = len;
+	
+	/* driver is busy in tx and rx */
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX_RX;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	/* read the data register once before enabling the RXNE
+	interrupt to make sure DR is emty */
+	val = spi_handle->Instance->DR;
+	(void)val;
+	
+	/* Now eanable both txe and rxe interrupt */
+	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
+	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+}
+
+
+
+/**
+  * @brief API used to do master full duplex transfer by polling, returns when transfer is completed.
+  *        Next frame is written while current one is shifted out and SPI is left enabled.
+  *        Faster than the interrupt APIs for register sized transfers, no callback is called.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : Pointer to tx buffer, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : Pointer to RX buffer, if NULL received data is discarded
+  * @param len : lenght of data in bytes
+  * @retval none
+ */
+void hal_spi_master_tx_rx_poll(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len)
+{
+	SPI_TypeDef *SPIx = spi_handle->Instance;
+	uint32_t step = hal_spi_frame_size(spi_handle);
+	uint32_t tx_left = len / step;
+	uint32_t rx_left = tx_left;
+	uint16_t frame;
+	
+	if(rx_left == 0)
+		return;
+	
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX_RX;
+	
+	hal_spi_reset_crc(spi_handle);
+	
+	/* Peripheral is left enabled after the transfer, so this is a single read when it is already on */
+	hal_spi_enable(SPIx);
+	
+	/* Flush a stale frame, DR is volatile so the read is not optimized away */
+	(void)SPIx->DR;
+	
+	while(rx_left)
+	{
+		/* Keep next frame in TX buffer while current one is shifted out, so clock never stops */
+		if(tx_left && (SPIx->SR & SPI_REG_SR_TXE_FLAG) && ((rx_left - tx_left) < 2))
+		{
+			frame = SPI_DUMMY_BYTE;
+			
+			if(tx_buffer)
+				memcpy(&frame, tx_buffer, step);
+			
+			SPIx->DR = (step == 1) ? (uint8_t)frame : frame;
+			
+			if(tx_buffer)
+				tx_buffer += step;
+			
+			/* CRC follows the last data frame */
+			if((--tx_left == 0) && (spi_handle->Init.CRCCalculation == SPI_CRC_ENABLE))
+				SPIx->CR1 |= SPI_REG_CR1_CRCNEXT;
+		}
+		
+		if(SPIx->SR & SPI_REG_SR_RXNE_FLAG)
+		{
+			frame = (uint16_t)SPIx->DR;
+			
+			if(rx_buffer)
+			{
+				/* Little endian, low byte first in 8 bit mode too */
+				memcpy(rx_buffer, &frame, step);
+				rx_buffer += step;
+			}
+			
+			rx_left--;
+		}
+	}
+	
+	if(spi_handle->Init.CRCCalculation == SPI_CRC_ENABLE)
+	{
+		while(!(SPIx->SR & SPI_REG_SR_RXNE_FLAG));
+		hal_spi_check_crc(spi_handle);
+	}
+	
+	while(hal_spi_is_bus_busy(SPIx));
+	
+	spi_handle->state = HAL_SPI_STATE_READY;
+}
+
+
+
+/**
+  * @brief API used to talk to a 3-wire(single data line) device in bidirectional mode, master sends tx_len bytes,
+  *        turns the data line around and clocks in rx_len bytes. Returns when transfer is completed.
+  *        Direction must be SPI_ENABLE_1_LINE_BIDI.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : data to be sent first, e.g. command/register address
+  * @param tx_len : number of bytes to be sent, can be 0
+  * @param *rx_buffer : received data
+  * @param rx_len : number of bytes to be received, can be 0
+  * @retval none
+ */
+void hal_spi_master_half_duplex(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint32_t tx_len, uint8_t *rx_buffer, uint32_t rx_len)
+{
+	SPI_TypeDef *SPIx = spi_handle->Instance;
+	uint32_t step = hal_spi_frame_size(spi_handle);
+	uint32_t n;
+	uint16_t frame;
+	
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX;
+	
+	/* Transmit phase, master drives the data line ------------------------------------------------- */
+	if(tx_len >= step)
+	{
+		hal_spi_disable(SPIx);
+		SPIx->CR1 |= SPI_REG_CR1_BIDIOE;
+		hal_spi_enable(SPIx);
+		
+		for(n = tx_len / step; n; n--)
+		{
+			while(!(SPIx->SR & SPI_REG_SR_TXE_FLAG));
+			
+			frame = 0;
+			memcpy(&frame, tx_buffer, step);
+			tx_buffer += step;
+			
+			SPIx->DR = frame;
+		}
+		
+		/* Line can be turned around only after the last frame is completely out */
+		while(!(SPIx->SR & SPI_REG_SR_TXE_FLAG));
+		while(hal_spi_is_bus_busy(SPIx));
+	}
+	
+	/* Receive phase, clock runs as soon as SPI is enabled with BIDIOE = 0 ------------------------- */
+	n = rx_len / step;
+	
+	if(n)
+	{
+		spi_handle->state = HAL_SPI_STATE_BUSY_RX;
+		
+		hal_spi_disable(SPIx);
+		SPIx->CR1 &= ~SPI_REG_CR1_BIDIOE;
+		
+		/* Drop whatever was shifted in while transmitting */
+		frame = (uint16_t)SPIx->DR;
+		
+		hal_spi_enable(SPIx);
+		
+		while(n)
+		{
+			/* Stop the clock during the last frame, SPE = 0 lets the current frame complete(RM0090 28.3.8) */
+			if(n == 1)
+			{
+				hal_spi_wait_sck_period(SPIx);
+				hal_spi_disable(SPIx);
+			}
+			
+			while(!(SPIx->SR & SPI_REG_SR_RXNE_FLAG));
+			
+			frame = (uint16_t)SPIx->DR;
+			memcpy(rx_buffer, &frame, step);
+			rx_buffer += step;
+			n--;
+		}
+		
+		/* Give the line back to the master for the next transfer */
+		SPIx->CR1 |= SPI_REG_CR1_BIDIOE;
+	}
+	
+	spi_handle->state = HAL_SPI_STATE_READY;
+}
+
+
+
+/**
+  * @brief API used to do slave data transmission
+  * @param *SPIx : Based address of SPI
+  * @param *buffer  : Pointer to tx buffer 
+  * @param len : lenght of tx data 
+  * @retval none
+ */
+void hal_spi_slave_tx(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint32_t len)
+{
+	
+	/*populate pointers and length information to Tx the data*/
+	spi_handle->pTxBuffPtr = tx_buffer;
+	spi_handle->TxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->TxXferSize = len;
+	
+	/*pointers to handle dummy rx , you can reuse the same pointer */
+	spi_handle->pRxBuffPtr = tx_buffer;
+	spi_handle->RxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->RxXferSize = len;
+	
+	/*driver is busy in doing TX*/
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	/*Now enable both rxne and txe */
+	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
+	hal_spi_enable_txe_interrupt(spi_handle->Instance);
+	
+}
+
+/**
+  * @brief API used to do slave data reception
+  * @param *SPIx : Based address of SPI
+  * @param *buffer  : Pointer to RX buffer 
+  * @param len : lenght of RX data 
+  * @retval none
+ */
+void hal_spi_slave_rx(spi_handle_t *spi_handle, uint8_t *rcv_buffer , uint32_t len)
+{
+	/*populate the rcv_buffer and along with the size in handle */
+	spi_handle->pRxBuffPtr = rcv_buffer;
+	spi_handle->RxXferCount = len / hal_spi_frame_size(spi_handle);
+	spi_handle->RxXferSize = len;
+	
+	/*driver in busy in RX*/
+	spi_handle->state = HAL_SPI_STATE_BUSY_RX;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	/*slave need to receive data so enable rxne interrupt*/
+	/*byte reception will be taken care in  RXNE interrupt handling code*/
+	hal_spi_enable_rxne_interrupt(spi_handle->Instance);
+}
+
+
+
+/**
+  * @brief API used to receive continuously as slave into two ping-pong buffers using DMA double buffer mode.
+  *        Every time a buffer is full the stream moves on to the other one without losing a frame, and
+  *        rx_event_cb is called with the full buffer. Application must be done with it before the other
+  *        buffer fills up. hdmarx must be initialized, reception runs until hal_spi_slave_rx_dma_stop.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *buffer0 : first receive buffer
+  * @param *buffer1 : second receive buffer
+  * @param len : size of each buffer in bytes
+  * @retval none
+ */
+void hal_spi_slave_rx_dma_double_buffer(spi_handle_t *spi_handle, uint8_t *buffer0, uint8_t *buffer1, uint32_t len)
+{
+	uint32_t data_size;
+	uint32_t val;
+	
+	spi_handle->pRxBuffPtr = buffer0;
+	spi_handle->RxXferSize = len;
+	spi_handle->RxXferCount = len / hal_spi_frame_size(spi_handle);
+	
+	spi_handle->ErrorCode = HAL_SPI_ERROR_NONE;
+	spi_handle->state = HAL_SPI_STATE_BUSY_RX;
+	
+	/*Link the DMA stream to this SPI handle, every buffer switch raises transfer complete */
+	spi_handle->hdmarx->Parent = spi_handle;
+	spi_handle->hdmarx->xfer_cplt_cb = hal_spi_dma_rx_buffer_full;
+	spi_handle->hdmarx->xfer_half_cb = 0;
+	spi_handle->hdmarx->xfer_error_cb = hal_spi_dma_error;
+	
+	data_size = (spi_handle->Init.DataSize == SPI_8BIT_DF_ENABLE) ? DMA_DATA_SIZE_BYTE : DMA_DATA_SIZE_HALFWORD;
+	hal_spi_dma_configure(spi_handle->hdmarx, 1, data_size);
+	
+	hal_spi_enable(spi_handle->Instance);
+	
+	/* read the data register once to make sure stale data is not picked by RX stream */
+	val = spi_handle->Instance->DR;
+	(void)val;
+	
+	hal_dma_start_double_buffer_it(spi_handle->hdmarx, (uint32_t)&spi_handle->Instance->DR, (uint32_t)buffer0,
+	                               (uint32_t)buffer1, spi_handle->RxXferCount);
+	
+	spi_handle->Instance->CR2 |= SPI_REG_CR2_RXDMAEN;
+}
+
+
+
+/**
+  * @brief API used to stop continuous slave reception started by hal_spi_slave_rx_dma_double_buffer
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @retval none
+ */
+void hal_spi_slave_rx_dma_stop(spi_handle_t *spi_handle)
+{
+	spi_handle->Instance->CR2 &= ~SPI_REG_CR2_RXDMAEN;
+	
+	hal_dma_abort(spi_handle->hdmarx);
+	
+	spi_handle->state = HAL_SPI_STATE_READY;
+}
+
+/**
+  * @brief API used to do a full duplex transfer using DMA, RX and TX streams run together and
+  *        only the RX stream completion raises an interrupt, xfer_cplt_cb is called from there.
+  *        hdmatx and hdmarx must be initialized, data size of the streams is matched to the SPI frame size.
+  *        len is in data frames(8 or 16 bit), for 16 bit frames buffers must be half word aligned.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : data to be sent, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : received data, if NULL received data is discarded
+  * @param len : number of data frames
+  * @retval none
+ */
+void hal_spi_transfer_dma(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len)
+{
+	static const uint16_t dummy_tx = SPI_DUMMY_BYTE;
+	static uint16_t dummy_rx;
+	uint32_t data_size;
+	uint32_t val;
+	
+	spi_handle->pTxBuffPtr = tx_buffer;
+	spi_handle->TxXferCount = len;
+	spi_handle->TxXferSize = len;
+	
+	spi_handle->pRxBuffPtr = rx_buffer;
+	spi_handle->RxXferCount = len;
+	spi_handle->RxXferSize = len;
+	
+	spi_handle->ErrorCode = HAL_SPI_ERROR_NONE;
+	spi_handle->state = HAL_SPI_STATE_BUSY_TX_RX;
+	
+	/*Link the DMA streams to this SPI handle, TX stream does not interrupt on completion */
+	spi_handle->hdmarx->Parent = spi_handle;
+	spi_handle->hdmarx->xfer_cplt_cb = hal_spi_dma_rx_cplt;
+	spi_handle->hdmarx->xfer_half_cb = 0;
+	spi_handle->hdmarx->xfer_error_cb = hal_spi_dma_error;
+	
+	spi_handle->hdmatx->Parent = spi_handle;
+	spi_handle->hdmatx->xfer_cplt_cb = 0;
+	spi_handle->hdmatx->xfer_half_cb = 0;
+	spi_handle->hdmatx->xfer_error_cb = hal_spi_dma_error;
+	
+	/*Missing buffers are replaced by a single dummy location */
+	data_size = (spi_handle->Init.DataSize == SPI_8BIT_DF_ENABLE) ? DMA_DATA_SIZE_BYTE : DMA_DATA_SIZE_HALFWORD;
+	
+	hal_spi_dma_configure(spi_handle->hdmatx, tx_buffer != 0, data_size);
+	hal_spi_dma_configure(spi_handle->hdmarx, rx_buffer != 0, data_size);
+	
+	if(!tx_buffer)
+		tx_buffer = (uint8_t *)&dummy_tx;
+	
+	if(!rx_buffer)
+		rx_buffer = (uint8_t *)&dummy_rx;
+	
+	hal_spi_reset_crc(spi_handle);
+	hal_spi_enable(spi_handle->Instance);
+	
+	/* read the data register once to make sure stale data is not picked by RX stream */
+	val = spi_handle->Instance->DR;
+	(void)val;
+	
+	/*RX stream must be ready before first frame is clocked in */
+	hal_dma_start_it(spi_handle->hdmarx, (uint32_t)&spi_handle->Instance->DR, (uint32_t)rx_buffer, len);
+	spi_handle->Instance->CR2 |= SPI_REG_CR2_RXDMAEN;
+	
+	/*TX request starts the clock */
+	hal_dma_start_it(spi_handle->hdmatx, (uint32_t)tx_buffer, (uint32_t)&spi_handle->Instance->DR, len);
+	spi_handle->Instance->CR2 |= SPI_REG_CR2_TXDMAEN;
+}
+
+
+
+/**
+  * @brief API used to queue a transaction on the bus, transactions are carried out in order and the next one is
+  *        started straight from the ISR of the previous one. DMA is used if hdmatx and hdmarx are set.
+  *        Can be called from thread context or from a transaction callback.
+  * @param *spi_handle : pointer to spi_handle_t structure, must be in master mode
+  * @param *transaction : transaction to be queued
+  * @retval none
+ */
+void hal_spi_submit(spi_handle_t *spi_handle, spi_transaction_t *transaction)
+{
+	uint32_t primask;
+	uint8_t start = 0;
+	
+	transaction->Next = 0;
+	transaction->ErrorCode = HAL_SPI_ERROR_NONE;
+	
+	/* Queue is shared with the SPI/DMA ISR */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(spi_handle->QueueTail)
+		spi_handle->QueueTail->Next = transaction;
+	else
+		spi_handle->QueueHead = transaction;
+	
+	spi_handle->QueueTail = transaction;
+	
+	if(!spi_handle->QueueBusy)
+	{
+		spi_handle->QueueBusy = 1;
+		start = 1;
+	}
+	
+	__set_PRIMASK(primask);
+	
+	/* Bus was idle, otherwise ISR picks this transaction up */
+	if(start)
+		hal_spi_queue_start(spi_handle);
+}
+
+
+
+/**
+  * @brief API used to abort the queued transaction which is on the bus, for example when the application times it out.
+  *        Its callback is called with HAL_SPI_ERROR_ABORT and the next queued transaction is started.
+  *        Must be called from thread context.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @retval none
+ */
+void hal_spi_abort_transaction(spi_handle_t *spi_handle)
+{
+	uint32_t primask;
+	uint32_t val;
+	
+	/* Completion interrupt of the transfer must not run while it is being torn down */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(!spi_handle->QueueBusy || (spi_handle->QueueHead == 0))
+	{
+		__set_PRIMASK(primask);
+		return;
+	}
+	
+	hal_spi_disable_txe_interrupt(spi_handle->Instance);
+	hal_spi_disable_rxne_interrupt(spi_handle->Instance);
+	
+	if(spi_handle->Instance->CR2 & (SPI_REG_CR2_TXDMAEN | SPI_REG_CR2_RXDMAEN))
+	{
+		hal_dma_abort(spi_handle->hdmarx);
+		hal_spi_dma_close(spi_handle);
+	}
+	
+	while(hal_spi_is_bus_busy(spi_handle->Instance));
+	
+	/* Drop the frame left in the receive buffer */
+	val = spi_handle->Instance->DR;
+	(void)val;
+	
+	spi_handle->ErrorCode |= HAL_SPI_ERROR_ABORT;
+	spi_handle->state = HAL_SPI_STATE_READY;
+	
+	__set_PRIMASK(primask);
+	
+	hal_spi_queue_next(spi_handle);
+}
+
+
+
+/**
+  * @brief Handles TXE interrupts.
+  * @param hspi : pointer to spi_handle_t structre that contains the configuration 
+                   information for SPI Module.
+  * @retval none
+ */
+void hal_spi_handle_tx_interrupt(spi_handle_t *hspi)
+{
+	/* Frame size handler was chosen in hal_spi_init or when the device was selected */
+	hspi->TxISR(hspi);
+}
+
+
+/**
+  * @brief Handles RXNE interrupts.
+  * @param hspi : pointer to spi_handle_t structre that contains the configuration 
+                   information for SPI Module.
+  * @retval none
+ */
+void hal_spi_handle_rx_interrupt(spi_handle_t *hspi)
+{
+	hspi->RxISR(hspi);
+}
 	
 	
 
@@ -10,6 +10,8 @@
 
 /*MCU specific header file for stm32f407vgt6 base discovery board */
 #include "stm32f407xx.h"
+#include "hal_dma_driver.h"
+#include "hal_gpio_driver.h"
 
 
 /******************************************************************************************************************************/
@@ -26,6 +28,15 @@
 #define SPI_ENABLE_2_LINE_UNI_DIR                                      0
 #define SPI_ENABLE_1_LINE_BIDI                                         1
 
+/* Output enable in bidirectional mode */
+#define SPI_REG_CR1_BIDIOE                                             ((uint32_t) 1 << 14)
+
+/* Hardware CRC calculation */
+#define SPI_REG_CR1_CRCEN                                              ((uint32_t) 1 << 13)
+#define SPI_REG_CR1_CRCNEXT                                            ((uint32_t) 1 << 12)
+#define SPI_CRC_DISABLE                                                0
+#define SPI_CRC_ENABLE                                                 1
+
 /* Data format */
 #define SPI_REG_CR1_DFF                                                ((uint32_t) 1 << 11)
 #define SPI_8BIT_DF_ENABLE                                             0
@@ -56,6 +67,7 @@
 #define SPI_REG_CR1_BR_PCLK_DIV_64                                     ((uint32_t) 5 << 3)
 #define SPI_REG_CR1_BR_PCLK_DIV_128                                    ((uint32_t) 6 << 3)
 #define SPI_REG_CR1_BR_PCLK_DIV_256                                    ((uint32_t) 7 << 3)
+#define SPI_REG_CR1_BR_MASK                                            ((uint32_t) 7 << 3)
 
 /*Master selection*/
 #define SPI_REG_CR1_MSTR                                               ((uint32_t) 1 << 2)
@@ -84,10 +96,16 @@
 
 #define SPI_REG_CR2_SSOE                                               ((uint32_t) 1 << 2)
 
+/* DMA requests */
+#define SPI_REG_CR2_TXDMAEN                                            ((uint32_t) 1 << 1)
+#define SPI_REG_CR2_RXDMAEN                                            ((uint32_t) 1 << 0)
+
 /******************************************Bit definition for SPI_SR Register*******************************************************/
 
 #define SPI_REG_SR_FRE_FLAG                                            ((uint32_t) 1 << 8)
 #define SPI_REG_SR_BSY_FLAG                                            ((uint32_t) 1 << 7)
+#define SPI_REG_SR_OVR_FLAG                                            ((uint32_t) 1 << 6)
+#define SPI_REG_SR_CRCERR_FLAG                                         ((uint32_t) 1 << 4)
 #define SPI_REG_SR_TXE_FLAG                                            ((uint32_t) 1 << 1)
 #define SPI_REG_SR_RXNE_FLAG                                           ((uint32_t) 1 << 0)
 
@@ -108,6 +126,26 @@
 #define RESET                                                           0
 #define SET                                                             !(RESET)
 
+/* Master transfers and queued transactions upto this many bytes are polled in place, setting up the interrupt
+   path costs more than clocking a few register bytes out. Such a call has completed when it returns and its
+   callback has already run in the context of the caller. 0 keeps every transfer interrupt/DMA driven.
+   See the spi_poll_benchmark sample application for the crossover length on a given clock setup */
+#ifndef SPI_POLL_THRESHOLD
+#define SPI_POLL_THRESHOLD                                              4
+#endif
+
+/* Sent on MOSI when application gives no TX buffer */
+#define SPI_DUMMY_BYTE                                                  ((uint16_t) 0xFFFF)
+
+
+/**
+  *@brief SPI Possible Error Codes
+	*/
+#define HAL_SPI_ERROR_NONE                                              ((uint32_t) 0x00000000)     // No error
+#define HAL_SPI_ERROR_DMA                                               ((uint32_t) 0x00000001)     // DMA transfer error
+#define HAL_SPI_ERROR_CRC                                               ((uint32_t) 0x00000002)     // Received CRC did not match
+#define HAL_SPI_ERROR_ABORT                                             ((uint32_t) 0x00000004)     // Transaction aborted by hal_spi_abort_transaction
+
 
 /*******************************************************************************************************************************************/
 /*                                                                                                                                         */
@@ -145,24 +183,71 @@ typedef struct
 	uint32_t BaudRatePreScalar;        /* Specifies the baud rate prescaler value which will be used to configure the
 	                                      transmit and receive SCK clock */
 	uint32_t FirstBit;                 /* specifies whether data transfer start from MSB or LSB */
+	uint32_t FrameFormat;              /* Specifies Motorola or TI frame format, clock phase/polarity and NSS are
+	                                      fixed by hardware in TI mode */
+	uint32_t CRCCalculation;           /* Specifies whether hardware CRC is sent and checked at the end of every transfer */
+	uint32_t CRCPolynomial;            /* Specifies the CRC polynomial, CRC is 8 or 16 bit as per DataSize */
 	
 } spi_init_t;
 
 
+/*Application callback typedef */
+typedef void(SPI_XFER_CB_t) (void *ptr);
+typedef void(SPI_RX_EVENT_CB_t) (uint8_t *data, uint32_t len);
+
+
+/**
+  * @Brief SPI device on a shared bus, selected by its own chip select GPIO
+  */
+typedef struct
+{
+	GPIO_TypeDef           *CsPort;     /* GPIO port of the chip select pin, pin must be configured as output and driven high */
+	uint16_t               CsPin;       /* Chip select pin number, chip select is active low */
+	spi_init_t             Init;        /* CLKPhase, CLKPolarity, DataSize, FirstBit and BaudRatePreScalar used for this device */
+} spi_device_t;
+
+
+/**
+  * @Brief SPI transaction queued on a bus, storage is owned by the application until cb is called
+  */
+typedef struct spi_transaction
+{
+	spi_device_t           *Device;     /* Device to be selected during the transaction */
+	uint8_t                *pTxBuffer;  /* Data to be sent, if NULL SPI_DUMMY_BYTE is sent */
+	uint8_t                *pRxBuffer;  /* Received data, if NULL received data is discarded */
+	uint16_t               Len;         /* Lenght of the transaction in bytes */
+	uint32_t               ErrorCode;   /* HAL_SPI_ERROR_xxx of this transaction, set by the driver before cb is called */
+	SPI_XFER_CB_t          *cb;         /* Called from ISR with pointer to this transaction once it is completed or failed */
+	struct spi_transaction *Next;       /* Used by the driver to link the queue */
+} spi_transaction_t;
+
+
 /**
   * @Brief SPI handle structre definition 
   */
-typedef struct 
+typedef struct spi_handle
 {
 	SPI_TypeDef            *Instance;   /* SPI register base address */
 	spi_init_t              Init;       /* SPI Communication parameter */
 	uint8_t                *pTxBuffPtr; /* Pointer to SPI Tx transfer buffer */
 	uint16_t               TxXferSize;  /* SPI Tx Transfer Size */
-	uint16_t               TxXferCount; /* SPI Tx Transfer Counter */
+	uint16_t               TxXferCount; /* SPI Tx Transfer Counter, in data frames */
 	uint8_t                *pRxBuffPtr; /* Pointer to SPI Rx Transfer Buffer*/
 	uint16_t               RxXferSize;  /* SPI Rx Transfer Size */
-	uint16_t               RxXferCount; /* SPI Rx Transfer Counter */
+	uint16_t               RxXferCount; /* SPI Rx Transfer Counter, in data frames */
   hal_spi_state_t        state;       /* SPI Communication state */
+	uint32_t               ErrorCode;   /* SPI Error code */
+	dma_handle_t           *hdmatx;     /* DMA stream used for transmission, NULL if not used */
+	dma_handle_t           *hdmarx;     /* DMA stream used for reception, NULL if not used */
+	SPI_XFER_CB_t          *xfer_cplt_cb; /* Application call back when a master transfer is completed, called with pointer to its size */
+	SPI_XFER_CB_t          *error_cb;   /* Application call back when DMA transfer failed or CRC did not match */
+	SPI_RX_EVENT_CB_t      *rx_event_cb; /* Continuous slave reception: application call back when a buffer is full */
+	spi_transaction_t      *QueueHead;  /* Transaction on the bus, followed by the pending ones */
+	spi_transaction_t      *QueueTail;  /* Last queued transaction */
+	spi_device_t           *ActiveDevice; /* Device the bus is currently configured for */
+	volatile uint8_t       QueueBusy;   /* Queue is being processed from ISR */
+	void (*TxISR)(struct spi_handle *hspi); /* TXE handler for the configured frame size, set by the driver */
+	void (*RxISR)(struct spi_handle *hspi); /* RXNE handler for the configured frame size, set by the driver */
 	
 }spi_handle_t;
 
@@ -185,7 +270,8 @@ typedef struct
 void hal_spi_init(spi_handle_t *spi_handle);
 
 /**
-  * @brief API used to do master data transmission 
+  * @brief API used to do master data transmission. Upto SPI_POLL_THRESHOLD bytes are sent by polling,
+  *        the transfer is then completed on return and xfer_cplt_cb has already been called.
   * @param *SPIx : Based address of SPI
   * @param *buffer  : Pointer to tx buffer 
   * @param len : lenght of tx data 
@@ -203,7 +289,8 @@ void hal_spi_master_tx(spi_handle_t *spi_handle, uint8_t *buffer , uint32_t len)
 void hal_spi_slave_rx(spi_handle_t *spi_handle, uint8_t *rcv_buffer , uint32_t len);
 
 /**
-  * @brief API used to do master  data reception
+  * @brief API used to do master  data reception. Upto SPI_POLL_THRESHOLD bytes are received by polling,
+  *        the transfer is then completed on return and xfer_cplt_cb has already been called.
   * @param *SPIx : Based address of SPI
   * @param *buffer  : Pointer to RX buffer 
   * @param len : lenght of RX data 
@@ -211,6 +298,43 @@ void hal_spi_slave_rx(spi_handle_t *spi_handle, uint8_t *rcv_buffer , uint32_t l
  */
 void hal_spi_master_rx(spi_handle_t *spi_handle, uint8_t *buffer , uint32_t len);
 
+/**
+  * @brief API used to do master full duplex transfer, tx_buffer is sent while rx_buffer is filled
+  *        in the same clock cycles. Completion is indicated by state going back to HAL_SPI_STATE_READY
+  *        and xfer_cplt_cb. Upto SPI_POLL_THRESHOLD bytes are polled, the transfer is then completed on return.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : Pointer to tx buffer, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : Pointer to RX buffer, if NULL received data is discarded
+  * @param len : lenght of data in bytes
+  * @retval none
+ */
+void hal_spi_master_tx_rx(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len);
+
+/**
+  * @brief API used to do master full duplex transfer by polling, returns when transfer is completed.
+  *        Next frame is written while current one is shifted out and SPI is left enabled.
+  *        Faster than the interrupt APIs for register sized transfers, no callback is called.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : Pointer to tx buffer, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : Pointer to RX buffer, if NULL received data is discarded
+  * @param len : lenght of data in bytes
+  * @retval none
+ */
+void hal_spi_master_tx_rx_poll(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len);
+
+/**
+  * @brief API used to talk to a 3-wire(single data line) device in bidirectional mode, master sends tx_len bytes,
+  *        turns the data line around and clocks in rx_len bytes. Returns when transfer is completed.
+  *        Direction must be SPI_ENABLE_1_LINE_BIDI.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : data to be sent first, e.g. command/register address
+  * @param tx_len : number of bytes to be sent, can be 0
+  * @param *rx_buffer : received data
+  * @param rx_len : number of bytes to be received, can be 0
+  * @retval none
+ */
+void hal_spi_master_half_duplex(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint32_t tx_len, uint8_t *rx_buffer, uint32_t rx_len);
+
 /**
   * @brief API used to do slave data transmission 
   * @param *SPIx : Based address of SPI
@@ -229,33 +353,60 @@ void hal_spi_irq_handler(spi_handle_t *hspi);
 
 
 /**
-  * @brief Enable TX buffer emty interrupt 
-  * @param SPIx:  SPI base address 
+  * @brief API used to do a full duplex transfer using DMA, RX and TX streams run together and
+  *        only the RX stream completion raises an interrupt, xfer_cplt_cb is called from there.
+  *        hdmatx and hdmarx must be initialized, data size of the streams is matched to the SPI frame size.
+  *        len is in data frames(8 or 16 bit), for 16 bit frames buffers must be half word aligned.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *tx_buffer : data to be sent, if NULL SPI_DUMMY_BYTE is sent
+  * @param *rx_buffer : received data, if NULL received data is discarded
+  * @param len : number of data frames
+  * @retval none
+ */
+void hal_spi_transfer_dma(spi_handle_t *spi_handle, uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t len);
+
+
+/**
+  * @brief API used to receive continuously as slave into two ping-pong buffers using DMA double buffer mode.
+  *        Every time a buffer is full the stream moves on to the other one without losing a frame, and
+  *        rx_event_cb is called with the full buffer. Application must be done with it before the other
+  *        buffer fills up. hdmarx must be initialized, reception runs until hal_spi_slave_rx_dma_stop.
+  * @param *spi_handle : pointer to spi_handle_t structure
+  * @param *buffer0 : first receive buffer
+  * @param *buffer1 : second receive buffer
+  * @param len : size of each buffer in bytes
   * @retval none
  */
-void hal_spi_enable_txe_interrupt(SPI_TypeDef *SPIx);
+void hal_spi_slave_rx_dma_double_buffer(spi_handle_t *spi_handle, uint8_t *buffer0, uint8_t *buffer1, uint32_t len);
+
 
 /**
-  * @brief Disable  TX buffer emty interrupt 
-  * @param SPIx:  SPI base address 
+  * @brief API used to stop continuous slave reception started by hal_spi_slave_rx_dma_double_buffer
+  * @param *spi_handle : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_disable_txe_interrupt(SPI_TypeDef *SPIx);
+void hal_spi_slave_rx_dma_stop(spi_handle_t *spi_handle);
+
 
 /**
-  * @brief Enable RX buffer not empty interrupt
-  * @param SPIx:  SPI base address 
+  * @brief API used to queue a transaction on the bus, transactions are carried out in order and the next one is
+  *        started straight from the ISR of the previous one. DMA is used if hdmatx and hdmarx are set.
+  *        Can be called from thread context or from a transaction callback.
+  * @param *spi_handle : pointer to spi_handle_t structure, must be in master mode
+  * @param *transaction : transaction to be queued
   * @retval none
  */
-void hal_spi_enable_rxne_interrupt(SPI_TypeDef *SPIx);
+void hal_spi_submit(spi_handle_t *spi_handle, spi_transaction_t *transaction);
 
 
 /**
-  * @brief Disable RX buffer not empty interrupt
-  * @param SPIx:  SPI base address 
+  * @brief API used to abort the queued transaction which is on the bus, for example when the application times it out.
+  *        Its callback is called with HAL_SPI_ERROR_ABORT and the next queued transaction is started.
+  *        Must be called from thread context.
+  * @param *spi_handle : pointer to spi_handle_t structure
   * @retval none
  */
-void hal_spi_disable_rxne_interrupt(SPI_TypeDef *SPIx);
+void hal_spi_abort_transaction(spi_handle_t *spi_handle);
 
 
 /**
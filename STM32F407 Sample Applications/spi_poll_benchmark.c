@@ -0,0 +1,183 @@
+/**************************************************************************************************************************
+ * @file     spi_poll_benchmark.c
+ * @author   Sharath N
+ * @brief    This is a sample application to find the transfer length upto which the polled SPI path
+             (hal_spi_master_tx_rx_poll) is faster than the interrupt path (hal_spi_master_tx_rx).
+             Both paths are timed with the DWT cycle counter for 1 to 64 bytes on SPI1 (PA5 SCK, PA6 MISO, PA7 MOSI).
+             No slave is needed, received data is discarded. Results are left in bench_result[] and crossover_len
+             for the debugger, green LED is turned on when the run is over.
+             crossover_len is the value to use for SPI_POLL_THRESHOLD with the same clock setup.
+             The whole project has to be built with SPI_POLL_THRESHOLD=0, otherwise hal_spi_master_tx_rx
+             polls short transfers by itself and both paths would time the same code.
+ **************************************************************************************************************************/
+
+
+#include "led.h"
+#include "hal_spi_driver.h"
+
+#if SPI_POLL_THRESHOLD != 0
+#error "Build with SPI_POLL_THRESHOLD=0 so that the interrupt path is measured"
+#endif
+
+/* SPI1 pins on port A, alternate function 5 */
+#define SPI1_SCK_PIN                                                    5
+#define SPI1_MISO_PIN                                                   6
+#define SPI1_MOSI_PIN                                                   7
+#define SPI1_ALT_FUN                                                    5
+
+#define BENCH_MAX_LEN                                                   64
+
+/* Every length is measured this many times, the fastest run is kept so that other interrupts do not skew it */
+#define BENCH_RUNS                                                      8
+
+/* Crossover moves to longer transfers at slower SCK, as the setup cost is shared by fewer bit times */
+#define BENCH_PRESCALER                                                 SPI_REG_CR1_BR_PCLK_DIV_8
+
+
+typedef struct
+{
+	uint32_t poll_cycles;         /* Cycles from the call until hal_spi_master_tx_rx_poll returned */
+	uint32_t irq_cycles;          /* Cycles from the call until the interrupt path made the handle ready again */
+} bench_result_t;
+
+spi_handle_t SpiHandle;
+bench_result_t bench_result[BENCH_MAX_LEN + 1];
+uint32_t crossover_len;
+
+static uint8_t tx_buffer[BENCH_MAX_LEN];
+static uint8_t rx_buffer[BENCH_MAX_LEN];
+
+
+/**
+  * @brief  Configures SPI1 pins and the SPI1 peripheral as master
+  * @param  none
+  * @retval none
+ */
+static void spi_gpio_init(void)
+{
+	gpio_pin_config_typedef spi_pin_config;
+
+	_HAL_RCC_GPIOA_CLK_ENABLE();
+
+	spi_pin_config.mode = GPIO_PIN_ALT_FUN_MODE;
+	spi_pin_config.output_type = GPIO_PIN_OUTPUT_TYPE_PUSHPULL;
+	spi_pin_config.speed = GPIO_PIN_SPEED_VERY_HIGH;
+	spi_pin_config.pull = GPIO_PIN_NO_PUSH_PULL;
+
+	spi_pin_config.pin = SPI1_SCK_PIN;
+	hal_gpio_set_alt_function(GPIOA, SPI1_SCK_PIN, SPI1_ALT_FUN);
+	hal_gpio_init(GPIOA, &spi_pin_config);
+
+	spi_pin_config.pin = SPI1_MISO_PIN;
+	hal_gpio_set_alt_function(GPIOA, SPI1_MISO_PIN, SPI1_ALT_FUN);
+	hal_gpio_init(GPIOA, &spi_pin_config);
+
+	spi_pin_config.pin = SPI1_MOSI_PIN;
+	hal_gpio_set_alt_function(GPIOA, SPI1_MOSI_PIN, SPI1_ALT_FUN);
+	hal_gpio_init(GPIOA, &spi_pin_config);
+}
+
+
+/**
+  * @brief  Times one polled transfer
+  * @param  len : number of bytes
+  * @retval cycles taken
+ */
+static uint32_t bench_poll(uint32_t len)
+{
+	uint32_t start;
+
+	start = DWT->CYCCNT;
+	hal_spi_master_tx_rx_poll(&SpiHandle, tx_buffer, rx_buffer, len);
+
+	return DWT->CYCCNT - start;
+}
+
+
+/**
+  * @brief  Times one interrupt driven transfer, until the RXNE interrupt of the last frame closed it
+  * @param  len : number of bytes
+  * @retval cycles taken
+ */
+static uint32_t bench_irq(uint32_t len)
+{
+	uint32_t start;
+
+	start = DWT->CYCCNT;
+	hal_spi_master_tx_rx(&SpiHandle, tx_buffer, rx_buffer, len);
+	while(SpiHandle.state != HAL_SPI_STATE_READY);
+
+	return DWT->CYCCNT - start;
+}
+
+
+int main(void)
+{
+	uint32_t len, run, cycles;
+
+	led_init();
+	spi_gpio_init();
+
+	_HAL_RCC_SPI1_CLK_ENABLE();
+
+	SpiHandle.Instance = SPI_1;
+	SpiHandle.Init.Mode = SPI_MASTER_MODE_SEL;
+	SpiHandle.Init.Direction = SPI_ENABLE_2_LINE_UNI_DIR;
+	SpiHandle.Init.DataSize = SPI_8BIT_DF_ENABLE;
+	SpiHandle.Init.CLKPolarity = SPI_CPOL_LOW;
+	SpiHandle.Init.CLKPhase = SPI_FIRST_CLOCK_TRANS;
+	SpiHandle.Init.FirstBit = SPI_TX_MSB_FIRST;
+	SpiHandle.Init.NSS = 1;                              /* Software slave management, SSI keeps the master selected */
+	SpiHandle.Init.BaudRatePreScalar = BENCH_PRESCALER;
+	SpiHandle.Init.FrameFormat = SPI_MOTOROLA_MODE;
+	SpiHandle.Init.CRCCalculation = SPI_CRC_DISABLE;
+	SpiHandle.state = HAL_SPI_STATE_READY;
+
+	hal_spi_init(&SpiHandle);
+
+	NVIC_EnableIRQ(SPI1_IRQn);
+
+	/* Start the DWT cycle counter */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for(len = 1; len <= BENCH_MAX_LEN; len++)
+	{
+		tx_buffer[len - 1] = (uint8_t)len;
+
+		bench_result[len].poll_cycles = 0xFFFFFFFF;
+		bench_result[len].irq_cycles = 0xFFFFFFFF;
+
+		for(run = 0; run < BENCH_RUNS; run++)
+		{
+			cycles = bench_poll(len);
+			if(cycles < bench_result[len].poll_cycles)
+				bench_result[len].poll_cycles = cycles;
+
+			cycles = bench_irq(len);
+			if(cycles < bench_result[len].irq_cycles)
+				bench_result[len].irq_cycles = cycles;
+		}
+
+		/* Longest length for which polling still wins */
+		if(bench_result[len].poll_cycles <= bench_result[len].irq_cycles)
+			crossover_len = len;
+	}
+
+	led_turn_on(GPIOD, LED_GREEN);
+
+	while(1)
+	{
+	}
+}
+
+
+/**
+  *@brief Interrupt Service routine(ISR) for SPI1
+  *@retval none
+*/
+void SPI1_IRQHandler(void)
+{
+	hal_spi_irq_handler(&SpiHandle);
+}
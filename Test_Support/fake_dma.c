@@ -0,0 +1,146 @@
+/***************************************************************************************************************************
+  * @file    fake_dma.c
+  * @author  Sharath N
+  * @brief   Test double of the DMA driver, streams are plain RAM structures and transfers complete on request.
+***************************************************************************************************************************/
+
+#include "fake_dma.h"
+
+uint32_t fake_dma_start_count;
+uint32_t fake_dma_abort_count;
+
+static uint32_t fake_dma_size[16];
+
+void fake_dma_reset(void)
+{
+	fake_dma_start_count = 0;
+	fake_dma_abort_count = 0;
+}
+
+void hal_dma_init(dma_handle_t *hdma)
+{
+	hdma->Instance->CR = 0;
+	
+	if(hdma->Init.Mode == DMA_MODE_CIRCULAR)
+		hdma->Instance->CR |= DMA_REG_SXCR_CIRC;
+	
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_READY;
+}
+
+static uint32_t *fake_dma_stream_size(dma_handle_t *hdma)
+{
+	return &fake_dma_size[(uint32_t)((hdma->Instance - DMA1_Stream0) & 0x0F)];
+}
+
+void hal_dma_start_it(dma_handle_t *hdma, uint32_t src, uint32_t dst, uint32_t len)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+	
+	stream->NDTR = len;
+	*fake_dma_stream_size(hdma) = len;
+	
+	if(hdma->Init.Direction == DMA_MEMORY_TO_PERIPH)
+	{
+		stream->PAR = dst;
+		stream->M0AR = src;
+	}
+	else
+	{
+		stream->PAR = src;
+		stream->M0AR = dst;
+	}
+	
+	stream->CR &= ~(DMA_REG_SXCR_DBM | DMA_REG_SXCR_CT);
+	stream->CR |= DMA_REG_SXCR_EN;
+	
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_BUSY;
+	fake_dma_start_count++;
+}
+
+void hal_dma_start_double_buffer_it(dma_handle_t *hdma, uint32_t periph, uint32_t mem0, uint32_t mem1, uint32_t len)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+	
+	stream->NDTR = len;
+	*fake_dma_stream_size(hdma) = len;
+	stream->PAR = periph;
+	stream->M0AR = mem0;
+	stream->M1AR = mem1;
+	
+	stream->CR &= ~DMA_REG_SXCR_CT;
+	stream->CR |= (DMA_REG_SXCR_DBM | DMA_REG_SXCR_EN);
+	
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_BUSY;
+	fake_dma_start_count++;
+}
+
+uint32_t hal_dma_get_current_target(dma_handle_t *hdma)
+{
+	return (hdma->Instance->CR & DMA_REG_SXCR_CT) ? 1 : 0;
+}
+
+void hal_dma_abort(dma_handle_t *hdma)
+{
+	hdma->Instance->CR &= ~DMA_REG_SXCR_EN;
+	hdma->State = HAL_DMA_STATE_READY;
+	fake_dma_abort_count++;
+}
+
+uint32_t hal_dma_get_counter(dma_handle_t *hdma)
+{
+	return hdma->Instance->NDTR;
+}
+
+void hal_dma_irq_handler(dma_handle_t *hdma)
+{
+	(void)hdma;
+}
+
+void fake_dma_advance(dma_handle_t *hdma, uint32_t len)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+	uint32_t size = *fake_dma_stream_size(hdma);
+	
+	while(len--)
+	{
+		if(--stream->NDTR == 0)
+		{
+			if(stream->CR & (DMA_REG_SXCR_CIRC | DMA_REG_SXCR_DBM))
+			{
+				stream->NDTR = size;
+				stream->CR ^= (stream->CR & DMA_REG_SXCR_DBM) ? DMA_REG_SXCR_CT : 0;
+			}
+			else
+			{
+				stream->CR &= ~DMA_REG_SXCR_EN;
+				hdma->State = HAL_DMA_STATE_READY;
+				return;
+			}
+		}
+	}
+}
+
+void fake_dma_complete(dma_handle_t *hdma)
+{
+	if(!(hdma->Instance->CR & (DMA_REG_SXCR_CIRC | DMA_REG_SXCR_DBM)))
+	{
+		hdma->Instance->NDTR = 0;
+		hdma->Instance->CR &= ~DMA_REG_SXCR_EN;
+		hdma->State = HAL_DMA_STATE_READY;
+	}
+	
+	if(hdma->xfer_cplt_cb)
+		hdma->xfer_cplt_cb(hdma);
+}
+
+void fake_dma_error(dma_handle_t *hdma)
+{
+	hdma->ErrorCode |= HAL_DMA_ERROR_TE;
+	hdma->State = HAL_DMA_STATE_ERROR;
+	
+	if(hdma->xfer_error_cb)
+		hdma->xfer_error_cb(hdma);
+}
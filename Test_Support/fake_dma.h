@@ -0,0 +1,47 @@
+/**************************************************************************************************************************
+ * @file     fake_dma.h
+ * @author   Sharath N
+ * @brief    Test double of the DMA driver for the host unit tests. The real driver finds the controller from the
+ *           stream address, which only works on the target, so streams are simulated here instead.
+ **************************************************************************************************************************/
+
+#ifndef __FAKE_DMA_H
+#define __FAKE_DMA_H
+
+#include "hal_dma_driver.h"
+
+/* Number of hal_dma_start_it/hal_dma_start_double_buffer_it calls since last reset */
+extern uint32_t fake_dma_start_count;
+
+/* Number of hal_dma_abort calls since last reset */
+extern uint32_t fake_dma_abort_count;
+
+/**
+  * @brief  Clears the call counters
+  * @retval  none
+ */
+void fake_dma_reset(void);
+
+/**
+  * @brief  Simulates the stream completing its transfer, calls xfer_cplt_cb like the stream interrupt would
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void fake_dma_complete(dma_handle_t *hdma);
+
+/**
+  * @brief  Simulates the stream moving len data items, NDTR counts down and wraps in circular mode
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @param  len : number of data items moved
+  * @retval  none
+ */
+void fake_dma_advance(dma_handle_t *hdma, uint32_t len);
+
+/**
+  * @brief  Simulates a transfer error, calls xfer_error_cb like the stream interrupt would
+  * @param  *hdma : pointer to handle structure of DMA stream
+  * @retval  none
+ */
+void fake_dma_error(dma_handle_t *hdma);
+
+#endif
@@ -0,0 +1,103 @@
+/***************************************************************************************************************************
+  * @file    host_periph.c
+  * @author  Sharath N
+  * @brief   RAM backed peripherals and core functions for the host unit tests.
+***************************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "stm32f407xx.h"
+#include "test_assert.h"
+
+static GPIO_TypeDef gpio[9];
+static USART_TypeDef usart[6];
+static SPI_TypeDef spi[3];
+static I2C_TypeDef i2c[3];
+static DMA_TypeDef dma[2];
+static DMA_Stream_TypeDef dma_stream[16];
+static EXTI_TypeDef exti;
+static SYSCFG_TypeDef syscfg;
+static RCC_TypeDef rcc;
+static DWT_Type dwt;
+static CoreDebug_Type core_debug;
+
+GPIO_TypeDef *GPIOA = &gpio[0], *GPIOB = &gpio[1], *GPIOC = &gpio[2], *GPIOD = &gpio[3], *GPIOE = &gpio[4],
+             *GPIOF = &gpio[5], *GPIOG = &gpio[6], *GPIOH = &gpio[7], *GPIOI = &gpio[8];
+USART_TypeDef *USART1 = &usart[0], *USART2 = &usart[1], *USART3 = &usart[2], *UART4 = &usart[3], *UART5 = &usart[4],
+              *USART6 = &usart[5];
+SPI_TypeDef *SPI1 = &spi[0], *SPI2 = &spi[1], *SPI3 = &spi[2];
+I2C_TypeDef *I2C1 = &i2c[0], *I2C2 = &i2c[1], *I2C3 = &i2c[2];
+EXTI_TypeDef *EXTI = &exti;
+SYSCFG_TypeDef *SYSCFG = &syscfg;
+RCC_TypeDef *RCC = &rcc;
+DMA_TypeDef *DMA1 = &dma[0], *DMA2 = &dma[1];
+DMA_Stream_TypeDef *DMA1_Stream0 = &dma_stream[0], *DMA1_Stream1 = &dma_stream[1], *DMA1_Stream2 = &dma_stream[2],
+                   *DMA1_Stream3 = &dma_stream[3], *DMA1_Stream4 = &dma_stream[4], *DMA1_Stream5 = &dma_stream[5],
+                   *DMA1_Stream6 = &dma_stream[6], *DMA1_Stream7 = &dma_stream[7];
+DMA_Stream_TypeDef *DMA2_Stream0 = &dma_stream[8], *DMA2_Stream1 = &dma_stream[9], *DMA2_Stream2 = &dma_stream[10],
+                   *DMA2_Stream3 = &dma_stream[11], *DMA2_Stream4 = &dma_stream[12], *DMA2_Stream5 = &dma_stream[13],
+                   *DMA2_Stream6 = &dma_stream[14], *DMA2_Stream7 = &dma_stream[15];
+DWT_Type *DWT = &dwt;
+CoreDebug_Type *CoreDebug = &core_debug;
+
+uint32_t SystemCoreClock = 16000000;
+
+int test_failures;
+
+static uint32_t primask;
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+	(void)irq;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+	(void)irq;
+}
+
+void __disable_irq(void)
+{
+	primask = 1;
+}
+
+void __enable_irq(void)
+{
+	primask = 0;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t value)
+{
+	primask = value;
+}
+
+/* Full barrier, the ring buffer stress test runs producer and consumer on separate host threads */
+void __DMB(void)
+{
+	__sync_synchronize();
+}
+
+/* Drivers spin on the red LED when there is no error callback, on the host that is a test failure */
+void led_turn_on(GPIO_TypeDef *GPIOx, uint16_t pin)
+{
+	(void)GPIOx;
+	(void)pin;
+	fprintf(stderr, "driver halted in error loop\n");
+	exit(1);
+}
+
+void led_toggle(GPIO_TypeDef *GPIOx, uint16_t pin)
+{
+	led_turn_on(GPIOx, pin);
+}
+
+void led_turn_off(GPIO_TypeDef *GPIOx, uint16_t pin)
+{
+	(void)GPIOx;
+	(void)pin;
+}
@@ -0,0 +1,114 @@
+/***************************************************************************************************************************
+  * @file    host_trace.c
+  * @author  Sharath N
+  * @brief   Register access tracing for the host unit tests, see host_trace.h.
+  *          The page is protected, the access faults, the handler records it, opens the page and single steps the
+  *          instruction with the trap flag, the trap handler then protects the page again.
+***************************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "host_trace.h"
+
+#define HOST_TRACE_EFLAGS_TF                    0x100U
+#define HOST_TRACE_ERR_WRITE                    0x2U
+
+typedef struct
+{
+	uintptr_t addr;
+	uint8_t write;
+}host_trace_access_t;
+
+static volatile uint8_t *trace_page;
+static host_trace_access_t trace_log[HOST_TRACE_MAX_ACCESS];
+static uint32_t trace_count;
+
+static void host_trace_segv(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	uintptr_t addr = (uintptr_t)info->si_addr;
+	
+	(void)sig;
+	
+	/* A real crash, let it terminate the test */
+	if(!trace_page || addr < (uintptr_t)trace_page || addr >= (uintptr_t)trace_page + HOST_TRACE_PAGE_SIZE)
+	{
+		signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+	
+	if(trace_count < HOST_TRACE_MAX_ACCESS)
+	{
+		trace_log[trace_count].addr = addr;
+		trace_log[trace_count].write = (uc->uc_mcontext.gregs[REG_ERR] & HOST_TRACE_ERR_WRITE) ? 1 : 0;
+		trace_count++;
+	}
+	
+	mprotect((void *)trace_page, HOST_TRACE_PAGE_SIZE, PROT_READ | PROT_WRITE);
+	uc->uc_mcontext.gregs[REG_EFL] |= HOST_TRACE_EFLAGS_TF;
+}
+
+static void host_trace_step(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	
+	(void)sig;
+	(void)info;
+	
+	uc->uc_mcontext.gregs[REG_EFL] &= ~(greg_t)HOST_TRACE_EFLAGS_TF;
+	if(trace_page)
+		mprotect((void *)trace_page, HOST_TRACE_PAGE_SIZE, PROT_NONE);
+}
+
+void host_trace_start(volatile void *periph)
+{
+	struct sigaction sa;
+	
+	if((uintptr_t)periph & (HOST_TRACE_PAGE_SIZE - 1))
+		abort();
+	
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_flags = SA_SIGINFO;
+	sa.sa_sigaction = host_trace_segv;
+	sigaction(SIGSEGV, &sa, NULL);
+	sa.sa_sigaction = host_trace_step;
+	sigaction(SIGTRAP, &sa, NULL);
+	
+	trace_count = 0;
+	trace_page = (volatile uint8_t *)periph;
+	mprotect((void *)trace_page, HOST_TRACE_PAGE_SIZE, PROT_NONE);
+}
+
+void host_trace_stop(void)
+{
+	if(trace_page)
+		mprotect((void *)trace_page, HOST_TRACE_PAGE_SIZE, PROT_READ | PROT_WRITE);
+	trace_page = NULL;
+}
+
+static uint32_t host_trace_find(volatile void *reg, uint8_t write)
+{
+	uint32_t i, count = 0;
+	
+	for(i = 0; i < trace_count; i++)
+	{
+		if(trace_log[i].addr == (uintptr_t)reg && trace_log[i].write == write)
+			count++;
+	}
+	
+	return count;
+}
+
+uint32_t host_trace_reads(volatile void *reg)
+{
+	return host_trace_find(reg, 0);
+}
+
+uint32_t host_trace_writes(volatile void *reg)
+{
+	return host_trace_find(reg, 1);
+}
@@ -0,0 +1,48 @@
+/**************************************************************************************************************************
+ * @file     host_trace.h
+ * @author   Sharath N
+ * @brief    Register access tracing for the host unit tests. RAM backed registers keep their value when read, so a
+ *           read clear sequence (SR then DR) can not be seen from the register contents. The traced peripheral is
+ *           placed alone in a protected page, every CPU access to it faults and is recorded. x86-64 Linux only.
+ **************************************************************************************************************************/
+
+#ifndef __HOST_TRACE_H
+#define __HOST_TRACE_H
+
+#include <stdint.h>
+
+#define HOST_TRACE_PAGE_SIZE                    4096U
+#define HOST_TRACE_MAX_ACCESS                   64U
+
+/* Storage of a traced peripheral, the page holds nothing else */
+#define HOST_TRACE_PERIPH(type, name)                                                                                       \
+	static union { type regs; uint8_t page[HOST_TRACE_PAGE_SIZE]; } __attribute__((aligned(HOST_TRACE_PAGE_SIZE))) name
+
+/**
+  * @brief  Starts recording the accesses to a peripheral, the previous record is cleared
+  * @param  *periph : peripheral storage declared with HOST_TRACE_PERIPH
+  * @retval  none
+ */
+void host_trace_start(volatile void *periph);
+
+/**
+  * @brief  Stops recording, the peripheral can be accessed freely again and the record is kept
+  * @retval  none
+ */
+void host_trace_stop(void);
+
+/**
+  * @brief  Number of reads of a register since host_trace_start
+  * @param  *reg : address of the register
+  * @retval  read count
+ */
+uint32_t host_trace_reads(volatile void *reg);
+
+/**
+  * @brief  Number of writes of a register since host_trace_start, a read-modify-write counts as one write
+  * @param  *reg : address of the register
+  * @retval  write count
+ */
+uint32_t host_trace_writes(volatile void *reg);
+
+#endif
@@ -0,0 +1,78 @@
+/**************************************************************************************************************************
+ * @file     stm32f407xx.h
+ * @author   Sharath N
+ * @brief    Host stand-in for the CMSIS device header, used only by the host unit tests of the drivers.
+ *           Peripheral instances point to plain structures in RAM (see host_periph.c), so a test can preload
+ *           status flags, call a driver API or interrupt handler and check the registers written by the driver.
+ **************************************************************************************************************************/
+
+#ifndef __HOST_STM32F407XX_H
+#define __HOST_STM32F407XX_H
+
+#include <stdint.h>
+
+#define __IO                                   volatile
+
+typedef enum
+{
+	EXTI0_IRQn        = 6,
+	DMA1_Stream0_IRQn = 11,
+	I2C1_EV_IRQn      = 31,
+	I2C1_ER_IRQn      = 32,
+	SPI1_IRQn         = 35,
+	USART1_IRQn       = 37,
+	USART2_IRQn       = 38
+} IRQn_Type;
+
+typedef struct { __IO uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2]; } GPIO_TypeDef;
+typedef struct { __IO uint32_t SR, DR, BRR, CR1, CR2, CR3, GTPR; } USART_TypeDef;
+typedef struct { __IO uint32_t CR1, CR2, SR, DR, CRCPR, RXCRCR, TXCRCR, I2SCFGR, I2SPR; } SPI_TypeDef;
+typedef struct { __IO uint32_t CR1, CR2, OAR1, OAR2, DR, SR1, SR2, CCR, TRISE, FLTR; } I2C_TypeDef;
+typedef struct { __IO uint32_t CR, NDTR, PAR, M0AR, M1AR, FCR; } DMA_Stream_TypeDef;
+typedef struct { __IO uint32_t LISR, HISR, LIFCR, HIFCR; } DMA_TypeDef;
+typedef struct { __IO uint32_t IMR, EMR, RTSR, FTSR, SWIER, PR; } EXTI_TypeDef;
+typedef struct { __IO uint32_t MEMRMP, PMC, EXTICR[4]; } SYSCFG_TypeDef;
+typedef struct { __IO uint32_t CR, PLLCFGR, CFGR, CIR, AHB1RSTR, AHB2RSTR, AHB3RSTR, R0, APB1RSTR, APB2RSTR, R1[2],
+                 AHB1ENR, AHB2ENR, AHB3ENR, R2, APB1ENR, APB2ENR; } RCC_TypeDef;
+typedef struct { __IO uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { __IO uint32_t DHCSR, DCRSR, DCRDR, DEMCR; } CoreDebug_Type;
+
+extern GPIO_TypeDef *GPIOA, *GPIOB, *GPIOC, *GPIOD, *GPIOE, *GPIOF, *GPIOG, *GPIOH, *GPIOI;
+extern USART_TypeDef *USART1, *USART2, *USART3, *UART4, *UART5, *USART6;
+extern SPI_TypeDef *SPI1, *SPI2, *SPI3;
+extern I2C_TypeDef *I2C1, *I2C2, *I2C3;
+extern EXTI_TypeDef *EXTI;
+extern SYSCFG_TypeDef *SYSCFG;
+extern RCC_TypeDef *RCC;
+extern DMA_TypeDef *DMA1, *DMA2;
+extern DMA_Stream_TypeDef *DMA1_Stream0, *DMA1_Stream1, *DMA1_Stream2, *DMA1_Stream3,
+                          *DMA1_Stream4, *DMA1_Stream5, *DMA1_Stream6, *DMA1_Stream7;
+extern DMA_Stream_TypeDef *DMA2_Stream0, *DMA2_Stream1, *DMA2_Stream2, *DMA2_Stream3,
+                          *DMA2_Stream4, *DMA2_Stream5, *DMA2_Stream6, *DMA2_Stream7;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+
+#define DWT_CTRL_CYCCNTENA_Msk                 (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk             (1UL << 24)
+
+#define PERIPH_BASE                            0x40000000UL
+#define PERIPH_BB_BASE                         0x42000000UL
+#define USART1_BASE                            0x40011000UL
+#define USART6_BASE                            0x40011400UL
+#define SPI1_BASE                              0x40013000UL
+#define DMA1_BASE                              0x40026000UL
+#define DMA2_BASE                              0x40026400UL
+
+extern uint32_t SystemCoreClock;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+/* Interrupts do not exist on the host, PRIMASK is only tracked so nesting can be checked */
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __DMB(void);
+
+#endif
@@ -0,0 +1,40 @@
+/**************************************************************************************************************************
+ * @file     test_assert.h
+ * @author   Sharath N
+ * @brief    Minimal check macros for the host unit tests.
+ **************************************************************************************************************************/
+
+#ifndef __TEST_ASSERT_H
+#define __TEST_ASSERT_H
+
+#include <stdio.h>
+
+extern int test_failures;
+
+/* Records a failure and carries on, so one run reports every broken case */
+#define CHECK(cond)                                                                                  \
+	do                                                                                                 \
+	{                                                                                                  \
+		if(!(cond))                                                                                      \
+		{                                                                                                \
+			printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);                                \
+			test_failures++;                                                                               \
+		}                                                                                                \
+	} while(0)
+
+#define CHECK_EQ(a, b)                                                                               \
+	do                                                                                                 \
+	{                                                                                                  \
+		unsigned long _a = (unsigned long)(a), _b = (unsigned long)(b);                                  \
+		if(_a != _b)                                                                                     \
+		{                                                                                                \
+			printf("%s:%d: CHECK_EQ failed: %s = %lu, %s = %lu\n", __FILE__, __LINE__, #a, _a, #b, _b);    \
+			test_failures++;                                                                               \
+		}                                                                                                \
+	} while(0)
+
+/* Result of main() of every test program */
+#define TEST_RESULT()                                                                                \
+	(printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"), test_failures ? 1 : 0)
+
+#endif
@@ -0,0 +1,167 @@
+/***************************************************************************************************************************
+  * @file    bench_uart_framing.c
+  * @author  Sharath N
+  * @brief   Host throughput benchmark of the COBS and SLIP framing layer, run with "make -C Test_Support bench".
+  *          Random packets of a few MB are encoded, then decoded in DMA sized chunks like the UART receive path
+  *          feeds them. Throughput is given in MB of payload per second, best of BENCH_RUNS runs.
+***************************************************************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "uart_framing.h"
+#include "test_assert.h"
+
+#define BENCH_PAYLOAD_BYTES     (4U * 1024U * 1024U)
+#define BENCH_MIN_PACKET        16
+#define BENCH_FEED_CHUNK        64
+#define BENCH_RUNS              5
+
+static uint8_t *payload;
+static uint16_t *packet_len;
+static uint32_t packet_count;
+static uint8_t *encoded;
+static uint32_t encoded_len;
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static double mb_per_sec(double seconds)
+{
+	return ((double)BENCH_PAYLOAD_BYTES / (1024.0 * 1024.0)) / seconds;
+}
+
+/* Random payload cut into packets of random length, a fixed seed keeps runs comparable */
+static void bench_setup(void)
+{
+	uint32_t total = 0, len, seed = 12345, i;
+	
+	payload = malloc(BENCH_PAYLOAD_BYTES);
+	packet_len = malloc((BENCH_PAYLOAD_BYTES / BENCH_MIN_PACKET + 1) * sizeof(*packet_len));
+	encoded = malloc(SLIP_MAX_ENCODED_LEN(BENCH_PAYLOAD_BYTES));
+	if(!payload || !packet_len || !encoded)
+		exit(1);
+	
+	for(i = 0; i < BENCH_PAYLOAD_BYTES; i++)
+	{
+		seed = (seed * 1103515245U) + 12345U;
+		payload[i] = (uint8_t)(seed >> 16);
+	}
+	
+	packet_count = 0;
+	while(total < BENCH_PAYLOAD_BYTES)
+	{
+		seed = (seed * 1103515245U) + 12345U;
+		len = BENCH_MIN_PACKET + ((seed >> 16) % (UART_FRAME_MAX_PAYLOAD - BENCH_MIN_PACKET + 1));
+		if(len > BENCH_PAYLOAD_BYTES - total)
+			len = BENCH_PAYLOAD_BYTES - total;
+		
+		packet_len[packet_count++] = (uint16_t)len;
+		total += len;
+	}
+}
+
+static double bench_encode(uint32_t mode)
+{
+	const uint8_t *src = payload;
+	double start, best = 0;
+	uint32_t run, i;
+	
+	for(run = 0; run < BENCH_RUNS; run++)
+	{
+		src = payload;
+		encoded_len = 0;
+		
+		start = now_sec();
+		for(i = 0; i < packet_count; i++)
+		{
+			if(mode == UART_FRAMING_COBS)
+				encoded_len += uart_cobs_encode(src, packet_len[i], &encoded[encoded_len]);
+			else
+				encoded_len += uart_slip_encode(src, packet_len[i], &encoded[encoded_len]);
+			src += packet_len[i];
+		}
+		start = now_sec() - start;
+		
+		if((best == 0) || (start < best))
+			best = start;
+	}
+	
+	return mb_per_sec(best);
+}
+
+/* Decodes the stream left by bench_encode, every packet is compared so the work can not be optimised away */
+static double bench_decode(uint32_t mode)
+{
+	static uart_framer_t framer;
+	uart_packet_t *p;
+	double start, best = 0;
+	uint32_t run, pos, len, packets, offset;
+	
+	for(run = 0; run < BENCH_RUNS; run++)
+	{
+		uart_framer_init(&framer, mode);
+		packets = 0;
+		offset = 0;
+		
+		start = now_sec();
+		for(pos = 0; pos < encoded_len; pos += len)
+		{
+			len = encoded_len - pos;
+			if(len > BENCH_FEED_CHUNK)
+				len = BENCH_FEED_CHUNK;
+			
+			uart_framer_feed(&framer, &encoded[pos], len);
+			
+			while((p = uart_framer_peek(&framer)) != 0)
+			{
+				if((packets >= packet_count) || (p->len != packet_len[packets]) ||
+					 memcmp(p->data, &payload[offset], p->len))
+					framer.Errors++;
+				
+				offset += p->len;
+				packets++;
+				uart_framer_release(&framer);
+			}
+		}
+		start = now_sec() - start;
+		
+		CHECK_EQ(packets, packet_count);
+		CHECK_EQ(framer.Errors, 0);
+		CHECK_EQ(framer.Dropped, 0);
+		
+		if((best == 0) || (start < best))
+			best = start;
+	}
+	
+	return mb_per_sec(best);
+}
+
+int main(void)
+{
+	double enc, dec;
+	
+	bench_setup();
+	
+	enc = bench_encode(UART_FRAMING_COBS);
+	dec = bench_decode(UART_FRAMING_COBS);
+	printf("COBS: %u packets, encode %.1f MB/s, decode %.1f MB/s\n", (unsigned)packet_count, enc, dec);
+	
+	enc = bench_encode(UART_FRAMING_SLIP);
+	dec = bench_decode(UART_FRAMING_SLIP);
+	printf("SLIP: %u packets, encode %.1f MB/s, decode %.1f MB/s\n", (unsigned)packet_count, enc, dec);
+	
+	free(payload);
+	free(packet_len);
+	free(encoded);
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,162 @@
+/***************************************************************************************************************************
+  * @file    test_ring_buffer.c
+  * @author  Sharath N
+  * @brief   Host test of the single producer/single consumer ring buffer.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "ring_buffer.h"
+#include "test_assert.h"
+
+#define RB_SIZE   16
+
+static void test_init(void)
+{
+	ring_buffer_t rb;
+	uint8_t storage[RB_SIZE];
+	
+	CHECK_EQ(ring_buffer_init(&rb, storage, 0), 1);
+	CHECK_EQ(ring_buffer_init(&rb, storage, 12), 1);
+	CHECK_EQ(ring_buffer_init(&rb, storage, RB_SIZE), 0);
+	CHECK_EQ(ring_buffer_count(&rb), 0);
+	CHECK_EQ(ring_buffer_free(&rb), RB_SIZE);
+}
+
+static void test_full_empty_boundaries(void)
+{
+	ring_buffer_t rb;
+	uint8_t storage[RB_SIZE];
+	uint8_t data[RB_SIZE + 4];
+	uint8_t out[RB_SIZE + 4];
+	uint8_t byte;
+	uint32_t i;
+	
+	for(i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t)(i + 1);
+	
+	ring_buffer_init(&rb, storage, RB_SIZE);
+	
+	/* Empty */
+	CHECK_EQ(ring_buffer_get(&rb, &byte), 0);
+	CHECK_EQ(ring_buffer_read(&rb, out, 4), 0);
+	
+	/* One short of full, then full */
+	CHECK_EQ(ring_buffer_write(&rb, data, RB_SIZE - 1), RB_SIZE - 1);
+	CHECK_EQ(ring_buffer_free(&rb), 1);
+	CHECK_EQ(ring_buffer_put(&rb, data[RB_SIZE - 1]), 1);
+	CHECK_EQ(ring_buffer_count(&rb), RB_SIZE);
+	CHECK_EQ(ring_buffer_free(&rb), 0);
+	
+	/* Writes to a full buffer are refused */
+	CHECK_EQ(ring_buffer_put(&rb, 0xAA), 0);
+	CHECK_EQ(ring_buffer_write(&rb, data, 4), 0);
+	
+	/* Oversized write is truncated to the free space */
+	CHECK_EQ(ring_buffer_read(&rb, out, sizeof(out)), RB_SIZE);
+	CHECK(memcmp(out, data, RB_SIZE) == 0);
+	CHECK_EQ(ring_buffer_count(&rb), 0);
+	CHECK_EQ(ring_buffer_write(&rb, data, sizeof(data)), RB_SIZE);
+	CHECK_EQ(ring_buffer_free(&rb), 0);
+}
+
+static void test_wraparound(void)
+{
+	ring_buffer_t rb;
+	uint8_t storage[RB_SIZE];
+	uint8_t data[10];
+	uint8_t out[10];
+	uint32_t i, round;
+	
+	ring_buffer_init(&rb, storage, RB_SIZE);
+	
+	/* Index wrap: chunks of 10 in a 16 byte buffer straddle the end of the storage */
+	for(round = 0; round < 7; round++)
+	{
+		for(i = 0; i < sizeof(data); i++)
+			data[i] = (uint8_t)(round * 10 + i);
+		
+		CHECK_EQ(ring_buffer_write(&rb, data, sizeof(data)), sizeof(data));
+		CHECK_EQ(ring_buffer_read(&rb, out, sizeof(out)), sizeof(out));
+		CHECK(memcmp(out, data, sizeof(data)) == 0);
+	}
+	
+	/* Counter wrap: the free running counters overflow in the middle of the data */
+	rb.head = 0xFFFFFFFAu;
+	rb.tail = 0xFFFFFFFAu;
+	for(i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t)(0xC0 + i);
+	
+	CHECK_EQ(ring_buffer_write(&rb, data, sizeof(data)), sizeof(data));
+	CHECK_EQ(rb.head, 4);
+	CHECK_EQ(ring_buffer_count(&rb), sizeof(data));
+	CHECK_EQ(ring_buffer_free(&rb), RB_SIZE - sizeof(data));
+	CHECK_EQ(ring_buffer_write(&rb, data, RB_SIZE), RB_SIZE - sizeof(data));
+	CHECK_EQ(ring_buffer_put(&rb, 0), 0);
+	CHECK_EQ(ring_buffer_read(&rb, out, sizeof(out)), sizeof(out));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	CHECK_EQ(ring_buffer_count(&rb), RB_SIZE - sizeof(data));
+}
+
+static void test_interleaving(void)
+{
+	ring_buffer_t rb;
+	uint8_t storage[RB_SIZE];
+	uint8_t chunk[RB_SIZE];
+	uint8_t next_in = 0, next_out = 0;
+	uint32_t step, i, n, total_in = 0, total_out = 0;
+	uint8_t byte;
+	
+	ring_buffer_init(&rb, storage, RB_SIZE);
+	rb.head = rb.tail = 0xFFFFFF00u;
+	
+	/* Producer and consumer alternate with different chunk sizes, the byte stream must stay in order */
+	for(step = 0; step < 2000; step++)
+	{
+		n = (step * 7) % (RB_SIZE + 1);
+		for(i = 0; i < n; i++)
+			chunk[i] = (uint8_t)(next_in + i);
+		
+		if(step & 1)
+		{
+			n = ring_buffer_write(&rb, chunk, n);
+		}
+		else
+		{
+			n = ring_buffer_put(&rb, next_in);
+		}
+		next_in += (uint8_t)n;
+		total_in += n;
+		
+		CHECK(ring_buffer_count(&rb) <= RB_SIZE);
+		CHECK_EQ(ring_buffer_count(&rb) + ring_buffer_free(&rb), RB_SIZE);
+		
+		n = (step * 5) % 9;
+		if(step % 3)
+		{
+			n = ring_buffer_read(&rb, chunk, n);
+			for(i = 0; i < n; i++)
+				CHECK_EQ(chunk[i], (uint8_t)(next_out + i));
+		}
+		else
+		{
+			n = ring_buffer_get(&rb, &byte);
+			if(n)
+				CHECK_EQ(byte, next_out);
+		}
+		next_out += (uint8_t)n;
+		total_out += n;
+	}
+	
+	CHECK(total_out > 1000);
+	CHECK_EQ(total_in - total_out, ring_buffer_count(&rb));
+}
+
+int main(void)
+{
+	test_init();
+	test_full_empty_boundaries();
+	test_wraparound();
+	test_interleaving();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+/***************************************************************************************************************************
+  * @file    test_ring_buffer_spsc.c
+  * @author  Sharath N
+  * @brief   Host stress test of the ring buffer with the producer and the consumer on separate threads.
+  *          A small ring wraps millions of times, every byte carries its position in the stream so a lost,
+  *          duplicated or torn byte is caught by the consumer. Both the block and the single byte API are used.
+***************************************************************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "ring_buffer.h"
+#include "test_assert.h"
+
+#define RB_SIZE                 64
+#define STREAM_BYTES            (8U * 1024U * 1024U)
+#define MAX_CHUNK               23
+
+static ring_buffer_t rb;
+static uint8_t storage[RB_SIZE];
+
+/* Byte at position i of the stream, does not repeat every 256 bytes */
+static uint8_t stream_byte(uint32_t i)
+{
+	return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+static void *producer(void *arg)
+{
+	uint8_t chunk[MAX_CHUNK];
+	uint32_t pos = 0, len, done, i;
+	
+	(void)arg;
+	
+	while(pos < STREAM_BYTES)
+	{
+		/* Alternate single bytes and blocks of varying length */
+		len = 1 + (pos % MAX_CHUNK);
+		if(len > STREAM_BYTES - pos)
+			len = STREAM_BYTES - pos;
+		
+		if(len == 1)
+		{
+			while(!ring_buffer_put(&rb, stream_byte(pos)))
+				sched_yield();
+			pos++;
+			continue;
+		}
+		
+		for(i = 0; i < len; i++)
+			chunk[i] = stream_byte(pos + i);
+		
+		for(done = 0; done < len; )
+		{
+			i = ring_buffer_write(&rb, &chunk[done], len - done);
+			if(i == 0)
+				sched_yield();
+			done += i;
+		}
+		pos += len;
+	}
+	
+	return 0;
+}
+
+static void *consumer(void *arg)
+{
+	uint32_t *errors = (uint32_t *)arg;
+	uint8_t chunk[MAX_CHUNK];
+	uint8_t byte;
+	uint32_t pos = 0, len, i;
+	
+	while(pos < STREAM_BYTES)
+	{
+		if((pos & 0x07) == 0)
+		{
+			if(!ring_buffer_get(&rb, &byte))
+			{
+				sched_yield();
+				continue;
+			}
+			
+			if(byte != stream_byte(pos))
+				(*errors)++;
+			pos++;
+			continue;
+		}
+		
+		len = ring_buffer_read(&rb, chunk, 1 + (pos % MAX_CHUNK));
+		if(len == 0)
+			sched_yield();
+		
+		for(i = 0; i < len; i++)
+		{
+			if(chunk[i] != stream_byte(pos + i))
+				(*errors)++;
+		}
+		pos += len;
+	}
+	
+	return 0;
+}
+
+static void test_spsc_stream(void)
+{
+	pthread_t prod, cons;
+	uint32_t errors = 0;
+	
+	CHECK_EQ(ring_buffer_init(&rb, storage, RB_SIZE), 0);
+	
+	CHECK_EQ(pthread_create(&cons, 0, consumer, &errors), 0);
+	CHECK_EQ(pthread_create(&prod, 0, producer, 0), 0);
+	pthread_join(prod, 0);
+	pthread_join(cons, 0);
+	
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(rb.head, STREAM_BYTES);
+	CHECK_EQ(rb.tail, STREAM_BYTES);
+	CHECK_EQ(ring_buffer_count(&rb), 0);
+}
+
+int main(void)
+{
+	test_spsc_stream();
+	
+	return TEST_RESULT();
+}
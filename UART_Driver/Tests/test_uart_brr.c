@@ -0,0 +1,104 @@
+/***************************************************************************************************************************
+  * @file    test_uart_brr.c
+  * @author  Sharath N
+  * @brief   Host test of the BRR computation against the RM0090 baud rate tables, OVER16 and OVER8.
+***************************************************************************************************************************/
+
+#include "hal_uart_driver.h"
+#include "test_assert.h"
+
+#define BRR_INVALID   0xFFFFFFFF
+
+typedef struct
+{
+	uint32_t pclk;
+	uint32_t baud;
+	uint32_t over8;
+	uint32_t brr;          /* Expected BRR, mantissa in [15:4], fraction in [3:0] */
+	uint32_t actual;       /* Baud rate generated with brr */
+	uint32_t error;        /* Error in units of 0.01%, BRR_INVALID if the baud rate can not be generated */
+} brr_case_t;
+
+static const brr_case_t brr_cases[] =
+{
+	/* fPCLK = 16 MHz (HSI) */
+	{ 16000000,    9600, 0, 0x683,    9598,   2 },      /* USARTDIV 104.1875 */
+	{ 16000000,  115200, 0, 0x08B,  115107,   8 },      /* USARTDIV 8.6875 */
+	{ 16000000,  921600, 0, 0x011,  941176, 212 },      /* USARTDIV 1.0625 */
+	{ 16000000, 2000000, 0, 0,           0, BRR_INVALID },
+	{ 16000000,    9600, 1, 0xD03,    9598,   2 },      /* USARTDIV 208.375 */
+	{ 16000000,  115200, 1, 0x113,  115107,   8 },      /* USARTDIV 17.375 */
+	{ 16000000, 2000000, 1, 0x010, 2000000,   0 },      /* USARTDIV 1 */
+	{ 16000000, 4000000, 1, 0,           0, BRR_INVALID },
+	
+	/* fPCLK = 42 MHz (APB1 at 168 MHz SYSCLK) */
+	{ 42000000,    9600, 0, 0x1117,   9600,   0 },      /* USARTDIV 273.4375 */
+	{ 42000000,  115200, 0, 0x16D,  115068,  11 },      /* USARTDIV 22.8125 */
+	{ 42000000,  921600, 0, 0x02E,  913043,  92 },      /* USARTDIV 2.875 */
+	{ 42000000, 2000000, 0, 0x015, 2000000,   0 },      /* USARTDIV 1.3125 */
+	{ 42000000,    9600, 1, 0x2227,   9600,   0 },      /* USARTDIV 546.875 */
+	{ 42000000,  115200, 1, 0x2D5,  115068,  11 },      /* USARTDIV 45.625 */
+	{ 42000000, 4000000, 1, 0x013, 3818181, 454 },      /* USARTDIV 1.375 */
+	{ 42000000, 5250000, 1, 0x010, 5250000,   0 },      /* USARTDIV 1, fastest setting */
+	
+	/* fPCLK = 84 MHz (APB2 at 168 MHz SYSCLK) */
+	{ 84000000,    9600, 0, 0x222E,   9600,   0 },      /* USARTDIV 546.875 */
+	{ 84000000,  115200, 0, 0x2D9,  115226,   2 },      /* USARTDIV 45.5625 */
+	{ 84000000,  921600, 0, 0x05B,  923076,  16 },      /* USARTDIV 5.6875 */
+	{ 84000000, 5250000, 0, 0x010, 5250000,   0 },      /* USARTDIV 1 */
+	{ 84000000,    9600, 1, 0x4456,   9600,   0 },      /* USARTDIV 1093.75 */
+	{ 84000000,  115200, 1, 0x5B1,  115226,   2 },      /* USARTDIV 91.125 */
+	{ 84000000, 5250000, 1, 0x020, 5250000,   0 },      /* USARTDIV 2 */
+};
+
+static void test_brr_table(void)
+{
+	uint32_t i, brr, actual, error;
+	
+	for(i = 0; i < sizeof(brr_cases) / sizeof(brr_cases[0]); i++)
+	{
+		const brr_case_t *c = &brr_cases[i];
+		
+		brr = 0xDEAD;
+		actual = 0;
+		error = hal_uart_compute_brr(c->pclk, c->baud, c->over8, &brr, &actual);
+		
+		CHECK_EQ(error, c->error);
+		if(c->error == BRR_INVALID)
+		{
+			/* BRR is left untouched */
+			CHECK_EQ(brr, 0xDEAD);
+			continue;
+		}
+		
+		CHECK_EQ(brr, c->brr);
+		CHECK_EQ(actual, c->actual);
+		
+		/* With OVER8 bit 3 of BRR must be kept cleared */
+		if(c->over8)
+			CHECK((brr & 0x8) == 0);
+	}
+}
+
+static void test_brr_invalid(void)
+{
+	uint32_t brr = 0xDEAD;
+	
+	CHECK_EQ(hal_uart_compute_brr(42000000, 0, 0, &brr, 0), BRR_INVALID);
+	
+	/* Mantissa above 12 bits */
+	CHECK_EQ(hal_uart_compute_brr(84000000, 1200, 0, &brr, 0), BRR_INVALID);
+	CHECK_EQ(brr, 0xDEAD);
+	
+	/* actual_baud may be NULL */
+	CHECK_EQ(hal_uart_compute_brr(42000000, 9600, 0, &brr, 0), 0);
+	CHECK_EQ(brr, 0x1117);
+}
+
+int main(void)
+{
+	test_brr_table();
+	test_brr_invalid();
+	
+	return TEST_RESULT();
+}
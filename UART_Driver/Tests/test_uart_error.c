@@ -0,0 +1,133 @@
+/***************************************************************************************************************************
+  * @file    test_uart_error.c
+  * @author  Sharath N
+  * @brief   Host test of UART line error handling, a receiver error must not disturb an ongoing transmission and
+  *          the error flags must be cleared while the RX DMA stream owns DR.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "fake_dma.h"
+#include "host_trace.h"
+#include "test_assert.h"
+
+HOST_TRACE_PERIPH(USART_TypeDef, traced_usart);
+
+static uint32_t tx_done;
+static uint32_t errors;
+
+static void tx_comp_cb(void *ptr)
+{
+	(void)ptr;
+	tx_done++;
+}
+
+static void error_cb(void *ptr)
+{
+	(void)ptr;
+	errors++;
+}
+
+static void test_rx_error_during_tx(void)
+{
+	uart_handle_t huart;
+	uint8_t tx_data[4] = {1, 2, 3, 4};
+	uint8_t rx_data[4];
+	uint32_t i;
+	
+	memset(&huart, 0, sizeof(huart));
+	memset((void *)USART2, 0, sizeof(*USART2));
+	huart.Instance = USART2;
+	huart.Init.BaudRate = USART_BAUD_RATE_115200;
+	huart.Init.Mode = UART_MODE_TX_RX;
+	huart.tx_comp_cb = tx_comp_cb;
+	huart.error_cb = error_cb;
+	hal_uart_init(&huart);
+	
+	hal_hal_uart_rx(&huart, rx_data, sizeof(rx_data));
+	hal_hal_uart_tx(&huart, tx_data, sizeof(tx_data));
+	
+	USART2->SR = USART_REG_SR_TXE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	/* Frame error on the receiver while the transmitter is busy */
+	USART2->SR = USART_REG_SR_FE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	CHECK_EQ(errors, 1);
+	CHECK_EQ(huart.rx_state, HAL_UART_STATE_READY);
+	CHECK(!(USART2->CR1 & USART_REG_CR1_RXNE_INT_ENABLE));
+	CHECK(!(USART2->CR1 & USART_REG_CR1_PEIE_INT_ENABLE));
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_BUSY_TX);
+	CHECK(USART2->CR1 & USART_REG_CR1_TXE_INT_ENABLE);
+	
+	/* Transmission completes normally */
+	for(i = 1; i < sizeof(tx_data); i++)
+	{
+		USART2->SR = USART_REG_SR_TXE_FLAG;
+		hal_uart_handle_interrupt(&huart);
+		CHECK_EQ(USART2->DR, tx_data[i]);
+	}
+	USART2->SR = USART_REG_SR_TXE_FLAG | USART_REG_SR_TC_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_READY);
+	CHECK(!(USART2->CR1 & (USART_REG_CR1_TXE_INT_ENABLE | USART_REG_CR1_TCIE_INT_ENABLE)));
+}
+
+static void test_rx_error_with_dma(void)
+{
+	uart_handle_t huart;
+	dma_handle_t hdmarx;
+	uint8_t buffer[16];
+	USART_TypeDef *usart = &traced_usart.regs;
+	
+	memset(&huart, 0, sizeof(huart));
+	memset(&hdmarx, 0, sizeof(hdmarx));
+	memset(&traced_usart, 0, sizeof(traced_usart));
+	errors = 0;
+	
+	huart.Instance = usart;
+	huart.Init.BaudRate = USART_BAUD_RATE_115200;
+	huart.Init.Mode = UART_MODE_TX_RX;
+	huart.error_cb = error_cb;
+	hdmarx.Instance = DMA1_Stream5;
+	hdmarx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	huart.hdmarx = &hdmarx;
+	
+	hal_uart_init(&huart);
+	hal_uart_rx_dma_circular(&huart, buffer, sizeof(buffer));
+	CHECK(usart->CR3 & USART_REG_CR3_DMAR);
+	
+	/* The stream already took the byte, RXNE is clear and only the driver can complete the SR, DR sequence */
+	fake_dma_advance(&hdmarx, 1);
+	usart->SR = USART_REG_SR_FE_FLAG;
+	host_trace_start(usart);
+	hal_uart_handle_interrupt(&huart);
+	host_trace_stop();
+	
+	CHECK_EQ(errors, 1);
+	CHECK_EQ(huart.Stats.ErrorFE, 1);
+	CHECK_EQ(host_trace_reads(&usart->DR), 1);
+	CHECK(host_trace_reads(&usart->SR) >= 1);
+	
+	/* The byte is still waiting for the stream, the DR read is left to it */
+	usart->SR = USART_REG_SR_NE_FLAG | USART_REG_SR_RXNE_FLAG;
+	host_trace_start(usart);
+	hal_uart_handle_interrupt(&huart);
+	host_trace_stop();
+	
+	CHECK_EQ(errors, 2);
+	CHECK_EQ(huart.Stats.ErrorNE, 1);
+	CHECK_EQ(host_trace_reads(&usart->DR), 0);
+	CHECK_EQ(huart.rx_state, HAL_UART_STATE_BUSY_RX);
+}
+
+int main(void)
+{
+	test_rx_error_during_tx();
+	test_rx_error_with_dma();
+	
+	return TEST_RESULT();
+}
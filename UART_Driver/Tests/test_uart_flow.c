@@ -0,0 +1,127 @@
+/***************************************************************************************************************************
+  * @file    test_uart_flow.c
+  * @author  Sharath N
+  * @brief   Host test of flow control configuration and of the software RTS watermarks in streaming mode.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "test_assert.h"
+
+#define RTS_PIN        5
+#define RTS_PAUSE      ((uint32_t)1 << RTS_PIN)
+#define RTS_READY      ((uint32_t)1 << (RTS_PIN + 16))
+
+static void uart_setup(uart_handle_t *huart, USART_TypeDef *instance, uint32_t flow_ctl)
+{
+	memset(huart, 0, sizeof(*huart));
+	memset((void *)instance, 0, sizeof(*instance));
+	memset((void *)GPIOA, 0, sizeof(*GPIOA));
+	
+	huart->Instance = instance;
+	huart->Init.BaudRate = USART_BAUD_RATE_115200;
+	huart->Init.Mode = UART_MODE_TX_RX;
+	huart->Init.HwFlowCtl = flow_ctl;
+	huart->RtsPort = GPIOA;
+	huart->RtsPin = RTS_PIN;
+	
+	hal_uart_init(huart);
+}
+
+static void receive_byte(uart_handle_t *huart, uint8_t byte)
+{
+	huart->Instance->DR = byte;
+	huart->Instance->SR = USART_REG_SR_RXNE_FLAG;
+	hal_uart_handle_interrupt(huart);
+}
+
+/* UART4/UART5 have no RTS/CTS pins */
+static void test_hw_flow_control_instances(void)
+{
+	uart_handle_t huart;
+	
+	uart_setup(&huart, UART4, UART_HWCONTROL_RTS_CTS);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_CONFIG);
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_RESET);
+	CHECK(!(UART4->CR1 & USART_REG_CR1_USART_EN));
+	
+	uart_setup(&huart, UART5, UART_HWCONTROL_CTS);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_CONFIG);
+	
+	uart_setup(&huart, UART5, UART_HWCONTROL_SOFT_RTS);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_NONE);
+	CHECK(!(UART5->CR3 & (USART_REG_CR3_RTSE | USART_REG_CR3_CTSE)));
+	
+	uart_setup(&huart, USART2, UART_HWCONTROL_RTS_CTS);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_NONE);
+	CHECK_EQ(USART2->CR3 & (USART_REG_CR3_RTSE | USART_REG_CR3_CTSE), USART_REG_CR3_RTSE | USART_REG_CR3_CTSE);
+}
+
+/* Soft RTS with the ring buffer */
+static void test_soft_rts_ring(void)
+{
+	uart_handle_t huart;
+	ring_buffer_t rx_ring;
+	uint8_t storage[16];
+	uint8_t out[16];
+	uint32_t i;
+	
+	uart_setup(&huart, USART2, UART_HWCONTROL_SOFT_RTS);
+	CHECK_EQ(GPIOA->BSRR, RTS_READY);
+	huart.RxHighWatermark = 12;
+	huart.RxLowWatermark = 4;
+	ring_buffer_init(&rx_ring, storage, sizeof(storage));
+	hal_uart_stream_start(&huart, 0, &rx_ring);
+	
+	for(i = 0; i < 11; i++)
+		receive_byte(&huart, (uint8_t)i);
+	CHECK_EQ(GPIOA->BSRR, RTS_READY);
+	
+	receive_byte(&huart, 11);
+	CHECK_EQ(GPIOA->BSRR, RTS_PAUSE);
+	
+	hal_uart_read(&huart, out, 7);
+	CHECK_EQ(GPIOA->BSRR, RTS_PAUSE);
+	hal_uart_read(&huart, out, 1);
+	CHECK_EQ(GPIOA->BSRR, RTS_READY);
+}
+
+/* Soft RTS with the framer, watermarks count packets */
+static void test_soft_rts_framer(void)
+{
+	uart_handle_t huart;
+	uart_framer_t framer;
+	const uint8_t packet[] = {0x02, 0x11, 0x00};    /* COBS encoded single byte 0x11 */
+	uint32_t i, n;
+	
+	uart_setup(&huart, USART2, UART_HWCONTROL_SOFT_RTS);
+	huart.RxHighWatermark = 3;
+	huart.RxLowWatermark = 1;
+	uart_framer_init(&framer, UART_FRAMING_COBS);
+	huart.framer = &framer;
+	hal_uart_stream_start(&huart, 0, 0);
+	
+	for(n = 0; n < 3; n++)
+	{
+		CHECK_EQ(GPIOA->BSRR, RTS_READY);
+		for(i = 0; i < sizeof(packet); i++)
+			receive_byte(&huart, packet[i]);
+	}
+	CHECK_EQ(GPIOA->BSRR, RTS_PAUSE);
+	CHECK_EQ(huart.Stats.BytesRx, 9);
+	
+	CHECK_EQ(uart_framer_peek(&framer)->data[0], 0x11);
+	hal_uart_release_packet(&huart);
+	CHECK_EQ(GPIOA->BSRR, RTS_PAUSE);
+	hal_uart_release_packet(&huart);
+	CHECK_EQ(GPIOA->BSRR, RTS_READY);
+}
+
+int main(void)
+{
+	test_hw_flow_control_instances();
+	test_soft_rts_ring();
+	test_soft_rts_framer();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,175 @@
+/***************************************************************************************************************************
+  * @file    test_uart_framing.c
+  * @author  Sharath N
+  * @brief   Host test of COBS and SLIP encode/decode round trips.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "stm32f407xx.h"
+#include "uart_framing.h"
+#include "test_assert.h"
+
+#define PATTERN_NONZERO    0
+#define PATTERN_ZEROS      1
+#define PATTERN_MIXED      2
+
+static uint8_t packet[UART_FRAME_MAX_PAYLOAD + 1];
+static uint8_t encoded[SLIP_MAX_ENCODED_LEN(UART_FRAME_MAX_PAYLOAD + 1)];
+
+static void fill(uint32_t len, uint32_t pattern)
+{
+	uint32_t i;
+	
+	for(i = 0; i < len; i++)
+	{
+		if(pattern == PATTERN_NONZERO)
+			packet[i] = (uint8_t)((i % 255) + 1);
+		else if(pattern == PATTERN_ZEROS)
+			packet[i] = 0;
+		else
+			packet[i] = (uint8_t)(i * 37);      /* Hits 0x00, SLIP_END and SLIP_ESC */
+	}
+}
+
+/* Encodes one packet, decodes it byte by byte and compares */
+static void round_trip(uint32_t mode, uint32_t len, uint32_t pattern)
+{
+	uart_framer_t framer;
+	uart_packet_t *p;
+	uint32_t enc_len, i;
+	
+	fill(len, pattern);
+	
+	if(mode == UART_FRAMING_COBS)
+	{
+		enc_len = uart_cobs_encode(packet, len, encoded);
+		CHECK(enc_len <= COBS_MAX_ENCODED_LEN(len));
+		
+		/* Only the delimiter may be zero */
+		for(i = 0; i < enc_len - 1; i++)
+			CHECK(encoded[i] != COBS_DELIMITER);
+		CHECK_EQ(encoded[enc_len - 1], COBS_DELIMITER);
+	}
+	else
+	{
+		enc_len = uart_slip_encode(packet, len, encoded);
+		CHECK(enc_len <= SLIP_MAX_ENCODED_LEN(len));
+		
+		for(i = 1; i < enc_len - 1; i++)
+			CHECK(encoded[i] != SLIP_END);
+	}
+	
+	uart_framer_init(&framer, mode);
+	for(i = 0; i < enc_len; i++)
+		uart_framer_feed(&framer, &encoded[i], 1);
+	
+	CHECK_EQ(framer.Errors, 0);
+	CHECK_EQ(framer.Dropped, 0);
+	
+	p = uart_framer_peek(&framer);
+	CHECK(p != 0);
+	if(p)
+	{
+		CHECK_EQ(p->len, len);
+		CHECK(memcmp(p->data, packet, len) == 0);
+		uart_framer_release(&framer);
+	}
+	CHECK(uart_framer_peek(&framer) == 0);
+}
+
+static void test_round_trips(void)
+{
+	static const uint32_t lengths[] = {1, 2, 253, 254, 255, UART_FRAME_MAX_PAYLOAD};
+	uint32_t i, pattern;
+	
+	for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		for(pattern = PATTERN_NONZERO; pattern <= PATTERN_MIXED; pattern++)
+		{
+			round_trip(UART_FRAMING_COBS, lengths[i], pattern);
+			round_trip(UART_FRAMING_SLIP, lengths[i], pattern);
+		}
+	}
+}
+
+/* 254 non zero bytes fill exactly one COBS block */
+static void test_cobs_254(void)
+{
+	fill(254, PATTERN_NONZERO);
+	CHECK_EQ(uart_cobs_encode(packet, 254, encoded), 256);
+	CHECK_EQ(encoded[0], 0xFF);
+	CHECK_EQ(encoded[255], COBS_DELIMITER);
+	
+	fill(255, PATTERN_NONZERO);
+	CHECK_EQ(uart_cobs_encode(packet, 255, encoded), 258);
+	CHECK_EQ(encoded[255], 0x02);
+}
+
+/* Empty packets encode to a bare frame, the decoder drops them without error */
+static void test_empty_packet(void)
+{
+	uart_framer_t framer;
+	uint32_t mode, enc_len;
+	
+	enc_len = uart_cobs_encode(packet, 0, encoded);
+	CHECK_EQ(enc_len, 2);
+	CHECK_EQ(encoded[0], 0x01);
+	CHECK_EQ(encoded[1], COBS_DELIMITER);
+	
+	enc_len = uart_slip_encode(packet, 0, encoded);
+	CHECK_EQ(enc_len, 2);
+	CHECK_EQ(encoded[0], SLIP_END);
+	CHECK_EQ(encoded[1], SLIP_END);
+	
+	for(mode = UART_FRAMING_COBS; mode <= UART_FRAMING_SLIP; mode++)
+	{
+		enc_len = (mode == UART_FRAMING_COBS) ? uart_cobs_encode(packet, 0, encoded) : uart_slip_encode(packet, 0, encoded);
+		uart_framer_init(&framer, mode);
+		uart_framer_feed(&framer, encoded, enc_len);
+		CHECK(uart_framer_peek(&framer) == 0);
+		CHECK_EQ(framer.Errors, 0);
+		CHECK_EQ(framer.Dropped, 0);
+	}
+}
+
+/* One byte above the maximum payload is dropped, the next frame decodes again */
+static void test_max_length(void)
+{
+	uart_framer_t framer;
+	uint32_t mode, enc_len;
+	uart_packet_t *p;
+	
+	for(mode = UART_FRAMING_COBS; mode <= UART_FRAMING_SLIP; mode++)
+	{
+		uart_framer_init(&framer, mode);
+		
+		fill(UART_FRAME_MAX_PAYLOAD + 1, PATTERN_MIXED);
+		enc_len = (mode == UART_FRAMING_COBS) ? uart_cobs_encode(packet, UART_FRAME_MAX_PAYLOAD + 1, encoded) :
+		                                        uart_slip_encode(packet, UART_FRAME_MAX_PAYLOAD + 1, encoded);
+		uart_framer_feed(&framer, encoded, enc_len);
+		CHECK(uart_framer_peek(&framer) == 0);
+		CHECK_EQ(framer.Dropped, 1);
+		
+		fill(UART_FRAME_MAX_PAYLOAD, PATTERN_MIXED);
+		enc_len = (mode == UART_FRAMING_COBS) ? uart_cobs_encode(packet, UART_FRAME_MAX_PAYLOAD, encoded) :
+		                                        uart_slip_encode(packet, UART_FRAME_MAX_PAYLOAD, encoded);
+		uart_framer_feed(&framer, encoded, enc_len);
+		p = uart_framer_peek(&framer);
+		CHECK(p != 0);
+		if(p)
+		{
+			CHECK_EQ(p->len, UART_FRAME_MAX_PAYLOAD);
+			CHECK(memcmp(p->data, packet, UART_FRAME_MAX_PAYLOAD) == 0);
+		}
+	}
+}
+
+int main(void)
+{
+	test_round_trips();
+	test_cobs_254();
+	test_empty_packet();
+	test_max_length();
+	
+	return TEST_RESULT();
+}
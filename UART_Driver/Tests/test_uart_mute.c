@@ -0,0 +1,86 @@
+/***************************************************************************************************************************
+  * @file    test_uart_mute.c
+  * @author  Sharath N
+  * @brief   Host test of address mark wakeup, the mark is the MSB of the configured word length.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "test_assert.h"
+
+#define NODE_ADDRESS   0x5
+
+static void uart_setup(uart_handle_t *huart, uint32_t word_length, uint32_t parity)
+{
+	memset(huart, 0, sizeof(*huart));
+	memset((void *)USART2, 0, sizeof(*USART2));
+	
+	huart->Instance = USART2;
+	huart->Init.BaudRate = USART_BAUD_RATE_115200;
+	huart->Init.Mode = UART_MODE_TX_RX;
+	huart->Init.WordLength = word_length;
+	huart->Init.Parity = parity;
+	huart->Init.MuteMode = UART_WAKEUP_ADDRESS_MARK;
+	huart->Init.NodeAddress = NODE_ADDRESS;
+	
+	hal_uart_init(huart);
+}
+
+static void receive(uart_handle_t *huart, uint32_t dr)
+{
+	USART2->DR = dr;
+	USART2->SR = USART_REG_SR_RXNE_FLAG;
+	hal_uart_handle_interrupt(huart);
+}
+
+/* Address character is dropped, payload with the MSB cleared is kept */
+static void check_mark(uint32_t word_length, uint32_t mark, uint32_t data)
+{
+	uart_handle_t huart;
+	uint8_t rx[2] = {0};
+	
+	uart_setup(&huart, word_length, UART_PARITY_NONE);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_NONE);
+	CHECK(USART2->CR1 & USART_REG_CR1_WAKE);
+	CHECK_EQ(USART2->CR2 & USART_REG_CR2_ADD_MASK, NODE_ADDRESS);
+	
+	hal_hal_uart_rx(&huart, rx, sizeof(rx));
+	receive(&huart, mark | NODE_ADDRESS);
+	receive(&huart, data);
+	receive(&huart, data + 1);
+	
+	CHECK_EQ(rx[0], data);
+	CHECK_EQ(rx[1], data + 1);
+	CHECK_EQ(huart.rx_state, HAL_UART_STATE_READY);
+	
+	USART2->SR = USART_REG_SR_TXE_FLAG;
+	hal_uart_send_address(&huart, 0x3);
+	CHECK_EQ(USART2->DR, mark | 0x3);
+}
+
+static void test_address_mark(void)
+{
+	check_mark(USART_WL_1S8B, USART_DR_ADDRESS_MARK_8B, 0x41);
+	
+	/* In 9 bit mode bit 7 is payload */
+	check_mark(USART_WL_1S9B, USART_DR_ADDRESS_MARK, 0x81);
+}
+
+static void test_invalid_config(void)
+{
+	uart_handle_t huart;
+	
+	uart_setup(&huart, USART_WL_1S8B, 1);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_CONFIG);
+	
+	uart_setup(&huart, 2, UART_PARITY_NONE);
+	CHECK_EQ(huart.ErrorCode, HAL_UART_ERROR_CONFIG);
+}
+
+int main(void)
+{
+	test_address_mark();
+	test_invalid_config();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,77 @@
+/***************************************************************************************************************************
+  * @file    test_uart_rx_dma.c
+  * @author  Sharath N
+  * @brief   Host test of circular DMA reception, a line error must not stop the reception.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "fake_dma.h"
+#include "test_assert.h"
+
+static uint32_t rx_bytes;
+static uint32_t errors;
+
+static void rx_event_cb(uint8_t *data, uint32_t len)
+{
+	(void)data;
+	rx_bytes += len;
+}
+
+static void error_cb(void *ptr)
+{
+	(void)ptr;
+	errors++;
+}
+
+static void test_line_error_keeps_reception(void)
+{
+	uart_handle_t huart;
+	dma_handle_t hdmarx;
+	uint8_t buffer[16];
+	
+	memset(&huart, 0, sizeof(huart));
+	memset((void *)USART2, 0, sizeof(*USART2));
+	memset(&hdmarx, 0, sizeof(hdmarx));
+	
+	huart.Instance = USART2;
+	huart.Init.BaudRate = USART_BAUD_RATE_115200;
+	huart.Init.Mode = UART_MODE_TX_RX;
+	huart.rx_event_cb = rx_event_cb;
+	huart.error_cb = error_cb;
+	hdmarx.Instance = DMA1_Stream5;
+	hdmarx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	huart.hdmarx = &hdmarx;
+	
+	hal_uart_init(&huart);
+	hal_uart_rx_dma_circular(&huart, buffer, sizeof(buffer));
+	
+	/* Frame error in the middle of a burst */
+	fake_dma_advance(&hdmarx, 3);
+	USART2->SR = USART_REG_SR_FE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	CHECK_EQ(errors, 1);
+	CHECK_EQ(huart.Stats.ErrorFE, 1);
+	CHECK_EQ(huart.rx_state, HAL_UART_STATE_BUSY_RX);
+	CHECK(USART2->CR3 & USART_REG_CR3_DMAR);
+	CHECK(hdmarx.State == HAL_DMA_STATE_BUSY);
+	
+	/* Later bursts are still delivered on IDLE */
+	fake_dma_advance(&hdmarx, 4);
+	USART2->SR = USART_REG_SR_IDLE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	CHECK_EQ(rx_bytes, 7);
+	
+	fake_dma_advance(&hdmarx, 12);
+	USART2->SR = USART_REG_SR_IDLE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	CHECK_EQ(rx_bytes, 19);
+}
+
+int main(void)
+{
+	test_line_error_keeps_reception();
+	
+	return TEST_RESULT();
+}
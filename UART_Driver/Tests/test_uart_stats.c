@@ -0,0 +1,75 @@
+/***************************************************************************************************************************
+  * @file    test_uart_stats.c
+  * @author  Sharath N
+  * @brief   Host test of the statistics sequence counter when UART and DMA interrupt handlers nest.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "fake_dma.h"
+#include "test_assert.h"
+
+static uart_handle_t huart;
+static dma_handle_t hdmatx;
+static uint32_t seq_in_nested;
+
+/* The DMA interrupt preempts the UART interrupt from inside the receive complete callback */
+static void rx_comp_cb(void *ptr)
+{
+	(void)ptr;
+	fake_dma_complete(&hdmatx);
+	seq_in_nested = huart.Stats.Sequence;
+}
+
+static void test_nested_writers(void)
+{
+	uint8_t tx_data[8] = {0};
+	uint8_t rx_data[1];
+	uart_stats_t stats;
+	
+	memset(&huart, 0, sizeof(huart));
+	memset((void *)USART2, 0, sizeof(*USART2));
+	memset(&hdmatx, 0, sizeof(hdmatx));
+	huart.Instance = USART2;
+	huart.Init.BaudRate = USART_BAUD_RATE_115200;
+	huart.Init.Mode = UART_MODE_TX_RX;
+	huart.rx_comp_cb = rx_comp_cb;
+	hdmatx.Instance = DMA1_Stream6;
+	hdmatx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	huart.hdmatx = &hdmatx;
+	hal_uart_init(&huart);
+	CHECK_EQ(huart.Stats.Sequence & 1, 0);
+	
+	hal_uart_tx_dma(&huart, tx_data, sizeof(tx_data));
+	hal_hal_uart_rx(&huart, rx_data, sizeof(rx_data));
+	
+	USART2->DR = 0x55;
+	USART2->SR = USART_REG_SR_RXNE_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	/* The nested DMA handler finished first, the UART handler was still updating */
+	CHECK_EQ(seq_in_nested & 1, 1);
+	CHECK_EQ(huart.Stats.Sequence & 1, 0);
+	CHECK_EQ(huart.StatsWriters, 0);
+	CHECK_EQ(__get_PRIMASK(), 0);
+	
+	hal_uart_get_stats(&huart, &stats);
+	CHECK_EQ(stats.BytesRx, 1);
+	CHECK_EQ(stats.BytesTx, sizeof(tx_data));
+	CHECK_EQ(stats.IsrCount, 1);
+	
+	/* Reset from thread context keeps the sequence even and restores PRIMASK */
+	hal_uart_reset_stats(&huart);
+	CHECK_EQ(huart.Stats.Sequence & 1, 0);
+	CHECK_EQ(__get_PRIMASK(), 0);
+	hal_uart_get_stats(&huart, &stats);
+	CHECK_EQ(stats.BytesRx, 0);
+	CHECK_EQ(stats.BytesTx, 0);
+}
+
+int main(void)
+{
+	test_nested_writers();
+	
+	return TEST_RESULT();
+}
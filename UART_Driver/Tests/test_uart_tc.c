@@ -0,0 +1,106 @@
+/***************************************************************************************************************************
+  * @file    test_uart_tc.c
+  * @author  Sharath N
+  * @brief   Host test of the TC(transmission complete) driven end of UART transmission, interrupt and DMA mode.
+***************************************************************************************************************************/
+
+#include <string.h>
+#include "hal_uart_driver.h"
+#include "fake_dma.h"
+#include "test_assert.h"
+
+static uint32_t tx_done;
+
+static void tx_comp_cb(void *ptr)
+{
+	(void)ptr;
+	tx_done++;
+}
+
+static void uart_setup(uart_handle_t *huart)
+{
+	memset(huart, 0, sizeof(*huart));
+	memset((void *)USART2, 0, sizeof(*USART2));
+	
+	huart->Instance = USART2;
+	huart->Init.BaudRate = USART_BAUD_RATE_115200;
+	huart->Init.Mode = UART_MODE_TX_RX;
+	huart->tx_comp_cb = tx_comp_cb;
+	
+	hal_uart_init(huart);
+	tx_done = 0;
+}
+
+/* Interrupt mode: last TXE arms TCIE, callback runs only once the shift register is empty */
+static void test_tc_interrupt_mode(void)
+{
+	uart_handle_t huart;
+	uint8_t data[3] = {1, 2, 3};
+	uint32_t i;
+	
+	uart_setup(&huart);
+	hal_hal_uart_tx(&huart, data, sizeof(data));
+	
+	for(i = 0; i < sizeof(data); i++)
+	{
+		USART2->SR = USART_REG_SR_TXE_FLAG;
+		hal_uart_handle_interrupt(&huart);
+		CHECK_EQ(USART2->DR, data[i]);
+	}
+	
+	CHECK(!(USART2->CR1 & USART_REG_CR1_TXE_INT_ENABLE));
+	CHECK(USART2->CR1 & USART_REG_CR1_TCIE_INT_ENABLE);
+	CHECK_EQ(tx_done, 0);
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_BUSY_TX);
+	
+	/* Last byte left the shift register */
+	USART2->SR = USART_REG_SR_TXE_FLAG | USART_REG_SR_TC_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_READY);
+	CHECK(!(USART2->CR1 & USART_REG_CR1_TCIE_INT_ENABLE));
+}
+
+/* DMA mode: TC is cleared without touching the other flags, stream completion arms TCIE */
+static void test_tc_dma_mode(void)
+{
+	uart_handle_t huart;
+	dma_handle_t hdmatx;
+	uint8_t data[8] = {0};
+	
+	uart_setup(&huart);
+	memset(&hdmatx, 0, sizeof(hdmatx));
+	hdmatx.Instance = DMA1_Stream6;
+	hdmatx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	huart.hdmatx = &hdmatx;
+	
+	/* RXNE set between the read and the write of a read-modify-write would have been lost */
+	USART2->SR = USART_REG_SR_TC_FLAG | USART_REG_SR_RXNE_FLAG;
+	hal_uart_tx_dma(&huart, data, sizeof(data));
+	
+	CHECK(!(USART2->SR & USART_REG_SR_TC_FLAG));
+	CHECK(USART2->SR & USART_REG_SR_RXNE_FLAG);
+	CHECK(USART2->CR3 & USART_REG_CR3_DMAT);
+	
+	fake_dma_complete(&hdmatx);
+	
+	CHECK(!(USART2->CR3 & USART_REG_CR3_DMAT));
+	CHECK(USART2->CR1 & USART_REG_CR1_TCIE_INT_ENABLE);
+	CHECK_EQ(tx_done, 0);
+	
+	USART2->SR = USART_REG_SR_TXE_FLAG | USART_REG_SR_TC_FLAG;
+	hal_uart_handle_interrupt(&huart);
+	
+	CHECK_EQ(tx_done, 1);
+	CHECK_EQ(huart.tx_state, HAL_UART_STATE_READY);
+	CHECK_EQ(huart.Stats.BytesTx, sizeof(data));
+}
+
+int main(void)
+{
+	test_tc_interrupt_mode();
+	test_tc_dma_mode();
+	
+	return TEST_RESULT();
+}
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "hal_uart_driver.h"
+#include "hal_rcc_driver.h"
 #include "led.h"
 
 /***************************************************************************************************************************/
@@ -135,29 +136,44 @@ static void hal_uart_configure_stop_bits(USART_TypeDef *uartx, uint32_t nstop)
 
 
 /**
-  * @brief  Configures the baud rate
+  * @brief  Returns the peripheral clock of the given UART
   * @param  *uartx : Base address of UART or USART peripheral
-  * @param   baud : baudrate value to be programmed
-  * @retval  none   
+  * @retval  PCLK2 for USART1/USART6, PCLK1 for others
  */
-static void hal_uart_set_baud_rate(USART_TypeDef *uartx, uint32_t baud)
+static uint32_t hal_uart_get_pclk(USART_TypeDef *uartx)
 {
-	uint32_t val;
-	
-	if(baud == USART_BAUD_RATE_9600)
+	if((uartx == USART1) || (uartx == USART6))
 	{
-		val = 0x683;
+		return hal_rcc_get_pclk2_freq();
 	}
-	else if(baud == USART_BAUD_RATE_115200)
-	{
-		val = 0x8A;
-	}
-	else
+	
+	return hal_rcc_get_pclk1_freq();
+}
+
+
+
+
+/**
+  * @brief  Configures the baud rate
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  0 if baud rate is within USART_BAUD_ERROR_TOLERANCE, 1 otherwise
+ */
+static uint8_t hal_uart_set_baud_rate(uart_handle_t *huart)
+{
+	uint32_t brr, error;
+	
+	error = hal_uart_compute_brr(hal_uart_get_pclk(huart->Instance), huart->Init.BaudRate,
+	                             huart->Init.OverSampling, &brr, &huart->ActualBaudRate);
+	huart->BaudError = error;
+	
+	if(error > USART_BAUD_ERROR_TOLERANCE)
 	{
-		val = 0x8A;
+		return 1;
 	}
 	
-	uartx->BRR = val;
+	huart->Instance->BRR = brr;
+	
+	return 0;
 }
 
 
@@ -175,6 +191,10 @@ static void hal_uart_configure_over_sampling(USART_TypeDef *uartx, uint32_t over
 	{
 		uartx->CR1 |= USART_REG_CR1_OVER8;
 	}
+	else
+	{
+		uartx->CR1 &= ~USART_REG_CR1_OVER8;
+	}
 }
 
 
@@ -242,6 +262,120 @@ static void hal_uart_configure_error_interrup(USART_TypeDef *uartx, uint32_t err
 
 
 
+/**
+  * @brief  Configures multiprocessor communication (mute mode wakeup method and node address)
+  * @param  *uartx : Base address of UART or USART peripheral
+  * @param   mute_mode : UART_MUTE_MODE_DISABLE, UART_WAKEUP_IDLE_LINE or UART_WAKEUP_ADDRESS_MARK
+  * @param   address : 4 bit address of this node, used by address mark wakeup
+  * @retval  none   
+ */
+static void hal_uart_configure_mute_mode(USART_TypeDef *uartx, uint32_t mute_mode, uint32_t address)
+{
+	uartx->CR2 &= ~USART_REG_CR2_ADD_MASK;
+	uartx->CR2 |= (address & USART_REG_CR2_ADD_MASK);
+	
+	if(mute_mode == UART_WAKEUP_ADDRESS_MARK)
+	{
+		uartx->CR1 |= USART_REG_CR1_WAKE;
+	}
+	else
+	{
+		uartx->CR1 &= ~USART_REG_CR1_WAKE;
+	}
+}
+
+
+
+
+/**
+  * @brief  Configures RTS/CTS hardware flow control
+  * @param  *uartx : Base address of UART or USART peripheral
+  * @param   flow_ctl : UART_HWCONTROL_xxx value
+  * @retval  none   
+ */
+static void hal_uart_configure_hw_flow_control(USART_TypeDef *uartx, uint32_t flow_ctl)
+{
+	uartx->CR3 &= ~(USART_REG_CR3_RTSE | USART_REG_CR3_CTSE);
+	
+	/* With software RTS only CTS is handled by the hardware */
+	uartx->CR3 |= (flow_ctl & (USART_REG_CR3_RTSE | USART_REG_CR3_CTSE));
+}
+
+
+
+
+/**
+  * @brief  Drives the software RTS pin, RTS is active low
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @param   ready : if ready = 1, RTS is asserted and sender may transmit
+  * @retval  none   
+ */
+static void hal_uart_drive_soft_rts(uart_handle_t *huart, uint8_t ready)
+{
+	/* BSRR write is atomic, so both ISR and application can drive the pin */
+	if(ready)
+		huart->RtsPort->BSRR = ((uint32_t)1 << (huart->RtsPin + 16));
+	else
+		huart->RtsPort->BSRR = ((uint32_t)1 << huart->RtsPin);
+}
+
+
+
+
+/**
+  * @brief  Returns the fill level of the streaming receive path, compared against the software RTS watermarks
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  packets queued in the framer, or bytes queued in rx_ring
+ */
+static uint32_t hal_uart_rx_level(uart_handle_t *huart)
+{
+	if(huart->framer)
+		return huart->framer->Head - huart->framer->Tail;
+	
+	return ring_buffer_count(huart->rx_ring);
+}
+
+
+
+
+/**
+  * @brief  Returns the DR bit which marks an address character, the MSB of the configured word length
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  USART_DR_ADDRESS_MARK or USART_DR_ADDRESS_MARK_8B
+ */
+static uint32_t hal_uart_address_mark(uart_handle_t *huart)
+{
+	return (huart->Init.WordLength == USART_WL_1S9B) ? USART_DR_ADDRESS_MARK : USART_DR_ADDRESS_MARK_8B;
+}
+
+
+
+
+/**
+  * @brief  Checks the init parameters against the features of the peripheral
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  0 if supported, 1 otherwise
+ */
+static uint8_t hal_uart_check_config(uart_handle_t *huart)
+{
+	/* UART4/UART5 have no RTS/CTS pins, only software RTS can be used */
+	if(((huart->Instance == UART4) || (huart->Instance == UART5)) &&
+	   (huart->Init.HwFlowCtl & (USART_REG_CR3_RTSE | USART_REG_CR3_CTSE)))
+		return 1;
+	
+	if((huart->Init.WordLength != USART_WL_1S8B) && (huart->Init.WordLength != USART_WL_1S9B))
+		return 1;
+	
+	/* With parity the MSB is the parity bit, it can not carry the address mark */
+	if((huart->Init.MuteMode == UART_WAKEUP_ADDRESS_MARK) && (huart->Init.Parity != UART_PARITY_NONE))
+		return 1;
+	
+	return 0;
+}
+
+
+
+
 /**
   * @brief  Enable/Disable Parity Error interrupt
   * @param  *uartx : Base address of UART or USART peripheral
@@ -263,6 +397,55 @@ static void hal_uart_configure_parity_error_interrup(USART_TypeDef *uartx, uint3
 
 
 
+/**
+  * @brief  Marks the start of a statistics update, must only be used at the top of an interrupt handler.
+  *         UART and DMA interrupts may preempt each other, only the outermost writer moves Sequence to odd
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  none   
+ */
+static void hal_uart_stats_begin(uart_handle_t *huart)
+{
+	uint32_t primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(huart->StatsWriters++ == 0)
+	{
+		huart->Stats.Sequence++;
+		__DMB();
+	}
+	
+	__set_PRIMASK(primask);
+}
+
+
+
+
+/**
+  * @brief  Marks the end of a statistics update
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  none   
+ */
+static void hal_uart_stats_end(uart_handle_t *huart)
+{
+	uint32_t primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(--huart->StatsWriters == 0)
+	{
+		__DMB();
+		huart->Stats.Sequence++;
+	}
+	
+	__set_PRIMASK(primask);
+}
+
+
+
+
 /**
   * @brief  UART Error callback
   * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
@@ -270,6 +453,14 @@ static void hal_uart_configure_parity_error_interrup(USART_TypeDef *uartx, uint3
  */
 static void hal_uart_error_cb(uart_handle_t *huart)
 {
+	/* Let the application decide, error history is kept in the statistics counters */
+	if(huart->error_cb)
+	{
+		huart->error_cb(&huart->ErrorCode);
+		huart->ErrorCode = HAL_UART_ERROR_NONE;
+		return;
+	}
+	
 	while(1)
 	{
 		led_turn_on(GPIOD, LED_RED);
@@ -279,6 +470,30 @@ static void hal_uart_error_cb(uart_handle_t *huart)
 
 
 
+/**
+  * @brief  Loads the next non empty scatter-gather segment into the transmit pointer and count
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  1 if a segment is loaded, 0 if there are no more segments
+ */
+static uint8_t hal_uart_next_tx_segment(uart_handle_t *huart)
+{
+	while(huart->TxIovCount)
+	{
+		huart->TxIovCount--;
+		huart->pTxBufferPtr = (uint8_t *)huart->pTxIov->base;
+		huart->TxXferCount = huart->pTxIov->len;
+		huart->pTxIov++;
+		
+		if(huart->TxXferCount)
+			return 1;
+	}
+	
+	return 0;
+}
+
+
+
+
 /**
   * @brief  Handle the TXE interrupt
   * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
@@ -294,8 +509,9 @@ static void hal_uart_handle_TXE_interrupt(uart_handle_t *huart)
 	{
 		val = (uint8_t)(*huart->pTxBufferPtr++ & (uint32_t)0x00FF);
 		huart->Instance->DR = val;
+		huart->Stats.BytesTx++;
 		
-		if(--huart->TxXferCount == 0)
+		if((--huart->TxXferCount == 0) && !hal_uart_next_tx_segment(huart))
 		{
 			/*Disable the UART TXE interrupt*/
 			huart->Instance->CR1 &= ~USART_REG_CR1_TXE_INT_ENABLE;
@@ -305,6 +521,20 @@ static void hal_uart_handle_TXE_interrupt(uart_handle_t *huart)
 		}
 
 	}
+	else if(huart->tx_ring)
+	{
+		/* Streaming mode, send next byte queued by the application */
+		if(ring_buffer_get(huart->tx_ring, &val))
+		{
+			huart->Instance->DR = val;
+			huart->Stats.BytesTx++;
+		}
+		else
+		{
+			/*Nothing more to send, hal_uart_write will enable TXE again */
+			USART_REG_BITBAND(huart->Instance->CR1, USART_REG_CR1_TXE_INT_ENABLE_POS) = 0;
+		}
+	}
 	
 }
 
@@ -319,23 +549,34 @@ static void hal_uart_handle_TXE_interrupt(uart_handle_t *huart)
 static void hal_uart_handle_RXNE_interrupt(uart_handle_t *huart)
 {
 	uint32_t temp = 0;
+	uint32_t dr;
 	uint8_t val;
 	
+	/* Read DR once, it holds upto 9 bits */
+	dr = huart->Instance->DR;
+	
+	/* Address character which woke this node up, it is not part of the payload */
+	if((huart->Init.MuteMode == UART_WAKEUP_ADDRESS_MARK) && (dr & hal_uart_address_mark(huart)))
+		return;
+	
+	/*If application is using parity? */
+	if((huart->Init.Parity == UART_PARITY_NONE) || (huart->Init.WordLength == USART_WL_1S9B))
+	{
+		//No Parity, or parity is in the 9th bit
+		val = (uint8_t)(dr & (uint8_t)0x00FF);
+	}
+	else
+	{
+		//Parity =YES, dont read MSB its a parity bit
+		val = (uint8_t)(dr & (uint8_t)0x007F);
+	}
+	
 	temp = huart->rx_state;
 	if(temp == HAL_UART_STATE_BUSY_RX)
 	{
-		/*If application is using parity? */
-		if(huart->Init.Parity == UART_PARITY_NONE)
-		{
-			//No Parity
-			*huart->pRxBufferPtr++ = (uint8_t)(huart->Instance->DR & (uint8_t)0x00FF);
-		}
-		else
-		{
-			//Parity =YES, dont read MSB its a parity bit
-			*huart->pRxBufferPtr++ = (uint8_t)(huart->Instance->DR & (uint8_t)0x007F);
-		}
+		*huart->pRxBufferPtr++ = val;
 		
+		huart->Stats.BytesRx++;
 		
 		if(--huart->RxXferCount == 0)
 		{
@@ -348,6 +589,10 @@ static void hal_uart_handle_RXNE_interrupt(uart_handle_t *huart)
 			/*Disable the UART error interrupt */
 			huart->Instance->CR3 &= ~USART_REG_CR3_ERR_INT_ENABLE;
 			
+			/*Frame is complete, go back to sleep until this node is addressed again */
+			if(huart->Init.MuteMode != UART_MUTE_MODE_DISABLE)
+				huart->Instance->CR1 |= USART_REG_CR1_RWU;
+			
 			/*make state ready for this handle */
 			huart->rx_state = HAL_UART_STATE_READY;
 			
@@ -356,6 +601,21 @@ static void hal_uart_handle_RXNE_interrupt(uart_handle_t *huart)
 		      huart->rx_comp_cb(&huart->RxXferSize);
 			}
 		}
+	else if(huart->rx_ring || huart->framer)
+	{
+		/* Streaming mode, byte is dropped if application does not drain the ring buffer in time */
+		huart->Stats.BytesRx++;
+		
+		/* Framing layer decodes straight into its packet queue, raw bytes are not queued */
+		if(huart->framer)
+			uart_framer_feed(huart->framer, &val, 1);
+		else if(!ring_buffer_put(huart->rx_ring, val))
+			huart->Stats.RxDropped++;
+		
+		/* Ask the sender to pause before the ring buffer or the packet queue overflows */
+		if((huart->Init.HwFlowCtl & UART_HWCONTROL_SOFT_RTS) && (hal_uart_rx_level(huart) >= huart->RxHighWatermark))
+			hal_uart_drive_soft_rts(huart, 0);
+	}
 }
 
 
@@ -390,10 +650,160 @@ static void hal_uart_handle_TC_interrupt(uart_handle_t *huart)
  */
 static void hal_uart_clear_error_flag(uart_handle_t *huart)
 {
-	/* It is cleared by a software sequence (an read to the USART_SR register followed by a read to the USART_DR register).*/
+	/* It is cleared by a software sequence (an read to the USART_SR register followed by a read to the USART_DR register).
+	   SR is already read by hal_uart_handle_interrupt, so only DR has to be read here */
 	uint32_t temp = 0x00;
-	temp = huart->Instance->SR;
 	temp = huart->Instance->DR;
+	(void)temp;
+}
+
+
+
+
+/**
+  * @brief  DMA transmit complete callback, all bytes are now written to DR
+  * @param  *hdma: pointer to dma_handle_t structure of the UART TX stream
+  * @retval  none   
+ */
+static void hal_uart_dma_tx_cplt(void *hdma)
+{
+	uart_handle_t *huart = (uart_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hal_uart_stats_begin(huart);
+	huart->Stats.BytesTx += huart->TxXferCount;
+	hal_uart_stats_end(huart);
+	
+	/*Scatter-gather: chain the next segment, DMA transmit request stays enabled */
+	if(hal_uart_next_tx_segment(huart))
+	{
+		hal_dma_start_it(huart->hdmatx, (uint32_t)huart->pTxBufferPtr, (uint32_t)&huart->Instance->DR, huart->TxXferCount);
+		return;
+	}
+	
+	huart->TxXferCount = 0;
+	
+	/*Disable the DMA transmit request */
+	huart->Instance->CR3 &= ~USART_REG_CR3_DMAT;
+	
+	/*Enable the UART Transmit complete interrupt, tx_comp_cb is called once last byte is shifted out */
+	huart->Instance->CR1 |= USART_REG_CR1_TCIE_INT_ENABLE;
+}
+
+
+
+
+/**
+  * @brief  Passes one contiguous chunk of DMA received bytes to the framing layer and the application
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @param  *data: received bytes
+  * @param  len: number of received bytes
+  * @retval  none   
+ */
+static void hal_uart_rx_dma_chunk(uart_handle_t *huart, uint8_t *data, uint32_t len)
+{
+	if(huart->framer)
+		uart_framer_feed(huart->framer, data, len);
+	
+	if(huart->rx_event_cb)
+		huart->rx_event_cb(data, len);
+}
+
+
+
+
+/**
+  * @brief  Hands over the bytes written by the DMA since the last call to the application
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  none   
+ */
+static void hal_uart_rx_dma_deliver(uart_handle_t *huart)
+{
+	uint32_t pos;
+	
+	/* NDTR counts down from buffer size, it reloads in circular mode */
+	pos = huart->RxXferSize - hal_dma_get_counter(huart->hdmarx);
+	
+	if(pos == huart->RxReadPos)
+		return;
+	
+	huart->Stats.BytesRx += (pos >= huart->RxReadPos) ? (pos - huart->RxReadPos) : (huart->RxXferSize - huart->RxReadPos + pos);
+	
+	if(pos > huart->RxReadPos)
+	{
+		hal_uart_rx_dma_chunk(huart, huart->pRxBufferPtr + huart->RxReadPos, pos - huart->RxReadPos);
+	}
+	else
+	{
+		/* DMA wrapped around, deliver the tail and then the head of the buffer */
+		hal_uart_rx_dma_chunk(huart, huart->pRxBufferPtr + huart->RxReadPos, huart->RxXferSize - huart->RxReadPos);
+		
+		if(pos)
+			hal_uart_rx_dma_chunk(huart, huart->pRxBufferPtr, pos);
+	}
+	
+	huart->RxReadPos = (pos == huart->RxXferSize) ? 0 : pos;
+}
+
+
+
+
+/**
+  * @brief  DMA receive half/full transfer callback of circular reception
+  * @param  *hdma: pointer to dma_handle_t structure of the UART RX stream
+  * @retval  none   
+ */
+static void hal_uart_dma_rx_event(void *hdma)
+{
+	uart_handle_t *huart = (uart_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	hal_uart_stats_begin(huart);
+	hal_uart_rx_dma_deliver(huart);
+	hal_uart_stats_end(huart);
+}
+
+
+
+
+/**
+  * @brief  Handle the IDLE interrupt, the sender paused so deliver whatever was received
+  * @param  *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module
+  * @retval  none   
+ */
+static void hal_uart_handle_IDLE_interrupt(uart_handle_t *huart)
+{
+	uint32_t temp = 0x00;
+	
+	/* IDLE flag is cleared by a read to the USART_SR register followed by a read to the USART_DR register,
+	   SR is already read by hal_uart_handle_interrupt */
+	temp = huart->Instance->DR;
+	(void)temp;
+	
+	if(huart->rx_state == HAL_UART_STATE_BUSY_RX)
+		hal_uart_rx_dma_deliver(huart);
+}
+
+
+
+
+/**
+  * @brief  DMA transfer error callback
+  * @param  *hdma: pointer to dma_handle_t structure of the UART stream
+  * @retval  none   
+ */
+static void hal_uart_dma_error(void *hdma)
+{
+	uart_handle_t *huart = (uart_handle_t *)((dma_handle_t *)hdma)->Parent;
+	
+	huart->Instance->CR3 &= ~(USART_REG_CR3_DMAT | USART_REG_CR3_DMAR);
+	huart->ErrorCode |= HAL_UART_ERROR_DMA;
+	
+	hal_uart_stats_begin(huart);
+	huart->Stats.ErrorDMA++;
+	hal_uart_stats_end(huart);
+	huart->rx_state = HAL_UART_STATE_READY;
+	huart->tx_state = HAL_UART_STATE_READY;
+	
+	hal_uart_error_cb(huart);
 }
 
 
@@ -405,6 +815,46 @@ static void hal_uart_clear_error_flag(uart_handle_t *huart)
 /*                                                                                                                                 */
 /***********************************************************************************************************************************/
 
+/**
+  * @brief  Computes the BRR register value for the given peripheral clock and baud rate
+  * @param  pclk : peripheral clock frequency of the UART in Hz
+  * @param  baud : requested baud rate
+  * @param  over8 : if over8 = 1, oversampling by 8 is used, otherwise oversampling by 16 is used
+  * @param  *brr : computed BRR value, written only if the baud rate can be generated
+  * @param  *actual_baud : baud rate actually generated with *brr, may be NULL
+  * @retval  baud rate error in units of 0.01%, 0xFFFFFFFF if the baud rate can not be generated at all
+ */
+uint32_t hal_uart_compute_brr(uint32_t pclk, uint32_t baud, uint32_t over8, uint32_t *brr, uint32_t *actual_baud)
+{
+	uint32_t div, actual, diff, frac_bits;
+	
+	if(baud == 0)
+		return 0xFFFFFFFF;
+	
+	/* Tx/Rx baud = pclk / (8 * (2 - OVER8) * USARTDIV), so USARTDIV in units of 1/16(OVER16) or 1/8(OVER8)
+	   is simply pclk / baud, rounded to nearest */
+	div = (pclk + (baud / 2)) / baud;
+	frac_bits = over8 ? 3 : 4;
+	
+	/* DIV_Mantissa must not be 0 */
+	if((div >> frac_bits) == 0 || (div >> frac_bits) > 0xFFF)
+		return 0xFFFFFFFF;
+	
+	actual = pclk / div;
+	diff = (actual > baud) ? (actual - baud) : (baud - actual);
+	
+	/* With OVER8, DIV_Fraction[2:0] is used and bit 3 must be kept cleared */
+	*brr = ((div >> frac_bits) << 4) | (div & ((1 << frac_bits) - 1));
+	
+	if(actual_baud)
+		*actual_baud = actual;
+	
+	return (uint32_t)(((uint64_t)diff * 10000) / baud);
+}
+
+
+
+
 /**
   * @brief  Initializes the Given UART peripherl
   * @param  *uart_handle : pointer to handle structure of UART peripheral
@@ -412,6 +862,18 @@ static void hal_uart_clear_error_flag(uart_handle_t *huart)
  */
 void hal_uart_init(uart_handle_t *uart_handle)
 {
+	/*Refuse a configuration the peripheral can not run */
+	if(hal_uart_check_config(uart_handle))
+	{
+		uart_handle->ErrorCode = HAL_UART_ERROR_CONFIG;
+		uart_handle->rx_state = HAL_UART_STATE_RESET;
+		uart_handle->tx_state = HAL_UART_STATE_RESET;
+		return;
+	}
+	
+	/*Frame format and oversampling must not be changed while the peripheral is enabled */
+	hal_uart_disable(uart_handle->Instance);
+	
 	/*Configure the word length */
 	hal_uart_configure_word_length(uart_handle->Instance, uart_handle->Init.WordLength);
 	
@@ -421,11 +883,25 @@ void hal_uart_init(uart_handle_t *uart_handle)
 	/*Configure the oversampling rate for receiver block */
 	hal_uart_configure_over_sampling(uart_handle->Instance, uart_handle->Init.OverSampling);
 	
-	/*Set the baud rate */
-	hal_uart_set_baud_rate(uart_handle->Instance, uart_handle->Init.BaudRate);
+	/*Configure multiprocessor communication */
+	hal_uart_configure_mute_mode(uart_handle->Instance, uart_handle->Init.MuteMode, uart_handle->Init.NodeAddress);
+	
+	/*Configure RTS/CTS flow control */
+	hal_uart_configure_hw_flow_control(uart_handle->Instance, uart_handle->Init.HwFlowCtl);
+	if(uart_handle->Init.HwFlowCtl & UART_HWCONTROL_SOFT_RTS)
+		hal_uart_drive_soft_rts(uart_handle, 1);
+	
+	/*Set the baud rate, refuse to run at a wrong speed */
+	if(hal_uart_set_baud_rate(uart_handle))
+	{
+		uart_handle->ErrorCode = HAL_UART_ERROR_BAUD;
+		uart_handle->rx_state = HAL_UART_STATE_RESET;
+		uart_handle->tx_state = HAL_UART_STATE_RESET;
+		return;
+	}
 	
 	/*Enable the transmit block of the UART peripheral */
-	hal_uart_enable_disable_rx(uart_handle->Instance, uart_handle->Init.Mode);
+	hal_uart_enable_disable_tx(uart_handle->Instance, uart_handle->Init.Mode);
 	
 	/*Enable the receive block of the UART peripheral */
 	hal_uart_enable_disable_rx(uart_handle->Instance, uart_handle->Init.Mode);
@@ -433,6 +909,16 @@ void hal_uart_init(uart_handle_t *uart_handle)
 	/*Enable the UART peripheral */
 	hal_uart_enable(uart_handle->Instance);
 	
+#if USART_ISR_CYCLE_COUNT_ENABLE
+	/*Start the DWT cycle counter used to measure ISR latency */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	
+	uart_handle->StatsWriters = 0;
+	uart_handle->Stats.Sequence = 0;
+	hal_uart_reset_stats(uart_handle);
+	
 	uart_handle->rx_state = HAL_UART_STATE_READY;
 	uart_handle->tx_state = HAL_UART_STATE_READY;
 	uart_handle->ErrorCode = HAL_UART_ERROR_NONE;
@@ -456,6 +942,7 @@ void hal_hal_uart_tx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
 	uart_handle->pTxBufferPtr = buffer;
 	uart_handle->TxXferCount = len;
 	uart_handle->TxXferSize = len;
+	uart_handle->TxIovCount = 0;
 	
 	/*This handle is busy in transmission*/
 	uart_handle->tx_state = HAL_UART_STATE_BUSY_TX;
@@ -479,14 +966,13 @@ void hal_hal_uart_tx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
  */
 void hal_hal_uart_rx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
 {
-	uint32_t val;
 	/* Populate the application given information into the UART handle structure */
 	uart_handle->pRxBufferPtr = buffer;
 	uart_handle->RxXferCount = len;
 	uart_handle->RxXferSize = len;
 	
-	/*This handle is busy in transmission*/
-	uart_handle->tx_state = HAL_UART_STATE_BUSY_RX;
+	/*This handle is busy in reception*/
+	uart_handle->rx_state = HAL_UART_STATE_BUSY_RX;
 	
 	/*Enable the UART Parity interrupt error */
 	hal_uart_configure_parity_error_interrup(uart_handle->Instance,1);
@@ -494,7 +980,7 @@ void hal_hal_uart_rx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
 	/*Enable the Error interrupt */
 	hal_uart_configure_error_interrup(uart_handle->Instance, 1);
   
-	val = uart_handle->Instance->DR;
+	(void)uart_handle->Instance->DR;
 	
 	/*Enable RXNE interrupt */
 	hal_uart_configure_rxne_interrup(uart_handle->Instance, 1);
@@ -505,116 +991,480 @@ void hal_hal_uart_rx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
 
 
 /**
-  * @brief This API handles the UART interrupt request
-  * @param *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module.
+  * @brief API to do UART data transmission using DMA, only one interrupt is raised per transfer
+  *        and tx_comp_cb is called once the last byte has left the shift register.
+  * @param *uart_handle: pointer to handle structure of UART peripheral, hdmatx must be initialized
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be transmitted
   * @retval none
  */
-void hal_uart_handle_interrupt(uart_handle_t *huart)
+void hal_uart_tx_dma(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
 {
-	uint32_t temp1 = 0, temp2 = 0;
-	/* Parity Error Check */
-	temp1 = (huart->Instance->SR & USART_REG_SR_PE_FLAG); // Check if Parity error occured
-	temp2 = (huart->Instance->CR1 & USART_REG_CR1_PEIE_INT_ENABLE); // Check if Parity error interrupt is enabled.
-	/* UART Parity error occured ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
-	{
-		/*Clear the erro Flag */
-		hal_uart_clear_error_flag(huart);
-		
-		huart->ErrorCode = HAL_UART_ERROR_PE;
-	}
+	/* Populate the application given information into the UART handle structure */
+	uart_handle->pTxBufferPtr = buffer;
+	uart_handle->TxXferCount = len;
+	uart_handle->TxXferSize = len;
+	uart_handle->TxIovCount = 0;
+	
+	/*This handle is busy in transmission*/
+	uart_handle->tx_state = HAL_UART_STATE_BUSY_TX;
 	
+	/*Link the DMA stream to this UART handle */
+	uart_handle->hdmatx->Parent = uart_handle;
+	uart_handle->hdmatx->xfer_cplt_cb = hal_uart_dma_tx_cplt;
+	uart_handle->hdmatx->xfer_half_cb = 0;
+	uart_handle->hdmatx->xfer_error_cb = hal_uart_dma_error;
 	
-	/*Frame Error Check */
-	temp1 = (huart->Instance->SR & USART_REG_SR_FE_FLAG); // Check if frame error occured
-	temp2 = (huart->Instance->CR3 & USART_REG_CR3_ERR_INT_ENABLE); // Check if error interrupt is enabled.
-	/* UART Frame  error occured ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
+	/*Enable the UART peripheral*/
+	hal_uart_enable(uart_handle->Instance);
+	
+	/*Clear the TC flag, it is cleared by writing 0 to it. SR bits are rc_w0, writing 1 to the others leaves them untouched */
+	uart_handle->Instance->SR = ~USART_REG_SR_TC_FLAG;
+	
+	/*Hand over the whole buffer to the DMA stream */
+	hal_dma_start_it(uart_handle->hdmatx, (uint32_t)buffer, (uint32_t)&uart_handle->Instance->DR, len);
+	
+	/*Enable the DMA transmit request */
+	uart_handle->Instance->CR3 |= USART_REG_CR3_DMAT;
+}
+
+
+
+
+/**
+  * @brief API to transmit a frame made of several segments without copying them into one buffer.
+  *        Segments are walked from the TXE interrupt, or from the DMA completion if hdmatx is set,
+  *        tx_comp_cb is called once after the last segment. iov and the segments must stay valid until then.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *iov: array of segments
+	* @param iovcnt: number of segments in iov
+  * @retval none
+ */
+void hal_uart_tx_sg(uart_handle_t *uart_handle, const uart_iovec_t *iov, uint32_t iovcnt)
+{
+	uint32_t i, total = 0;
+	
+	for(i = 0; i < iovcnt; i++)
+		total += iov[i].len;
+	
+	uart_handle->TxXferSize = total;
+	uart_handle->pTxIov = iov;
+	uart_handle->TxIovCount = iovcnt;
+	
+	/*Nothing to send */
+	if(!hal_uart_next_tx_segment(uart_handle))
+		return;
+	
+	/*This handle is busy in transmission*/
+	uart_handle->tx_state = HAL_UART_STATE_BUSY_TX;
+	
+	/*Enable the UART peripheral*/
+	hal_uart_enable(uart_handle->Instance);
+	
+	if(uart_handle->hdmatx)
 	{
-		/*Clear the error Flag */		
-		hal_uart_clear_error_flag(huart);
+		/*Link the DMA stream to this UART handle */
+		uart_handle->hdmatx->Parent = uart_handle;
+		uart_handle->hdmatx->xfer_cplt_cb = hal_uart_dma_tx_cplt;
+		uart_handle->hdmatx->xfer_half_cb = 0;
+		uart_handle->hdmatx->xfer_error_cb = hal_uart_dma_error;
 		
-		huart->ErrorCode = HAL_UART_ERROR_FE;
+		/*Clear the TC flag, it is cleared by writing 0 to it. SR bits are rc_w0, writing 1 to the others leaves them untouched */
+		uart_handle->Instance->SR = ~USART_REG_SR_TC_FLAG;
 		
+		hal_dma_start_it(uart_handle->hdmatx, (uint32_t)uart_handle->pTxBufferPtr, (uint32_t)&uart_handle->Instance->DR, uart_handle->TxXferCount);
+		
+		/*Enable the DMA transmit request */
+		uart_handle->Instance->CR3 |= USART_REG_CR3_DMAT;
+	}
+	else
+	{
+		/* Enable the TXE interrupt */
+		hal_uart_configure_txe_interrup(uart_handle->Instance, 1);
 	}
+}
+
+
+
+/**
+  * @brief API to start continuous UART data reception into a circular buffer using DMA.
+  *        rx_event_cb is called with the newly received bytes on DMA half/full transfer and
+  *        whenever the RX line goes idle, so variable length frames are delivered without per byte interrupts.
+  * @param *uart_handle: pointer to handle structure of UART peripheral, hdmarx must be initialized
+  * @param *buffer: hold the pointer to circular rx buffer
+	* @param len: size of the circular rx buffer
+  * @retval none
+ */
+void hal_uart_rx_dma_circular(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len)
+{
+	uint32_t val;
+	
+	/* Populate the application given information into the UART handle structure */
+	uart_handle->pRxBufferPtr = buffer;
+	uart_handle->RxXferCount = len;
+	uart_handle->RxXferSize = len;
+	uart_handle->RxReadPos = 0;
+	
+	/*This handle is busy in reception*/
+	uart_handle->rx_state = HAL_UART_STATE_BUSY_RX;
+	
+	/*Stream has to run in circular mode so that it never stops */
+	uart_handle->hdmarx->Init.Mode = DMA_MODE_CIRCULAR;
+	hal_dma_init(uart_handle->hdmarx);
+	
+	/*Link the DMA stream to this UART handle */
+	uart_handle->hdmarx->Parent = uart_handle;
+	uart_handle->hdmarx->xfer_cplt_cb = hal_uart_dma_rx_event;
+	uart_handle->hdmarx->xfer_half_cb = hal_uart_dma_rx_event;
+	uart_handle->hdmarx->xfer_error_cb = hal_uart_dma_error;
+	
+	/*Flush the data register and pending IDLE flag */
+	val = uart_handle->Instance->SR;
+	val = uart_handle->Instance->DR;
+	(void)val;
+	
+	hal_dma_start_it(uart_handle->hdmarx, (uint32_t)&uart_handle->Instance->DR, (uint32_t)buffer, len);
+	
+	/*Enable the Error interrupt */
+	hal_uart_configure_error_interrup(uart_handle->Instance, 1);
+	
+	/*Enable IDLE line interrupt and DMA receive request */
+	uart_handle->Instance->CR1 |= USART_REG_CR1_IDLE_INT_ENABLE;
+	uart_handle->Instance->CR3 |= USART_REG_CR3_DMAR;
+}
+
+
+
+/**
+  * @brief API to stop the continuous UART data reception
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_rx_dma_stop(uart_handle_t *uart_handle)
+{
+	uart_handle->Instance->CR1 &= ~USART_REG_CR1_IDLE_INT_ENABLE;
+	uart_handle->Instance->CR3 &= ~USART_REG_CR3_DMAR;
 	
+	hal_uart_configure_error_interrup(uart_handle->Instance, 0);
 	
-	/* Overrun  error check */
-	temp1 = (huart->Instance->SR & USART_REG_SR_ORE_FLAG); // Check if overun error occured
-	temp2 = (huart->Instance->CR3 & USART_REG_CR3_ERR_INT_ENABLE); // Check if error interrupt is enabled.
-	/* UART overrun  error occured ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
+	hal_dma_abort(uart_handle->hdmarx);
+	
+	uart_handle->rx_state = HAL_UART_STATE_READY;
+}
+
+
+
+
+/**
+  * @brief API to start streaming mode, data is exchanged with the ISR through single producer/single consumer
+  *        ring buffers, so hal_uart_write can be called again while earlier data is still being transmitted.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *tx_ring: initialized ring buffer for transmission, NULL if not used
+  * @param *rx_ring: initialized ring buffer for reception, NULL if not used or if framer is used
+  * @retval none
+ */
+void hal_uart_stream_start(uart_handle_t *uart_handle, ring_buffer_t *tx_ring, ring_buffer_t *rx_ring)
+{
+	uint32_t val;
+	
+	uart_handle->tx_ring = tx_ring;
+	uart_handle->rx_ring = rx_ring;
+	
+	/*Enable the UART peripheral*/
+	hal_uart_enable(uart_handle->Instance);
+	
+	if(rx_ring || uart_handle->framer)
 	{
-		/*Clear the error Flag */		
-		hal_uart_clear_error_flag(huart);
+		/*Enable the Error interrupt */
+		hal_uart_configure_error_interrup(uart_handle->Instance, 1);
 		
-		huart->ErrorCode = HAL_UART_ERROR_ORE;
+		val = uart_handle->Instance->DR;
+		(void)val;
 		
+		/*Receiver is always armed in streaming mode */
+		hal_uart_configure_rxne_interrup(uart_handle->Instance, 1);
 	}
+}
 
-  
-  /* Noise Error Check */
-  temp1 = (huart->Instance->SR & USART_REG_SR_NE_FLAG); // Check if noise error occured
-	temp2 = (huart->Instance->CR3 & USART_REG_CR3_ERR_INT_ENABLE); // Check if error interrupt is enabled.
-	/* UART noise  error occured ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
-	{
-		/*Clear the error Flag */		
-		hal_uart_clear_error_flag(huart);
-		
-		huart->ErrorCode = HAL_UART_ERROR_NE;
-		
-	}	
+
+
+/**
+  * @brief API to queue data for transmission in streaming mode, never blocks
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *data: data to be transmitted
+	* @param len: length of the data
+  * @retval number of bytes queued, less than len if tx ring buffer is full
+ */
+uint32_t hal_uart_write(uart_handle_t *uart_handle, const uint8_t *data, uint32_t len)
+{
+	uint32_t n;
 	
+	n = ring_buffer_write(uart_handle->tx_ring, data, len);
 	
-	/* Check For RXNE Flag */
-	 temp1 = (huart->Instance->SR & USART_REG_SR_RXNE_FLAG); // Check if RXNE Flag set
-	temp2 = (huart->Instance->CR3 & USART_REG_CR1_RXNE_INT_ENABLE); // Check if RXNE interrupt is enabled.
-	/* UART is in Receiver Mode ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
-	{
+	/* Arm TXE through bit-band alias, a read-modify-write of CR1 here could undo a CR1 update done by the ISR */
+	if(n)
+		USART_REG_BITBAND(uart_handle->Instance->CR1, USART_REG_CR1_TXE_INT_ENABLE_POS) = 1;
+	
+	return n;
+}
 
-		hal_uart_handle_RXNE_interrupt(huart);
-		
-	}	
+
+
+/**
+  * @brief API to fetch received data in streaming mode, never blocks
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *data: destination buffer
+	* @param len: size of destination buffer
+  * @retval number of bytes copied
+ */
+uint32_t hal_uart_read(uart_handle_t *uart_handle, uint8_t *data, uint32_t len)
+{
+	uint32_t n;
 	
+	n = ring_buffer_read(uart_handle->rx_ring, data, len);
 	
+	/* Let the sender continue once the ring buffer is drained enough. If the ISR deasserts RTS in between,
+	   it does so again on the next received byte */
+	if((uart_handle->Init.HwFlowCtl & UART_HWCONTROL_SOFT_RTS) && (hal_uart_rx_level(uart_handle) <= uart_handle->RxLowWatermark))
+		hal_uart_drive_soft_rts(uart_handle, 1);
 	
-	/* Check For TXE Flag */
-	temp1 = (huart->Instance->SR & USART_REG_SR_TXE_FLAG); // Check if TXE Flag set
-	temp2 = (huart->Instance->CR3 & USART_REG_CR1_TXE_INT_ENABLE); // Check if TXE interrupt is enabled.
-	/* UART is in transmitter Mode ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
+	return n;
+}
+
+
+
+/**
+  * @brief API to release the packet returned by uart_framer_peek in streaming mode,
+  *        use it instead of uart_framer_release so that software RTS is asserted again
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_release_packet(uart_handle_t *uart_handle)
+{
+	uart_framer_release(uart_handle->framer);
+	
+	if((uart_handle->Init.HwFlowCtl & UART_HWCONTROL_SOFT_RTS) && (hal_uart_rx_level(uart_handle) <= uart_handle->RxLowWatermark))
+		hal_uart_drive_soft_rts(uart_handle, 1);
+}
+
+
+
+
+/**
+  * @brief API to put the receiver in mute mode, no RXNE interrupt is raised until the configured wakeup event
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_enter_mute_mode(uart_handle_t *uart_handle)
+{
+	uart_handle->Instance->CR1 |= USART_REG_CR1_RWU;
+}
+
+
+
+/**
+  * @brief API to take the receiver out of mute mode
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_exit_mute_mode(uart_handle_t *uart_handle)
+{
+	uart_handle->Instance->CR1 &= ~USART_REG_CR1_RWU;
+}
+
+
+
+/**
+  * @brief API to send an address character(MSB set) which wakes up the addressed node on a multidrop bus.
+  *        Waits for TXE, the data that follows is sent with the normal transmit APIs.
+  *        In 8 bit mode the data bytes must keep bit 7 cleared.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param address: 4 bit address of the node
+  * @retval none
+ */
+void hal_uart_send_address(uart_handle_t *uart_handle, uint8_t address)
+{
+	hal_uart_enable(uart_handle->Instance);
+	
+	while(!(uart_handle->Instance->SR & USART_REG_SR_TXE_FLAG));
+	
+	uart_handle->Instance->DR = (hal_uart_address_mark(uart_handle) | (address & USART_REG_CR2_ADD_MASK));
+}
+
+
+
+/**
+  * @brief API to read a consistent copy of the UART statistics without disabling interrupts
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *stats: destination of the copy
+  * @retval none
+ */
+void hal_uart_get_stats(uart_handle_t *uart_handle, uart_stats_t *stats)
+{
+	uint32_t seq;
+	
+	/* Retry if the ISR updated the counters while they were being copied */
+	do
 	{
+		seq = uart_handle->Stats.Sequence;
+		__DMB();
+		*stats = uart_handle->Stats;
+		__DMB();
+	} while((seq & 1) || (seq != uart_handle->Stats.Sequence));
+}
 
-		hal_uart_handle_TXE_interrupt(huart);
+
+
+/**
+  * @brief API to reset all UART statistics counters
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_reset_stats(uart_handle_t *uart_handle)
+{
+	uart_stats_t *stats = &uart_handle->Stats;
+	uint32_t primask;
+	
+	/* Counters are written from the UART and DMA interrupts, mask them so that no increment is lost or torn */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	stats->BytesTx = 0;
+	stats->BytesRx = 0;
+	stats->RxDropped = 0;
+	stats->ErrorPE = 0;
+	stats->ErrorFE = 0;
+	stats->ErrorORE = 0;
+	stats->ErrorNE = 0;
+	stats->ErrorDMA = 0;
+	stats->IsrCount = 0;
+	stats->IsrCyclesLast = 0;
+	stats->IsrCyclesMax = 0;
+	
+	/* Sequence stays even, a reader which copied the old counters retries */
+	__DMB();
+	stats->Sequence += 2;
+	
+	__set_PRIMASK(primask);
+}
+
+
+
+/**
+  * @brief This API handles the UART interrupt request
+  *        SR, CR1 and CR3 are read only once, the pending and enabled events are then dispatched from that snapshot.
+  * @param *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module.
+  * @retval none
+ */
+void hal_uart_handle_interrupt(uart_handle_t *huart)
+{
+	uint32_t sr, cr1, cr3, enabled, pending;
+#if USART_ISR_CYCLE_COUNT_ENABLE
+	uint32_t start = DWT->CYCCNT, cycles;
+#endif
+	
+	hal_uart_stats_begin(huart);
+	huart->Stats.IsrCount++;
+	
+	/* Snapshot the registers, this SR read is also the first half of the IDLE/error flag clear sequence */
+	sr  = huart->Instance->SR;
+	cr1 = huart->Instance->CR1;
+	cr3 = huart->Instance->CR3;
+	
+	/* TXE, TC, RXNE and IDLE flags sit at the same bit position as their enable bits in CR1 */
+	enabled = cr1 & (USART_REG_CR1_TXE_INT_ENABLE | USART_REG_CR1_TCIE_INT_ENABLE | USART_REG_CR1_RXNE_INT_ENABLE | USART_REG_CR1_IDLE_INT_ENABLE);
+	
+	if(cr1 & USART_REG_CR1_PEIE_INT_ENABLE)
+		enabled |= USART_REG_SR_PE_FLAG;
+	
+	if(cr3 & USART_REG_CR3_ERR_INT_ENABLE)
+		enabled |= (USART_REG_SR_FE_FLAG | USART_REG_SR_ORE_FLAG | USART_REG_SR_NE_FLAG);
+	
+	/* Overrun also raises an interrupt when RXNEIE is set */
+	if(cr1 & USART_REG_CR1_RXNE_INT_ENABLE)
+		enabled |= USART_REG_SR_ORE_FLAG;
+	
+	pending = sr & enabled;
+	
+	/* UART errors ------------------------------------------------------------------------------------------------- */
+	if(pending & (USART_REG_SR_PE_FLAG | USART_REG_SR_FE_FLAG | USART_REG_SR_ORE_FLAG | USART_REG_SR_NE_FLAG))
+	{
+		if(pending & USART_REG_SR_PE_FLAG)
+		{
+			huart->ErrorCode |= HAL_UART_ERROR_PE;
+			huart->Stats.ErrorPE++;
+		}
+		if(pending & USART_REG_SR_FE_FLAG)
+		{
+			huart->ErrorCode |= HAL_UART_ERROR_FE;
+			huart->Stats.ErrorFE++;
+		}
+		if(pending & USART_REG_SR_ORE_FLAG)
+		{
+			huart->ErrorCode |= HAL_UART_ERROR_ORE;
+			huart->Stats.ErrorORE++;
+		}
+		if(pending & USART_REG_SR_NE_FLAG)
+		{
+			huart->ErrorCode |= HAL_UART_ERROR_NE;
+			huart->Stats.ErrorNE++;
+		}
 		
+		/* The DR read of the RXNE handler completes the clear sequence, otherwise do it here. With DMAR set the stream
+		   reads DR only while RXNE is set, once RXNE is clear it has already taken the byte and nothing else reads DR,
+		   so SR is checked again and DR is left to the stream only while it still holds a byte */
+		if(!(pending & USART_REG_SR_RXNE_FLAG) &&
+		   (!(cr3 & USART_REG_CR3_DMAR) || !(huart->Instance->SR & USART_REG_SR_RXNE_FLAG)))
+			hal_uart_clear_error_flag(huart);
 	}
 	
+	/* UART is in Receiver Mode ------------------------------------------------------------------------------------ */
+	if(pending & USART_REG_SR_RXNE_FLAG)
+	{
+		hal_uart_handle_RXNE_interrupt(huart);
+	}
 	
+	/* UART RX line is idle ---------------------------------------------------------------------------------------- */
+	if(pending & USART_REG_SR_IDLE_FLAG)
+	{
+		hal_uart_handle_IDLE_interrupt(huart);
+	}
 	
-	/* Check For TC Flag */
-	temp1 = (huart->Instance->SR & USART_REG_SR_TC_FLAG); // Check if TC Flag set
-	temp2 = (huart->Instance->CR3 & USART_REG_CR1_TCIE_INT_ENABLE); // Check if TCIE interrupt is enabled.
-	/* UART Trasnmit Complete ------------------------------------------------------------------------------ */
-	if(temp1 && temp2 )
+	/* UART is in transmitter Mode --------------------------------------------------------------------------------- */
+	if(pending & USART_REG_SR_TXE_FLAG)
+	{
+		hal_uart_handle_TXE_interrupt(huart);
+	}
+	
+	/* UART Trasnmit Complete -------------------------------------------------------------------------------------- */
+	if(pending & USART_REG_SR_TC_FLAG)
 	{
-
 		hal_uart_handle_TC_interrupt(huart);
-		
 	}
 	
+#if USART_ISR_CYCLE_COUNT_ENABLE
+	cycles = DWT->CYCCNT - start;
+	huart->Stats.IsrCyclesLast = cycles;
+	if(cycles > huart->Stats.IsrCyclesMax)
+		huart->Stats.IsrCyclesMax = cycles;
+#endif
+	
+	hal_uart_stats_end(huart);
 	
 	/* If there is a  Error */
 	if(huart->ErrorCode != HAL_UART_ERROR_NONE)
 	{
-		/* Set the UART state ready*/
-		huart->rx_state = HAL_UART_STATE_READY;
-		huart->tx_state = HAL_UART_STATE_READY;
+		/* PE/FE/NE/ORE are receiver errors, an ongoing transmission is left running.
+		   Interrupt reception is aborted, circular DMA reception keeps running and the error is only reported */
+		if((huart->rx_state == HAL_UART_STATE_BUSY_RX) && !(cr3 & USART_REG_CR3_DMAR))
+		{
+			huart->Instance->CR1 &= ~(USART_REG_CR1_RXNE_INT_ENABLE | USART_REG_CR1_PEIE_INT_ENABLE);
+			huart->Instance->CR3 &= ~USART_REG_CR3_ERR_INT_ENABLE;
+			huart->rx_state = HAL_UART_STATE_READY;
+		}
 		
 		/*Call the error handler */
 		hal_uart_error_cb(huart);
 	}
 
 }
-
@@ -9,6 +9,9 @@
 
 /*MCU specific header file for stm32f407vgt6 base discovery board */
 #include "stm32f407xx.h"
+#include "hal_dma_driver.h"
+#include "ring_buffer.h"
+#include "uart_framing.h"
 #include <stdint.h>
 
 /**
@@ -35,6 +38,8 @@ typedef enum
 #define HAL_UART_ERROR_FE               ((uint32_t) 0x00000004)     // Frame error
 #define HAL_UART_ERROR_ORE              ((uint32_t) 0x00000008)     // Overrun error
 #define HAL_UART_ERROR_DMA              ((uint32_t) 0x00000010)     // DMA transfer error
+#define HAL_UART_ERROR_BAUD             ((uint32_t) 0x00000020)     // Baud rate can not be generated within tolerance
+#define HAL_UART_ERROR_CONFIG           ((uint32_t) 0x00000040)     // Init parameters not supported by this peripheral
 
 
 /***********************************USART and UART Peripheral Base addresses****************************************************/
@@ -78,6 +83,9 @@ typedef enum
 #define USART_REG_BRR_MANTISSA                                          ((uint32_t) 1 << 4)
 #define USART_REG_BRR_FRACTION                                          ((uint32_t) 1 << 0)
 
+/* Maximum baud rate error accepted by hal_uart_init, in units of 0.01% */
+#define USART_BAUD_ERROR_TOLERANCE                                      ((uint32_t) 200)
+
 /***********************************Bit Definition for USART_CR1 Register********************************************************/
 
 /* Oversampling mode */
@@ -88,6 +96,9 @@ typedef enum
 /*USART enable*/
 #define USART_REG_CR1_USART_EN                                         ((uint32_t) 1 << 13)  
 
+/* Wakeup method */
+#define USART_REG_CR1_WAKE                                             ((uint32_t) 1 << 11)
+
 /* Word length */
 #define USART_REG_CR1_USART_WL                                         ((uint32_t) 1 << 12)
 #define USART_WL_1S8B                                                  0
@@ -98,18 +109,37 @@ typedef enum
 #define USART_REG_CR1_TXE_INT_ENABLE                                   ((uint32_t) 1 << 7)
 #define USART_REG_CR1_TCIE_INT_ENABLE                                  ((uint32_t) 1 << 6)
 #define USART_REG_CR1_RXNE_INT_ENABLE                                  ((uint32_t) 1 << 5)
+#define USART_REG_CR1_IDLE_INT_ENABLE                                  ((uint32_t) 1 << 4)
+
+/* Bit position of TXEIE, used for atomic bit-band access */
+#define USART_REG_CR1_TXE_INT_ENABLE_POS                               7
 
 /* Transmitter and Receiver enable */
 #define USART_REG_CR1_TE                                               ((uint32_t) 1 << 3)
 #define USART_REG_CR1_RE                                               ((uint32_t) 1 << 2)
 
+/* Receiver wakeup (mute mode) */
+#define USART_REG_CR1_RWU                                              ((uint32_t) 1 << 1)
+
 /***********************************Bit Definition for USART_CR3 Register********************************************************/
 
+/* CTS interrupt enable, CTS enable and RTS enable (not available on UART4/UART5) */
+#define USART_REG_CR3_CTSIE                                            ((uint32_t) 1 << 10)
+#define USART_REG_CR3_CTSE                                             ((uint32_t) 1 << 9)
+#define USART_REG_CR3_RTSE                                             ((uint32_t) 1 << 8)
+
+/* DMA enable transmitter and receiver */
+#define USART_REG_CR3_DMAT                                             ((uint32_t) 1 << 7)
+#define USART_REG_CR3_DMAR                                             ((uint32_t) 1 << 6)
+
 /* Error interrupt enable */
 #define USART_REG_CR3_ERR_INT_ENABLE                                   ((uint32_t) 1 << 0)
 
 /***********************************Bit Definition for USART_CR2 Register********************************************************/
 
+/* Address of the USART node */
+#define USART_REG_CR2_ADD_MASK                                        ((uint32_t) 0x0F)
+
 #define USART_REG_CR2_STOP_BITS                                       ((uint32_t) 12)
 #define UART_STOPBIT_1                                                ((uint32_t) 0x00)
 #define UART_STOPBIT_HALF                                             ((uint32_t) 0x01)
@@ -117,15 +147,48 @@ typedef enum
 #define UART_STOPBIT_ONEHALF                                          ((uint32_t) 0x03)
 
 /********************************************************************************************************************************/
+/* The MSB of the word marks an address character, bit 8 in 9 bit mode and bit 7 in 8 bit mode */
+#define USART_DR_ADDRESS_MARK                                         ((uint32_t) 1 << 8)
+#define USART_DR_ADDRESS_MARK_8B                                      ((uint32_t) 1 << 7)
+
+/* Multiprocessor communication */
+#define UART_MUTE_MODE_DISABLE                                        ((uint32_t) 0x00)
+#define UART_WAKEUP_IDLE_LINE                                         ((uint32_t) 0x01)
+#define UART_WAKEUP_ADDRESS_MARK                                      ((uint32_t) 0x02)
+
 #define UART_PARITY_NONE                                              ((uint32_t) 0x00000000)
 #define UART_HWCONTROL_NONE                                           ((uint32_t) 0x00000000)
+#define UART_HWCONTROL_RTS                                            ((uint32_t) USART_REG_CR3_RTSE)
+#define UART_HWCONTROL_CTS                                            ((uint32_t) USART_REG_CR3_CTSE)
+#define UART_HWCONTROL_RTS_CTS                                        ((uint32_t) (USART_REG_CR3_RTSE | USART_REG_CR3_CTSE))
+/* RTS is a GPIO driven by the driver from the rx ring buffer watermarks, can be combined with UART_HWCONTROL_CTS.
+   It is the only flow control available on UART4/UART5 */
+#define UART_HWCONTROL_SOFT_RTS                                       ((uint32_t) 0x80000000)
 
 #define UART_MODE_TX_RX                                               ((uint32_t) (USART_REG_CR1_TE | USART_REG_CR1_RE))
 #define UART_MODE_TX                                                  ((uint32_t) USART_REG_CR1_TE )
 
+#define USART_BAUD_RATE_2400                                          ((uint32_t) 2400)
 #define USART_BAUD_RATE_9600                                          ((uint32_t) 9600)
+#define USART_BAUD_RATE_19200                                         ((uint32_t) 19200)
+#define USART_BAUD_RATE_38400                                         ((uint32_t) 38400)
+#define USART_BAUD_RATE_57600                                         ((uint32_t) 57600)
 #define USART_BAUD_RATE_115200                                        ((uint32_t) 115200)
+#define USART_BAUD_RATE_230400                                        ((uint32_t) 230400)
+#define USART_BAUD_RATE_460800                                        ((uint32_t) 460800)
+#define USART_BAUD_RATE_921600                                        ((uint32_t) 921600)
+#define USART_BAUD_RATE_1000000                                       ((uint32_t) 1000000)
 #define USART_BAUD_RATE_2000000                                       ((uint32_t) 2000000)
+#define USART_BAUD_RATE_4000000                                       ((uint32_t) 4000000)
+
+/* Set to 1 to measure the cycles spent in hal_uart_handle_interrupt with the DWT cycle counter */
+#ifndef USART_ISR_CYCLE_COUNT_ENABLE
+#define USART_ISR_CYCLE_COUNT_ENABLE                                    0
+#endif
+
+
+/* Bit-band alias of a single peripheral register bit, a write to it is atomic w.r.t. interrupts */
+#define USART_REG_BITBAND(reg, bit)                                   (*(volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)&(reg) - PERIPH_BASE) * 32) + ((bit) * 4)))
 
 
 /*********************************************************************************************************************************/
@@ -145,13 +208,48 @@ typedef enum
 	uint32_t Parity;          /* Specifies parity mode */
 	uint32_t Mode;            /* Specifies whether recive/transmit mode is enabled or disabled */
 	uint32_t OverSampling;    /* Specifies whether oversampling8 is enabled or disabled*/
+	uint32_t HwFlowCtl;       /* Specifies whether RTS/CTS hardware flow control is enabled or disabled */
+	uint32_t MuteMode;        /* Specifies the mute mode wakeup method used on a multidrop bus */
+	uint32_t NodeAddress;     /* Specifies the 4 bit address of this node for address mark wakeup */
 } uart_init_t ;
 
 
 
+/**
+  *@brief UART transmit segment, used by scatter-gather transmission
+  */
+typedef struct
+{
+	const uint8_t          *base;            /* Start of the segment */
+	uint16_t               len;              /* Length of the segment */
+} uart_iovec_t;
+
+
 /*Application callback typedef */
 typedef void(TX_COMP_CB_t) (void *ptr);
 typedef void(RX_COMP_CB_t) (void *ptr);
+typedef void(RX_EVENT_CB_t) (uint8_t *data, uint32_t len);
+typedef void(ERROR_CB_t) (void *ptr);
+
+
+/**
+  *@brief UART statistics structure definition, use hal_uart_get_stats to read a consistent copy
+  */
+typedef struct
+{
+	volatile uint32_t      Sequence;         /* Odd while the driver is updating the counters */
+	uint32_t               BytesTx;          /* Number of bytes transmitted */
+	uint32_t               BytesRx;          /* Number of bytes received */
+	uint32_t               RxDropped;        /* Bytes dropped because the streaming rx ring buffer was full */
+	uint32_t               ErrorPE;          /* Number of parity errors */
+	uint32_t               ErrorFE;          /* Number of frame errors */
+	uint32_t               ErrorORE;         /* Number of overrun errors */
+	uint32_t               ErrorNE;          /* Number of noise errors */
+	uint32_t               ErrorDMA;         /* Number of DMA transfer errors */
+	uint32_t               IsrCount;         /* Number of hal_uart_handle_interrupt calls */
+	uint32_t               IsrCyclesLast;    /* Cycles spent in the last ISR, needs USART_ISR_CYCLE_COUNT_ENABLE */
+	uint32_t               IsrCyclesMax;     /* Worst case cycles spent in the ISR, needs USART_ISR_CYCLE_COUNT_ENABLE */
+} uart_stats_t;
 
 
 /**
@@ -164,14 +262,33 @@ typedef struct
 	uint8_t                *pTxBufferPtr;    /* Pointer to UART Tx Transmit buffer */
 	uint16_t               TxXferSize;       /* UART Tx Transfer Size */
 	uint16_t               TxXferCount;      /* UART Tx Transfer Count */
+	const uart_iovec_t     *pTxIov;          /* Scatter-gather: next segment to be transmitted */
+	uint16_t               TxIovCount;       /* Scatter-gather: number of segments left after the current one */
   uint8_t                *pRxBufferPtr;    /* Pointer to UART Rx Transmit buffer */
 	uint16_t               RxXferSize;       /* UART Rx Transfer Size */
 	uint16_t               RxXferCount;      /* UART Rx Transfer Count */
 	hal_uart_state_t       rx_state;         /* UART Communication state */
 	hal_uart_state_t       tx_state;         /* UART Communication state */   
 	uint32_t               ErrorCode;        /* UART Error code */
+	uint32_t               ActualBaudRate;   /* Baud rate actually generated from the peripheral clock */
+	uint32_t               BaudError;        /* Deviation of ActualBaudRate from Init.BaudRate, in units of 0.01% */
 	TX_COMP_CB_t           *tx_comp_cb;      /* Application call back when tx is completed */
 	RX_COMP_CB_t           *rx_comp_cb;      /* Application call back when rx is completed */
+	dma_handle_t           *hdmatx;          /* DMA stream(and channel) used for transmission, NULL if not used */
+	dma_handle_t           *hdmarx;          /* DMA stream(and channel) used for reception, NULL if not used */
+	uint16_t               RxReadPos;        /* Circular reception: position upto which data is handed to application */
+	RX_EVENT_CB_t          *rx_event_cb;     /* Circular reception: application call back when new bytes are available */
+	ring_buffer_t          *tx_ring;         /* Streaming: ring buffer drained by the TXE interrupt, NULL if not used */
+	ring_buffer_t          *rx_ring;         /* Streaming: ring buffer filled by the RXNE interrupt, NULL if not used */
+	uart_framer_t          *framer;          /* COBS/SLIP decoder fed from the receive path, set before reception is started */
+	GPIO_TypeDef           *RtsPort;         /* UART_HWCONTROL_SOFT_RTS: GPIO port of RTS pin, configured as output by application */
+	uint16_t               RtsPin;           /* UART_HWCONTROL_SOFT_RTS: GPIO pin number of RTS pin */
+	uint16_t               RxHighWatermark;  /* UART_HWCONTROL_SOFT_RTS: RTS is deasserted when rx_ring holds this many bytes,
+	                                            or the framer this many packets */
+	uint16_t               RxLowWatermark;   /* UART_HWCONTROL_SOFT_RTS: RTS is asserted again when rx_ring or the framer drops to this level */
+	ERROR_CB_t             *error_cb;        /* Application call back on UART error, driver halts on error if NULL */
+	uart_stats_t           Stats;            /* Error and throughput statistics */
+	uint8_t                StatsWriters;     /* Interrupt handlers currently updating Stats, Sequence is odd while non zero */
 } uart_handle_t;
 	
 
@@ -185,8 +302,24 @@ typedef struct
 /*                                                                                                                               */
 /*********************************************************************************************************************************/
 
+/**
+  * @brief  Computes the BRR register value for the given peripheral clock and baud rate
+  * @param  pclk : peripheral clock frequency of the UART in Hz
+  * @param  baud : requested baud rate
+  * @param  over8 : if over8 = 1, oversampling by 8 is used, otherwise oversampling by 16 is used
+  * @param  *brr : computed BRR value, written only if the baud rate can be generated
+  * @param  *actual_baud : baud rate actually generated with *brr, may be NULL
+  * @retval  baud rate error in units of 0.01%, 0xFFFFFFFF if the baud rate can not be generated at all
+ */
+uint32_t hal_uart_compute_brr(uint32_t pclk, uint32_t baud, uint32_t over8, uint32_t *brr, uint32_t *actual_baud);
+
+
 /**
   * @brief  Initializes the Given UART peripherl
+  *         Baud rate is generated from the live APB clock, if the error is above USART_BAUD_ERROR_TOLERANCE
+  *         ErrorCode is set to HAL_UART_ERROR_BAUD and the peripheral is left disabled.
+  *         Parameters the peripheral does not support (RTS/CTS on UART4/UART5, word length other than 8 or 9 bits,
+  *         address mark wakeup with parity) set ErrorCode to HAL_UART_ERROR_CONFIG.
   * @param  *uart_handle : pointer to handle structure of UART peripheral
   * @retval  none
  */
@@ -214,8 +347,149 @@ void hal_hal_uart_rx(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len);
 
 
 
+/**
+  * @brief API to do UART data transmission using DMA, only one interrupt is raised per transfer
+  *        and tx_comp_cb is called once the last byte has left the shift register.
+  * @param *uart_handle: pointer to handle structure of UART peripheral, hdmatx must be initialized
+  * @param *buffer: hold the pointer to tx buffer
+	* @param len: length of the data to be transmitted
+  * @retval none
+ */
+void hal_uart_tx_dma(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len);
+
+
+
+/**
+  * @brief API to transmit a frame made of several segments without copying them into one buffer.
+  *        Segments are walked from the TXE interrupt, or from the DMA completion if hdmatx is set,
+  *        tx_comp_cb is called once after the last segment. iov and the segments must stay valid until then.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *iov: array of segments
+	* @param iovcnt: number of segments in iov
+  * @retval none
+ */
+void hal_uart_tx_sg(uart_handle_t *uart_handle, const uart_iovec_t *iov, uint32_t iovcnt);
+
+
+
+/**
+  * @brief API to start continuous UART data reception into a circular buffer using DMA.
+  *        rx_event_cb is called with the newly received bytes on DMA half/full transfer and
+  *        whenever the RX line goes idle, so variable length frames are delivered without per byte interrupts.
+  * @param *uart_handle: pointer to handle structure of UART peripheral, hdmarx must be initialized
+  * @param *buffer: hold the pointer to circular rx buffer
+	* @param len: size of the circular rx buffer
+  * @retval none
+ */
+void hal_uart_rx_dma_circular(uart_handle_t *uart_handle, uint8_t *buffer, uint32_t len);
+
+
+
+/**
+  * @brief API to stop the continuous UART data reception
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_rx_dma_stop(uart_handle_t *uart_handle);
+
+
+
+/**
+  * @brief API to start streaming mode, data is exchanged with the ISR through single producer/single consumer
+  *        ring buffers, so hal_uart_write can be called again while earlier data is still being transmitted.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *tx_ring: initialized ring buffer for transmission, NULL if not used
+  * @param *rx_ring: initialized ring buffer for reception, NULL if not used or if framer is used
+  * @retval none
+ */
+void hal_uart_stream_start(uart_handle_t *uart_handle, ring_buffer_t *tx_ring, ring_buffer_t *rx_ring);
+
+
+
+/**
+  * @brief API to queue data for transmission in streaming mode, never blocks
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *data: data to be transmitted
+	* @param len: length of the data
+  * @retval number of bytes queued, less than len if tx ring buffer is full
+ */
+uint32_t hal_uart_write(uart_handle_t *uart_handle, const uint8_t *data, uint32_t len);
+
+
+
+/**
+  * @brief API to fetch received data in streaming mode, never blocks
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *data: destination buffer
+	* @param len: size of destination buffer
+  * @retval number of bytes copied
+ */
+uint32_t hal_uart_read(uart_handle_t *uart_handle, uint8_t *data, uint32_t len);
+
+
+
+/**
+  * @brief API to release the packet returned by uart_framer_peek in streaming mode,
+  *        use it instead of uart_framer_release so that software RTS is asserted again
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_release_packet(uart_handle_t *uart_handle);
+
+
+
+/**
+  * @brief API to put the receiver in mute mode, no RXNE interrupt is raised until the configured wakeup event
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_enter_mute_mode(uart_handle_t *uart_handle);
+
+
+
+/**
+  * @brief API to take the receiver out of mute mode
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_exit_mute_mode(uart_handle_t *uart_handle);
+
+
+
+/**
+  * @brief API to send an address character(MSB set) which wakes up the addressed node on a multidrop bus.
+  *        Waits for TXE, the data that follows is sent with the normal transmit APIs.
+  *        In 8 bit mode the data bytes must keep bit 7 cleared.
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param address: 4 bit address of the node
+  * @retval none
+ */
+void hal_uart_send_address(uart_handle_t *uart_handle, uint8_t address);
+
+
+
+/**
+  * @brief API to read a consistent copy of the UART statistics without disabling interrupts
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @param *stats: destination of the copy
+  * @retval none
+ */
+void hal_uart_get_stats(uart_handle_t *uart_handle, uart_stats_t *stats);
+
+
+
+/**
+  * @brief API to reset all UART statistics counters
+  * @param *uart_handle: pointer to handle structure of UART peripheral
+  * @retval none
+ */
+void hal_uart_reset_stats(uart_handle_t *uart_handle);
+
+
+
 /**
   * @brief This API handles the UART interrupt request
+  *        SR, CR1 and CR3 are read only once, the pending and enabled events are then dispatched from that snapshot.
   * @param *huart: pointer to uart_handle_t structure that contains the configuration for the specified UART module.
   * @retval none
  */
@@ -0,0 +1,171 @@
+/***************************************************************************************************************************
+  * @file    ring_buffer.c
+  * @author  Sharath N
+  * @brief   Lock-free single producer/single consumer ring buffer,
+             used between application(thread context) and UART ISR.
+***************************************************************************************************************************/
+
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "ring_buffer.h"
+
+/***********************************************************************************************************************************/
+/*                                                                                                                                 */
+/*                                               Driver Exposed APIs                                                               */
+/*                                                                                                                                 */
+/***********************************************************************************************************************************/
+
+/**
+  * @brief  Initializes the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *buffer : storage for the ring buffer
+  * @param  size : size of the storage, must be power of two
+  * @retval  0 on success, 1 if size is not power of two
+ */
+uint8_t ring_buffer_init(ring_buffer_t *rb, uint8_t *buffer, uint32_t size)
+{
+	if((size == 0) || (size & (size - 1)))
+		return 1;
+
+	rb->buffer = buffer;
+	rb->mask = size - 1;
+	rb->head = 0;
+	rb->tail = 0;
+
+	return 0;
+}
+
+
+
+/**
+  * @brief  Returns the number of bytes stored in the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @retval  number of bytes
+ */
+uint32_t ring_buffer_count(ring_buffer_t *rb)
+{
+	/* Unsigned subtraction handles wrap around of the free running counters */
+	return (rb->head - rb->tail);
+}
+
+
+
+/**
+  * @brief  Returns the number of bytes that can still be written to the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @retval  number of free bytes
+ */
+uint32_t ring_buffer_free(ring_buffer_t *rb)
+{
+	return (rb->mask + 1) - (rb->head - rb->tail);
+}
+
+
+
+/**
+  * @brief  Producer side, copies upto len bytes into the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *data : data to be written
+  * @param  len : number of bytes to be written
+  * @retval  number of bytes actually written
+ */
+uint32_t ring_buffer_write(ring_buffer_t *rb, const uint8_t *data, uint32_t len)
+{
+	uint32_t head = rb->head;
+	uint32_t space = (rb->mask + 1) - (head - rb->tail);
+	uint32_t i;
+
+	if(len > space)
+		len = space;
+
+	for(i = 0; i < len; i++)
+	{
+		rb->buffer[(head + i) & rb->mask] = data[i];
+	}
+
+	/* Data must be visible to the consumer before the new head is published */
+	__DMB();
+	rb->head = head + len;
+
+	return len;
+}
+
+
+
+/**
+  * @brief  Consumer side, copies upto len bytes out of the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *data : destination buffer
+  * @param  len : maximum number of bytes to be read
+  * @retval  number of bytes actually read
+ */
+uint32_t ring_buffer_read(ring_buffer_t *rb, uint8_t *data, uint32_t len)
+{
+	uint32_t tail = rb->tail;
+	uint32_t count = rb->head - tail;
+	uint32_t i;
+
+	if(len > count)
+		len = count;
+
+	/* Do not read the data before head has been observed */
+	__DMB();
+
+	for(i = 0; i < len; i++)
+	{
+		data[i] = rb->buffer[(tail + i) & rb->mask];
+	}
+
+	/* Slots must be read completely before they are handed back to the producer */
+	__DMB();
+	rb->tail = tail + len;
+
+	return len;
+}
+
+
+
+/**
+  * @brief  Producer side, writes one byte into the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  byte : byte to be written
+  * @retval  1 if written, 0 if ring buffer is full
+ */
+uint8_t ring_buffer_put(ring_buffer_t *rb, uint8_t byte)
+{
+	uint32_t head = rb->head;
+
+	if((head - rb->tail) > rb->mask)
+		return 0;
+
+	rb->buffer[head & rb->mask] = byte;
+
+	__DMB();
+	rb->head = head + 1;
+
+	return 1;
+}
+
+
+
+/**
+  * @brief  Consumer side, reads one byte from the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *byte : destination of the byte
+  * @retval  1 if a byte is read, 0 if ring buffer is empty
+ */
+uint8_t ring_buffer_get(ring_buffer_t *rb, uint8_t *byte)
+{
+	uint32_t tail = rb->tail;
+
+	if(rb->head == tail)
+		return 0;
+
+	__DMB();
+	*byte = rb->buffer[tail & rb->mask];
+
+	__DMB();
+	rb->tail = tail + 1;
+
+	return 1;
+}
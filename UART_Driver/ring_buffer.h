@@ -0,0 +1,91 @@
+/**************************************************************************************************************************
+ * @file     ring_buffer.h
+ * @author   Sharath N
+ * @brief    Header file for lock-free single producer/single consumer ring buffer used by the UART driver.
+ *           One side (thread or ISR) only writes, the other side only reads, so no interrupts need to be disabled.
+ **************************************************************************************************************************/
+
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#include <stdint.h>
+
+
+/**
+  *@brief Ring buffer structure definition
+  *       head and tail are free running counters, index into buffer is (counter & mask)
+	*/
+typedef struct
+{
+	uint8_t                *buffer;          /* Storage given by the application */
+	uint32_t               mask;             /* Size of the storage - 1, size must be power of two */
+	volatile uint32_t      head;             /* Written only by the producer */
+	volatile uint32_t      tail;             /* Written only by the consumer */
+} ring_buffer_t;
+
+
+
+/**
+  * @brief  Initializes the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *buffer : storage for the ring buffer
+  * @param  size : size of the storage, must be power of two
+  * @retval  0 on success, 1 if size is not power of two
+ */
+uint8_t ring_buffer_init(ring_buffer_t *rb, uint8_t *buffer, uint32_t size);
+
+
+/**
+  * @brief  Returns the number of bytes stored in the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @retval  number of bytes
+ */
+uint32_t ring_buffer_count(ring_buffer_t *rb);
+
+
+/**
+  * @brief  Returns the number of bytes that can still be written to the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @retval  number of free bytes
+ */
+uint32_t ring_buffer_free(ring_buffer_t *rb);
+
+
+/**
+  * @brief  Producer side, copies upto len bytes into the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *data : data to be written
+  * @param  len : number of bytes to be written
+  * @retval  number of bytes actually written
+ */
+uint32_t ring_buffer_write(ring_buffer_t *rb, const uint8_t *data, uint32_t len);
+
+
+/**
+  * @brief  Consumer side, copies upto len bytes out of the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *data : destination buffer
+  * @param  len : maximum number of bytes to be read
+  * @retval  number of bytes actually read
+ */
+uint32_t ring_buffer_read(ring_buffer_t *rb, uint8_t *data, uint32_t len);
+
+
+/**
+  * @brief  Producer side, writes one byte into the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  byte : byte to be written
+  * @retval  1 if written, 0 if ring buffer is full
+ */
+uint8_t ring_buffer_put(ring_buffer_t *rb, uint8_t byte);
+
+
+/**
+  * @brief  Consumer side, reads one byte from the ring buffer
+  * @param  *rb : pointer to ring buffer
+  * @param  *byte : destination of the byte
+  * @retval  1 if a byte is read, 0 if ring buffer is empty
+ */
+uint8_t ring_buffer_get(ring_buffer_t *rb, uint8_t *byte);
+
+#endif
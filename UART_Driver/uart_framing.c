@@ -0,0 +1,358 @@
+/***************************************************************************************************************************
+  * @file    uart_framing.c
+  * @author  Sharath N
+  * @brief   COBS/SLIP packet framing,
+             incremental decoder for the UART receive path and encoders for transmission.
+***************************************************************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "stm32f407xx.h"
+#include "uart_framing.h"
+
+/***************************************************************************************************************************/
+/*                                                                                                                         */
+/*                                               Helper functions                                                          */
+/*                                                                                                                         */
+/***************************************************************************************************************************/
+
+/**
+  * @brief  Returns the index of the first zero byte, checking one 32 bit word at a time
+  * @param  *p : data to be scanned
+  * @param  n : number of bytes to be scanned
+  * @retval  index of first zero byte, n if there is none
+ */
+static uint32_t uart_cobs_find_zero(const uint8_t *p, uint32_t n)
+{
+	uint32_t i = 0, w;
+
+	while((i + 4) <= n)
+	{
+		/* Cortex-M4 allows unaligned word loads, memcpy compiles to a single LDR */
+		memcpy(&w, p + i, 4);
+
+		/* Non zero only if one of the four bytes is zero */
+		if((w - 0x01010101UL) & ~w & 0x80808080UL)
+			break;
+
+		i += 4;
+	}
+
+	while((i < n) && p[i])
+		i++;
+
+	return i;
+}
+
+
+
+/**
+  * @brief  Resets the decoder for the next frame
+  * @param  *framer : pointer to framer
+  * @retval  none
+ */
+static void uart_framer_reset(uart_framer_t *framer)
+{
+	framer->RxLen = 0;
+	framer->CobsCode = 0;
+	framer->CobsLeft = 0;
+	framer->SlipEsc = 0;
+	framer->Discard = 0;
+}
+
+
+
+/**
+  * @brief  Appends one decoded byte to the packet being received
+  * @param  *framer : pointer to framer
+  * @param  byte : decoded byte
+  * @retval  none
+ */
+static void uart_framer_append(uart_framer_t *framer, uint8_t byte)
+{
+	if(framer->Discard)
+		return;
+
+	/* Queue full or packet too long, drop the whole frame */
+	if(((framer->Head - framer->Tail) >= UART_FRAME_QUEUE_DEPTH) || (framer->RxLen >= UART_FRAME_MAX_PAYLOAD))
+	{
+		framer->Discard = 1;
+		framer->Dropped++;
+		return;
+	}
+
+	framer->Queue[framer->Head & (UART_FRAME_QUEUE_DEPTH - 1)].data[framer->RxLen++] = byte;
+}
+
+
+
+/**
+  * @brief  Hands the packet being received over to the application
+  * @param  *framer : pointer to framer
+  * @retval  none
+ */
+static void uart_framer_commit(uart_framer_t *framer)
+{
+	if(!framer->Discard && framer->RxLen)
+	{
+		framer->Queue[framer->Head & (UART_FRAME_QUEUE_DEPTH - 1)].len = framer->RxLen;
+
+		/* Packet must be complete before it is published to the application */
+		__DMB();
+		framer->Head++;
+	}
+
+	uart_framer_reset(framer);
+}
+
+
+
+/**
+  * @brief  Decodes one COBS byte
+  * @param  *framer : pointer to framer
+  * @param  byte : received byte
+  * @retval  none
+ */
+static void uart_framer_cobs_byte(uart_framer_t *framer, uint8_t byte)
+{
+	if(byte == COBS_DELIMITER)
+	{
+		/* Frame ended in the middle of a block */
+		if(framer->CobsLeft)
+		{
+			framer->Errors++;
+			uart_framer_reset(framer);
+			return;
+		}
+
+		uart_framer_commit(framer);
+	}
+	else if(framer->CobsLeft == 0)
+	{
+		/* Code byte, a block shorter than 254 bytes stood for a zero in the original data */
+		if(framer->CobsCode && (framer->CobsCode != 0xFF))
+			uart_framer_append(framer, 0);
+
+		framer->CobsCode = byte;
+		framer->CobsLeft = byte - 1;
+	}
+	else
+	{
+		uart_framer_append(framer, byte);
+		framer->CobsLeft--;
+	}
+}
+
+
+
+/**
+  * @brief  Decodes one SLIP byte
+  * @param  *framer : pointer to framer
+  * @param  byte : received byte
+  * @retval  none
+ */
+static void uart_framer_slip_byte(uart_framer_t *framer, uint8_t byte)
+{
+	if(byte == SLIP_END)
+	{
+		uart_framer_commit(framer);
+	}
+	else if(byte == SLIP_ESC)
+	{
+		framer->SlipEsc = 1;
+	}
+	else
+	{
+		if(framer->SlipEsc)
+		{
+			framer->SlipEsc = 0;
+
+			if(byte == SLIP_ESC_END)
+				byte = SLIP_END;
+			else if(byte == SLIP_ESC_ESC)
+				byte = SLIP_ESC;
+			else
+				framer->Errors++;
+		}
+
+		uart_framer_append(framer, byte);
+	}
+}
+
+
+
+/***********************************************************************************************************************************/
+/*                                                                                                                                 */
+/*                                               Exposed APIs                                                                      */
+/*                                                                                                                                 */
+/***********************************************************************************************************************************/
+
+/**
+  * @brief  Initializes the framer
+  * @param  *framer : pointer to framer
+  * @param  mode : UART_FRAMING_COBS or UART_FRAMING_SLIP
+  * @retval  none
+ */
+void uart_framer_init(uart_framer_t *framer, uint32_t mode)
+{
+	framer->Mode = mode;
+	framer->Head = 0;
+	framer->Tail = 0;
+	framer->Dropped = 0;
+	framer->Errors = 0;
+
+	uart_framer_reset(framer);
+}
+
+
+
+/**
+  * @brief  Feeds received bytes into the decoder, complete packets are put into the packet queue.
+  *         Called from the UART receive path.
+  * @param  *framer : pointer to framer
+  * @param  *data : received bytes
+  * @param  len : number of received bytes
+  * @retval  none
+ */
+void uart_framer_feed(uart_framer_t *framer, const uint8_t *data, uint32_t len)
+{
+	uint32_t i;
+
+	if(framer->Mode == UART_FRAMING_SLIP)
+	{
+		for(i = 0; i < len; i++)
+			uart_framer_slip_byte(framer, data[i]);
+	}
+	else
+	{
+		for(i = 0; i < len; i++)
+			uart_framer_cobs_byte(framer, data[i]);
+	}
+}
+
+
+
+/**
+  * @brief  Returns the oldest decoded packet without copying it, or NULL if queue is empty.
+  *         Call uart_framer_release once the packet is consumed.
+  * @param  *framer : pointer to framer
+  * @retval  pointer to packet
+ */
+uart_packet_t *uart_framer_peek(uart_framer_t *framer)
+{
+	if(framer->Head == framer->Tail)
+		return 0;
+
+	return &framer->Queue[framer->Tail & (UART_FRAME_QUEUE_DEPTH - 1)];
+}
+
+
+
+/**
+  * @brief  Releases the packet returned by uart_framer_peek
+  * @param  *framer : pointer to framer
+  * @retval  none
+ */
+void uart_framer_release(uart_framer_t *framer)
+{
+	if(framer->Head != framer->Tail)
+	{
+		/* Slot must be read completely before it is handed back to the decoder */
+		__DMB();
+		framer->Tail++;
+	}
+}
+
+
+
+/**
+  * @brief  COBS encodes a packet, a zero byte delimiter is appended
+  * @param  *src : packet to be encoded
+  * @param  len : length of the packet
+  * @param  *dst : destination, must hold COBS_MAX_ENCODED_LEN(len) bytes
+  * @retval  encoded length
+ */
+uint32_t uart_cobs_encode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+	uint8_t *out = dst;
+	uint8_t *code;
+	uint32_t run, n;
+
+	while(1)
+	{
+		code = out++;
+		run = (len > 254) ? 254 : len;
+
+		/* Copy everything upto the next zero as one block */
+		n = uart_cobs_find_zero(src, run);
+		memcpy(out, src, n);
+		out += n;
+		src += n;
+		len -= n;
+
+		if(n < run)
+		{
+			/* Zero found, it is replaced by the code byte */
+			*code = (uint8_t)(n + 1);
+			src++;
+			len--;
+		}
+		else if(n == 254)
+		{
+			/* Maximum block without zero */
+			*code = 0xFF;
+			if(len == 0)
+				break;
+		}
+		else
+		{
+			/* End of data */
+			*code = (uint8_t)(n + 1);
+			break;
+		}
+	}
+
+	*out++ = COBS_DELIMITER;
+
+	return (uint32_t)(out - dst);
+}
+
+
+
+/**
+  * @brief  SLIP encodes a packet, SLIP_END is placed before and after the packet
+  * @param  *src : packet to be encoded
+  * @param  len : length of the packet
+  * @param  *dst : destination, must hold SLIP_MAX_ENCODED_LEN(len) bytes
+  * @retval  encoded length
+ */
+uint32_t uart_slip_encode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+	uint8_t *out = dst;
+	uint32_t i;
+
+	/* Leading END flushes any line noise received before the packet */
+	*out++ = SLIP_END;
+
+	for(i = 0; i < len; i++)
+	{
+		if(src[i] == SLIP_END)
+		{
+			*out++ = SLIP_ESC;
+			*out++ = SLIP_ESC_END;
+		}
+		else if(src[i] == SLIP_ESC)
+		{
+			*out++ = SLIP_ESC;
+			*out++ = SLIP_ESC_ESC;
+		}
+		else
+		{
+			*out++ = src[i];
+		}
+	}
+
+	*out++ = SLIP_END;
+
+	return (uint32_t)(out - dst);
+}
@@ -0,0 +1,144 @@
+/**************************************************************************************************************************
+ * @file     uart_framing.h
+ * @author   Sharath N
+ * @brief    Header file for COBS/SLIP packet framing on top of the UART driver.
+ *           Decoder is fed from the UART receive path and queues complete packets for the application.
+ **************************************************************************************************************************/
+
+#ifndef __UART_FRAMING_H
+#define __UART_FRAMING_H
+
+#include <stdint.h>
+
+/******************************************************************************************************************************/
+/*                                                                                                                            */
+/*                                            1. Framing definitions                                                          */
+/*                                                                                                                            */
+/******************************************************************************************************************************/
+
+/* Framing modes */
+#define UART_FRAMING_COBS                                              0
+#define UART_FRAMING_SLIP                                              1
+
+/* Maximum decoded payload of one packet */
+#ifndef UART_FRAME_MAX_PAYLOAD
+#define UART_FRAME_MAX_PAYLOAD                                         256
+#endif
+
+/* Number of packets the queue can hold, must be power of two */
+#ifndef UART_FRAME_QUEUE_DEPTH
+#define UART_FRAME_QUEUE_DEPTH                                         4
+#endif
+
+/* COBS frame delimiter */
+#define COBS_DELIMITER                                                 ((uint8_t) 0x00)
+
+/* SLIP special characters */
+#define SLIP_END                                                       ((uint8_t) 0xC0)
+#define SLIP_ESC                                                       ((uint8_t) 0xDB)
+#define SLIP_ESC_END                                                   ((uint8_t) 0xDC)
+#define SLIP_ESC_ESC                                                   ((uint8_t) 0xDD)
+
+/* Worst case encoded size of len bytes, including delimiters */
+#define COBS_MAX_ENCODED_LEN(len)                                      ((len) + ((len) / 254) + 2)
+#define SLIP_MAX_ENCODED_LEN(len)                                      ((2 * (len)) + 2)
+
+
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                              2. Data Structure used by framing layer                                                    */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+/**
+  *@brief Decoded packet
+	*/
+typedef struct
+{
+	uint16_t               len;                            /* Length of the decoded payload */
+	uint8_t                data[UART_FRAME_MAX_PAYLOAD];   /* Decoded payload */
+} uart_packet_t;
+
+
+/**
+  *@brief Framer structure definition, decoder writes straight into the free queue slot
+	*/
+typedef struct
+{
+	uint32_t               Mode;             /* UART_FRAMING_COBS or UART_FRAMING_SLIP */
+	uint16_t               RxLen;            /* Bytes decoded so far in current packet */
+	uint8_t                CobsCode;         /* Code byte of current COBS block, 0 at start of frame */
+	uint8_t                CobsLeft;         /* Bytes left in current COBS block, 0 if next byte is a code byte */
+	uint8_t                SlipEsc;          /* Previous SLIP byte was SLIP_ESC */
+	uint8_t                Discard;          /* Current frame is dropped, wait for next delimiter */
+	uart_packet_t          Queue[UART_FRAME_QUEUE_DEPTH];
+	volatile uint32_t      Head;             /* Written only by the receive path */
+	volatile uint32_t      Tail;             /* Written only by the application */
+	uint32_t               Dropped;          /* Packets dropped because queue was full or packet too long */
+	uint32_t               Errors;           /* Malformed frames */
+} uart_framer_t;
+
+
+/*******************************************************************************************************************************************/
+/*                                                                                                                                         */
+/*                                              3. Exposed APIs                                                                            */
+/*                                                                                                                                         */
+/*******************************************************************************************************************************************/
+
+/**
+  * @brief  Initializes the framer
+  * @param  *framer : pointer to framer
+  * @param  mode : UART_FRAMING_COBS or UART_FRAMING_SLIP
+  * @retval  none
+ */
+void uart_framer_init(uart_framer_t *framer, uint32_t mode);
+
+
+/**
+  * @brief  Feeds received bytes into the decoder, complete packets are put into the packet queue.
+  *         Called from the UART receive path.
+  * @param  *framer : pointer to framer
+  * @param  *data : received bytes
+  * @param  len : number of received bytes
+  * @retval  none
+ */
+void uart_framer_feed(uart_framer_t *framer, const uint8_t *data, uint32_t len);
+
+
+/**
+  * @brief  Returns the oldest decoded packet without copying it, or NULL if queue is empty.
+  *         Call uart_framer_release once the packet is consumed.
+  * @param  *framer : pointer to framer
+  * @retval  pointer to packet
+ */
+uart_packet_t *uart_framer_peek(uart_framer_t *framer);
+
+
+/**
+  * @brief  Releases the packet returned by uart_framer_peek
+  * @param  *framer : pointer to framer
+  * @retval  none
+ */
+void uart_framer_release(uart_framer_t *framer);
+
+
+/**
+  * @brief  COBS encodes a packet, a zero byte delimiter is appended
+  * @param  *src : packet to be encoded
+  * @param  len : length of the packet
+  * @param  *dst : destination, must hold COBS_MAX_ENCODED_LEN(len) bytes
+  * @retval  encoded length
+ */
+uint32_t uart_cobs_encode(const uint8_t *src, uint32_t len, uint8_t *dst);
+
+
+/**
+  * @brief  SLIP encodes a packet, SLIP_END is placed before and after the packet
+  * @param  *src : packet to be encoded
+  * @param  len : length of the packet
+  * @param  *dst : destination, must hold SLIP_MAX_ENCODED_LEN(len) bytes
+  * @retval  encoded length
+ */
+uint32_t uart_slip_encode(const uint8_t *src, uint32_t len, uint8_t *dst);
+
+#endif